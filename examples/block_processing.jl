@@ -10,6 +10,9 @@ This example shows how to:
 2. Process audio in blocks of arbitrary size
 3. Send parameter changes
 4. Write the processed audio to a file
+
+The whole file is held in memory. For long files, `renderfile` streams the input
+through the plugin with constant memory use instead.
 """
 
 function process_audio_blocks(plugin_path::String, input_file::String, output_file::String;
@@ -0,0 +1,52 @@
+using VST3Host
+using Printf
+
+# Example: Load and run many plugin instances from several Julia threads at once.
+# Start Julia with threads, e.g. `julia -t 8 concurrent_loading.jl`.
+#
+# Loading, unloading and processing different instances concurrently is supported;
+# a single instance must only be processed from one thread at a time.
+
+function main()
+    # Update path to a real plugin on your system
+    plugin_path = "/Library/Audio/Plug-Ins/VST3/YourPlugin.vst3"
+    sample_rate = 48000.0
+    block_size = 512
+    num_instances = 4 * Threads.nthreads()
+    num_blocks = 100
+
+    VST3Host.init()
+
+    # Load from all threads; instances share one loaded module
+    plugins = Vector{VST3Plugin}(undef, num_instances)
+    t_load = @elapsed Threads.@threads for i in 1:num_instances
+        plugins[i] = VST3Plugin(plugin_path, sample_rate, block_size)
+    end
+    @printf("Loaded %d instances on %d threads in %.1f ms (%d module(s) loaded)\n",
+            num_instances, Threads.nthreads(), 1000 * t_load, loadedmodules())
+
+    # Each task owns its instance and buffers
+    t_process = @elapsed Threads.@threads for i in 1:num_instances
+        plugin = plugins[i]
+        input = randn(Float32, plugin.num_inputs, block_size)
+        output = zeros(Float32, plugin.num_outputs, block_size)
+        for _ in 1:num_blocks
+            process!(plugin, input, output)
+        end
+    end
+    audio_seconds = num_instances * num_blocks * block_size / sample_rate
+    @printf("Processed %.1f s of audio in %.1f ms (%.0fx realtime)\n",
+            audio_seconds, 1000 * t_process, audio_seconds / t_process)
+
+    # Unload concurrently as well
+    Threads.@threads for i in 1:num_instances
+        close(plugins[i])
+    end
+
+    VST3Host.shutdown() || println("Shutdown skipped: instances still loaded")
+end
+
+# Only run if this is the main script
+if abspath(PROGRAM_FILE) == @__FILE__
+    main()
+end
@@ -18,6 +18,12 @@ function test_program_change(synth_path::String, output_file::String;
     plugin_info = info(plugin)
     println("  Plugin: $(plugin_info.name)")
 
+    # Program lists published by the plugin
+    lists = programlists(plugin)
+    for list in lists
+        println("  Program list '$(list.name)': $(length(list.programs)) programs")
+    end
+
     # Check for preset/program parameters
     println("\nLooking for preset/program parameters...")
     params = parameters(plugin)
@@ -62,8 +68,10 @@ function test_program_change(synth_path::String, output_file::String;
 
         println("\n--- Program $prog ---")
 
-        # Method 1: Try MIDI Program Change
-        programchange(plugin, 0, prog, 0)
+        # Method 1: MIDI Program Change (needs a program change parameter)
+        if !isempty(lists)
+            programchange(plugin, 0, prog, 0)
+        end
 
         # Method 2: If there's a preset parameter, try changing it
         if !isempty(preset_params)
@@ -123,7 +131,7 @@ function test_program_change(synth_path::String, output_file::String;
     close(plugin)
     println("Done!")
 
-    if isempty(preset_params)
+    if isempty(preset_params) && isempty(lists)
         println("\n⚠ Note: This plugin doesn't expose preset parameters.")
         println("Program changes may or may not work depending on the plugin.")
         println("Check the plugin's documentation for preset management.")
@@ -0,0 +1,54 @@
+using VST3Host
+using Printf
+
+# Example: Reset a plugin between renders by restoring a state snapshot,
+# and compare the cost against unloading and reloading the plugin.
+
+function main()
+    # Load a plugin (update path to a real plugin on your system)
+    plugin_path = "/Library/Audio/Plug-Ins/VST3/YourPlugin.vst3"
+    sample_rate = 44100.0
+    block_size = 512
+    iterations = 20
+
+    println("Loading plugin...")
+    plugin = VST3Plugin(plugin_path, sample_rate, block_size)
+
+    # Snapshot the freshly loaded state
+    state = savestate(plugin)
+    println("State size: $(length(state)) bytes")
+
+    # Dirty the plugin so the restore has something to undo
+    params = parameters(plugin)
+    if !isempty(params)
+        setparameter!(plugin, params[1].id, 1.0 - params[1].default_value)
+    end
+
+    # Warm up
+    loadstate!(plugin, state)
+
+    restore_times = Float64[]
+    for _ in 1:iterations
+        push!(restore_times, @elapsed loadstate!(plugin, state))
+    end
+    close(plugin)
+
+    reload_times = Float64[]
+    for _ in 1:iterations
+        push!(reload_times, @elapsed begin
+            p = VST3Plugin(plugin_path, sample_rate, block_size)
+            close(p)
+        end)
+    end
+
+    restore_ms = 1000 * minimum(restore_times)
+    reload_ms = 1000 * minimum(reload_times)
+    @printf("State restore: %8.3f ms (best of %d)\n", restore_ms, iterations)
+    @printf("Full reload:   %8.3f ms (best of %d)\n", reload_ms, iterations)
+    @printf("Speedup:       %8.1fx\n", reload_ms / restore_ms)
+end
+
+# Only run if this is the main script
+if abspath(PROGRAM_FILE) == @__FILE__
+    main()
+end
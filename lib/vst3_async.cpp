@@ -0,0 +1,128 @@
+// Pipelined processing on a per-instance worker thread
+//
+// vst3_process_submit hands a block to the plugin's worker and returns a ticket
+// at once, so the caller can prepare the next block (decode input, compute
+// automation) while this one is processed. Blocks run in submission order. The
+// worker is started by the first submit and stopped when the plugin is unloaded.
+
+#include "vst3_host.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "vst3_host_internal.h"
+
+namespace {
+
+// Blocks a plugin may have queued or running; enough for triple buffering with slack
+const int32_t kMaxInFlight = 8;
+
+} // namespace
+
+struct ProcessWorker {
+    struct Block {
+        VST3ProcessJob* job;
+        int32_t num_samples;
+    };
+
+    std::mutex mutex;
+    std::condition_variable submitted;
+    std::condition_variable completed;
+    Block queue[kMaxInFlight];
+    int64_t next_ticket = 1;        // Ticket of the next submitted block
+    int64_t completed_ticket = 0;   // Every ticket up to this one has finished
+    bool stopping = false;
+    std::thread thread;
+};
+
+namespace {
+
+void worker_main(ProcessWorker* worker) {
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    for (;;) {
+        worker->submitted.wait(lock, [worker] {
+            return worker->stopping || worker->completed_ticket + 1 < worker->next_ticket;
+        });
+        if (worker->completed_ticket + 1 >= worker->next_ticket) return;    // Stopping and drained
+
+        int64_t ticket = worker->completed_ticket + 1;
+        ProcessWorker::Block block = worker->queue[ticket % kMaxInFlight];
+        lock.unlock();
+
+        VST3ProcessJob& job = *block.job;
+        for (int32_t e = 0; e < job.num_events; e++) {
+            queue_midi_event(job.plugin, &job.events[e]);
+        }
+        job.result = vst3_process(job.plugin, job.inputs, job.outputs, block.num_samples,
+                                  job.num_input_channels, job.num_output_channels);
+
+        lock.lock();
+        worker->completed_ticket = ticket;
+        worker->completed.notify_all();
+    }
+}
+
+} // namespace
+
+void stop_process_worker(VST3Plugin* plugin) {
+    ProcessWorker* worker = plugin->worker;
+    if (!worker) return;
+
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->stopping = true;
+    }
+    worker->submitted.notify_all();
+    worker->thread.join();
+    delete worker;
+    plugin->worker = nullptr;
+}
+
+extern "C" {
+
+int64_t vst3_process_submit(VST3ProcessJob* job, int32_t num_samples) {
+    if (!job || !job->plugin || num_samples < 0) return -1;
+    VST3Plugin* plugin = job->plugin;
+    if (!plugin->processor || num_samples > plugin->max_block_size) {
+        fprintf(stderr, "Error: Plugin is not set up for blocks of %d samples\n", num_samples);
+        return -1;
+    }
+
+    if (!plugin->worker) {
+        plugin->worker = new ProcessWorker();
+        plugin->worker->thread = std::thread(worker_main, plugin->worker);
+    }
+    ProcessWorker* worker = plugin->worker;
+
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    worker->completed.wait(lock, [worker] {
+        return worker->next_ticket - worker->completed_ticket <= kMaxInFlight;
+    });
+    int64_t ticket = worker->next_ticket++;
+    worker->queue[ticket % kMaxInFlight] = {job, num_samples};
+    lock.unlock();
+    worker->submitted.notify_one();
+    return ticket;
+}
+
+int vst3_process_poll(VST3Plugin* plugin, int64_t ticket) {
+    if (!plugin || !plugin->worker || ticket <= 0) return -1;
+    ProcessWorker* worker = plugin->worker;
+
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (ticket >= worker->next_ticket) return -1;
+    return worker->completed_ticket >= ticket ? 1 : 0;
+}
+
+int vst3_process_wait(VST3Plugin* plugin, int64_t ticket) {
+    if (!plugin || !plugin->worker || ticket <= 0) return -1;
+    ProcessWorker* worker = plugin->worker;
+
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    if (ticket >= worker->next_ticket) return -1;
+    worker->completed.wait(lock, [worker, ticket] { return worker->completed_ticket >= ticket; });
+    return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,331 @@
+// Host-owned realtime processing thread driven by a simulated device clock
+//
+// The thread wakes once per period at absolute deadlines, as an audio device's
+// callback would, reads one period of interleaved input from a lock-free ring,
+// processes it through a plugin, chain or graph and writes the output to a
+// second ring. The caller's thread only moves samples through the rings, so GC
+// pauses there show up as underruns instead of late blocks. Missing input is
+// processed as silence and output that does not fit is dropped, like a device
+// that keeps running. Processing that finishes after the next period should have
+// started counts as a deadline miss.
+
+#include "vst3_host.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+#include "vst3_host_internal.h"
+#include "vst3_ring.h"
+
+struct VST3AudioThread {
+    VST3AudioThreadConfig config;
+    int32_t target_kind;
+    void* target;
+
+    SpscRing input_ring;
+    SpscRing output_ring;
+
+    // Thread-side scratch: one interleaved period and planar channels
+    std::vector<float> interleaved;
+    std::vector<float> input_memory;
+    std::vector<float> output_memory;
+    std::vector<float*> inputs;
+    std::vector<float*> outputs;
+
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+
+    std::atomic<int64_t> periods{0};
+    std::atomic<int64_t> deadline_misses{0};
+    std::atomic<int64_t> underruns{0};
+    std::atomic<int64_t> overruns{0};
+    std::atomic<double> max_process_ms{0.0};
+    std::atomic<double> total_process_ms{0.0};
+    std::atomic<double> max_wakeup_ms{0.0};
+    std::atomic<int32_t> realtime{0};
+    std::atomic<int32_t> memory_locked{0};
+
+    VST3AudioThread(const VST3AudioThreadConfig& c, int32_t kind, void* t)
+        : config(c), target_kind(kind), target(t),
+          input_ring(static_cast<size_t>(c.ring_periods) * c.period_frames * std::max(c.num_input_channels, 1)),
+          output_ring(static_cast<size_t>(c.ring_periods) * c.period_frames * std::max(c.num_output_channels, 1)) {}
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Denormals make filter tails and reverbs decaying to silence run many times slower
+void flush_denormals() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_setcsr(_mm_getcsr() | 0x8040);      // FTZ | DAZ
+#elif defined(__aarch64__)
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (1ULL << 24)));  // FZ
+#endif
+}
+
+// mlockall applies to the whole process, so it is counted across audio threads
+// and undone when the last one that asked for it stops
+std::mutex gMemoryLockMutex;
+int32_t gMemoryLocks = 0;
+
+void lock_memory(VST3AudioThread* t) {
+    std::lock_guard<std::mutex> lock(gMemoryLockMutex);
+    if (gMemoryLocks == 0 && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "Warning: could not lock memory for audio thread (%s)\n", strerror(errno));
+        return;
+    }
+    gMemoryLocks++;
+    t->memory_locked.store(1, std::memory_order_relaxed);
+}
+
+void unlock_memory(VST3AudioThread* t) {
+    if (!t->memory_locked.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(gMemoryLockMutex);
+    if (--gMemoryLocks == 0) munlockall();
+    t->memory_locked.store(0, std::memory_order_relaxed);
+}
+
+// Best effort: without the privilege the thread keeps normal scheduling
+void make_realtime(VST3AudioThread* t) {
+    if (t->config.lock_memory) lock_memory(t);
+    if (!t->config.realtime) return;
+
+    int priority = t->config.priority > 0 ? t->config.priority : sched_get_priority_max(SCHED_FIFO) - 10;
+    priority = std::max(priority, sched_get_priority_min(SCHED_FIFO));
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err == 0) {
+        t->realtime.store(1, std::memory_order_relaxed);
+    } else {
+        fprintf(stderr, "Warning: SCHED_FIFO not permitted for audio thread (%s)\n", strerror(err));
+    }
+}
+
+void sleep_until(Clock::time_point deadline) {
+#ifdef __linux__
+    // steady_clock is CLOCK_MONOTONIC here; an absolute wait does not drift
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#else
+    std::this_thread::sleep_until(deadline);
+#endif
+}
+
+void store_max(std::atomic<double>& target, double value) {
+    double current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+void run_period(VST3AudioThread* t) {
+    const int32_t frames = t->config.period_frames;
+    const int32_t nin = t->config.num_input_channels;
+    const int32_t nout = t->config.num_output_channels;
+
+    // Input: whole periods only, otherwise silence
+    if (nin > 0) {
+        size_t samples = static_cast<size_t>(frames) * nin;
+        if (t->input_ring.readable() >= samples) {
+            t->input_ring.read(t->interleaved.data(), samples);
+            for (int32_t ch = 0; ch < nin; ch++) {
+                float* dst = t->inputs[ch];
+                for (int32_t i = 0; i < frames; i++) dst[i] = t->interleaved[i * nin + ch];
+            }
+        } else {
+            t->underruns.fetch_add(1, std::memory_order_relaxed);
+            std::fill(t->input_memory.begin(), t->input_memory.end(), 0.0f);
+        }
+    }
+
+    if (process_audio_target(t->target_kind, t->target, t->inputs.data(), t->outputs.data(),
+                             frames, nin, nout) != 0) {
+        std::fill(t->output_memory.begin(), t->output_memory.end(), 0.0f);
+    }
+
+    if (nout > 0) {
+        size_t samples = static_cast<size_t>(frames) * nout;
+        if (t->output_ring.writable() >= samples) {
+            for (int32_t ch = 0; ch < nout; ch++) {
+                const float* src = t->outputs[ch];
+                for (int32_t i = 0; i < frames; i++) t->interleaved[i * nout + ch] = src[i];
+            }
+            t->output_ring.write(t->interleaved.data(), samples);
+        } else {
+            t->overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void thread_main(VST3AudioThread* t) {
+    make_realtime(t);
+    flush_denormals();
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(t->config.period_frames / t->config.sample_rate));
+    auto tick = Clock::now() + period;
+
+    while (!t->stopping.load(std::memory_order_acquire)) {
+        sleep_until(tick);
+        auto woke = Clock::now();
+        store_max(t->max_wakeup_ms, std::chrono::duration<double, std::milli>(woke - tick).count());
+
+        run_period(t);
+
+        auto done = Clock::now();
+        double ms = std::chrono::duration<double, std::milli>(done - woke).count();
+        store_max(t->max_process_ms, ms);
+        t->total_process_ms.store(t->total_process_ms.load(std::memory_order_relaxed) + ms,
+                                  std::memory_order_relaxed);
+        t->periods.fetch_add(1, std::memory_order_relaxed);
+
+        // The next period should have started by now: count it, and any periods the
+        // device clock passed while we were busy, then resynchronize
+        tick += period;
+        if (done > tick) {
+            int64_t missed = 1 + (done - tick) / period;
+            t->deadline_misses.fetch_add(missed, std::memory_order_relaxed);
+            tick += period * missed;
+        }
+    }
+}
+
+} // namespace
+
+bool check_audio_target(int32_t kind, void* target, int32_t block_size,
+                        int32_t num_input_channels, int32_t num_output_channels) {
+    if (!target) return false;
+    if (kind < VST3_AUDIO_TARGET_PLUGIN || kind > VST3_AUDIO_TARGET_GRAPH) {
+        fprintf(stderr, "Error: Unknown audio target kind %d\n", kind);
+        return false;
+    }
+    if (kind == VST3_AUDIO_TARGET_PLUGIN) {
+        VST3Plugin* plugin = static_cast<VST3Plugin*>(target);
+        if (!plugin->processor || block_size > plugin->max_block_size) {
+            fprintf(stderr, "Error: Plugin is not set up for blocks of %d samples\n", block_size);
+            return false;
+        }
+        return true;
+    }
+
+    // Chains and graphs read and write their full width
+    int32_t width = kind == VST3_AUDIO_TARGET_CHAIN ? chain_channels(static_cast<VST3Chain*>(target))
+                                                    : graph_channels(static_cast<VST3Graph*>(target));
+    if (num_input_channels != width || num_output_channels != width) {
+        fprintf(stderr, "Error: Target processes %d channels, got %d in and %d out\n",
+                width, num_input_channels, num_output_channels);
+        return false;
+    }
+    return true;
+}
+
+int process_audio_target(int32_t kind, void* target, float** inputs, float** outputs,
+                         int32_t num_samples, int32_t num_input_channels, int32_t num_output_channels) {
+    switch (kind) {
+        case VST3_AUDIO_TARGET_PLUGIN:
+            return vst3_process(static_cast<VST3Plugin*>(target), inputs, outputs, num_samples,
+                                num_input_channels, num_output_channels);
+        case VST3_AUDIO_TARGET_CHAIN:
+            return vst3_chain_process(static_cast<VST3Chain*>(target), inputs, outputs, num_samples);
+        case VST3_AUDIO_TARGET_GRAPH:
+            return vst3_graph_process(static_cast<VST3Graph*>(target), inputs, outputs, num_samples);
+        default:
+            return -1;
+    }
+}
+
+extern "C" {
+
+VST3AudioThread* vst3_audio_thread_start(const VST3AudioThreadConfig* config, int32_t target_kind, void* target) {
+    if (!config || !target || config->sample_rate <= 0.0 || config->period_frames <= 0 ||
+        config->num_input_channels < 0 || config->num_output_channels < 0) {
+        return nullptr;
+    }
+    if (!check_audio_target(target_kind, target, config->period_frames, config->num_input_channels,
+                            config->num_output_channels)) {
+        return nullptr;
+    }
+
+    VST3AudioThreadConfig c = *config;
+    if (c.ring_periods <= 0) c.ring_periods = 4;
+
+    VST3AudioThread* t = new VST3AudioThread(c, target_kind, target);
+    const int32_t frames = c.period_frames;
+    t->interleaved.resize(static_cast<size_t>(frames) * std::max(c.num_input_channels, c.num_output_channels));
+    t->input_memory.resize(static_cast<size_t>(frames) * c.num_input_channels);
+    t->output_memory.resize(static_cast<size_t>(frames) * c.num_output_channels);
+    for (int32_t ch = 0; ch < c.num_input_channels; ch++) t->inputs.push_back(&t->input_memory[ch * frames]);
+    for (int32_t ch = 0; ch < c.num_output_channels; ch++) t->outputs.push_back(&t->output_memory[ch * frames]);
+
+    t->thread = std::thread(thread_main, t);
+    return t;
+}
+
+int32_t vst3_audio_thread_write(VST3AudioThread* thread, const float* interleaved, int32_t num_frames) {
+    if (!thread || !interleaved || num_frames < 0) return -1;
+    const int32_t nin = thread->config.num_input_channels;
+    if (nin == 0) return 0;
+
+    size_t frames = std::min(static_cast<size_t>(num_frames), thread->input_ring.writable() / nin);
+    thread->input_ring.write(interleaved, frames * nin);
+    return static_cast<int32_t>(frames);
+}
+
+int32_t vst3_audio_thread_read(VST3AudioThread* thread, float* interleaved, int32_t num_frames) {
+    if (!thread || !interleaved || num_frames < 0) return -1;
+    const int32_t nout = thread->config.num_output_channels;
+    if (nout == 0) return 0;
+
+    size_t frames = std::min(static_cast<size_t>(num_frames), thread->output_ring.readable() / nout);
+    thread->output_ring.read(interleaved, frames * nout);
+    return static_cast<int32_t>(frames);
+}
+
+int vst3_audio_thread_get_stats(VST3AudioThread* thread, VST3AudioThreadStats* stats) {
+    if (!thread || !stats) return -1;
+
+    stats->periods = thread->periods.load(std::memory_order_relaxed);
+    stats->deadline_misses = thread->deadline_misses.load(std::memory_order_relaxed);
+    stats->underruns = thread->underruns.load(std::memory_order_relaxed);
+    stats->overruns = thread->overruns.load(std::memory_order_relaxed);
+    stats->period_ms = 1000.0 * thread->config.period_frames / thread->config.sample_rate;
+    stats->max_process_ms = thread->max_process_ms.load(std::memory_order_relaxed);
+    stats->avg_process_ms = stats->periods > 0
+        ? thread->total_process_ms.load(std::memory_order_relaxed) / stats->periods : 0.0;
+    stats->max_wakeup_ms = thread->max_wakeup_ms.load(std::memory_order_relaxed);
+    stats->realtime = thread->realtime.load(std::memory_order_relaxed);
+    stats->memory_locked = thread->memory_locked.load(std::memory_order_relaxed);
+    return 0;
+}
+
+void vst3_audio_thread_stop(VST3AudioThread* thread) {
+    if (!thread) return;
+    thread->stopping.store(true, std::memory_order_release);
+    if (thread->thread.joinable()) thread->thread.join();
+    unlock_memory(thread);
+    delete thread;
+}
+
+} // extern "C"
@@ -0,0 +1,183 @@
+// Serial plugin chains
+//
+// A chain runs its plugins in order inside one call per block. Stages pass
+// audio through two scratch buffers used alternately (ping-pong): the first
+// active stage reads the caller's input, the last writes the caller's output,
+// and everything in between only swaps pointers. Bypassed stages are skipped.
+// The chain does not own its plugins.
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "vst3_host_internal.h"
+
+namespace {
+
+// Scratch channels start on cache-line (and widest SIMD register) boundaries
+const size_t kBufferAlignment = 64;
+
+struct ChainStage {
+    VST3Plugin* plugin;
+    std::atomic<bool> bypass;
+
+    explicit ChainStage(VST3Plugin* p) : plugin(p), bypass(false) {}
+};
+
+} // namespace
+
+struct VST3Chain {
+    int32_t num_channels;
+    int32_t max_block_size;
+    size_t channel_stride;              // Floats between scratch channels
+
+    std::vector<std::unique_ptr<ChainStage>> stages;
+
+    float* scratch;                     // Two buffers of num_channels channels
+    std::vector<float*> buffers[2];     // Channel pointers into scratch
+    std::vector<float*> stage_inputs;   // Per-stage pointers, sized num_channels
+    std::vector<float*> stage_outputs;
+    std::vector<int32_t> active;        // Stages not bypassed in this block
+};
+
+static void copy_channels(float** dest, float* const* src, int32_t numChannels, int32_t numSamples) {
+    for (int32_t ch = 0; ch < numChannels; ch++) {
+        if (dest[ch] != src[ch]) {
+            memcpy(dest[ch], src[ch], sizeof(float) * numSamples);
+        }
+    }
+}
+
+int32_t chain_channels(const VST3Chain* chain) {
+    return chain->num_channels;
+}
+
+extern "C" {
+
+VST3Chain* vst3_chain_create(int32_t num_channels, int32_t max_block_size) {
+    if (num_channels <= 0 || max_block_size <= 0) return nullptr;
+
+    VST3Chain* chain = new VST3Chain();
+    chain->num_channels = num_channels;
+    chain->max_block_size = max_block_size;
+
+    size_t floatsPerLine = kBufferAlignment / sizeof(float);
+    chain->channel_stride = (static_cast<size_t>(max_block_size) + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+
+    void* memory = nullptr;
+    size_t bytes = 2 * num_channels * chain->channel_stride * sizeof(float);
+    if (posix_memalign(&memory, kBufferAlignment, bytes) != 0) {
+        delete chain;
+        return nullptr;
+    }
+    memset(memory, 0, bytes);
+    chain->scratch = static_cast<float*>(memory);
+
+    for (int b = 0; b < 2; b++) {
+        chain->buffers[b].resize(num_channels);
+        for (int32_t ch = 0; ch < num_channels; ch++) {
+            chain->buffers[b][ch] = chain->scratch + (b * num_channels + ch) * chain->channel_stride;
+        }
+    }
+    chain->stage_inputs.resize(num_channels);
+    chain->stage_outputs.resize(num_channels);
+
+    return chain;
+}
+
+int32_t vst3_chain_add(VST3Chain* chain, VST3Plugin* plugin) {
+    if (!chain || !plugin || !plugin->processor) return -1;
+
+    if (plugin->max_block_size < chain->max_block_size) {
+        fprintf(stderr, "Error: Plugin is set up for blocks of %d samples, chain needs %d\n",
+                plugin->max_block_size, chain->max_block_size);
+        return -1;
+    }
+
+    chain->stages.emplace_back(new ChainStage(plugin));
+    chain->active.reserve(chain->stages.size());
+    return static_cast<int32_t>(chain->stages.size()) - 1;
+}
+
+int32_t vst3_chain_size(VST3Chain* chain) {
+    if (!chain) return 0;
+    return static_cast<int32_t>(chain->stages.size());
+}
+
+int vst3_chain_set_bypass(VST3Chain* chain, int32_t index, int bypass) {
+    if (!chain || index < 0 || index >= static_cast<int32_t>(chain->stages.size())) return -1;
+    chain->stages[index]->bypass.store(bypass != 0, std::memory_order_relaxed);
+    return 0;
+}
+
+int vst3_chain_process(VST3Chain* chain, float** inputs, float** outputs, int32_t num_samples) {
+    if (!chain || !inputs || !outputs || num_samples < 0 || num_samples > chain->max_block_size) return -1;
+
+    const int32_t width = chain->num_channels;
+
+    chain->active.clear();
+    for (size_t i = 0; i < chain->stages.size(); i++) {
+        if (!chain->stages[i]->bypass.load(std::memory_order_relaxed)) {
+            chain->active.push_back(static_cast<int32_t>(i));
+        }
+    }
+
+    if (chain->active.empty()) {
+        copy_channels(outputs, inputs, width, num_samples);
+        return 0;
+    }
+
+    int result = 0;
+    float** source = inputs;
+    const size_t last = chain->active.size() - 1;
+
+    for (size_t k = 0; k < chain->active.size(); k++) {
+        VST3Plugin* plugin = chain->stages[chain->active[k]]->plugin;
+        float** dest = k == last ? outputs : chain->buffers[k % 2].data();
+
+        int32_t numIn = plugin->num_inputs < width ? plugin->num_inputs : width;
+        int32_t numOut = plugin->num_outputs < width ? plugin->num_outputs : width;
+        for (int32_t ch = 0; ch < width; ch++) {
+            chain->stage_inputs[ch] = source[ch];
+            chain->stage_outputs[ch] = dest[ch];
+        }
+
+        if (vst3_process(plugin, chain->stage_inputs.data(), chain->stage_outputs.data(),
+                         num_samples, numIn, numOut) != 0) {
+            result = -1;
+        }
+
+        // Channels the plugin does not produce pass through unchanged
+        if (numOut < width) {
+            copy_channels(dest + numOut, source + numOut, width - numOut, num_samples);
+        }
+
+        source = dest;
+    }
+
+    return result;
+}
+
+int32_t vst3_chain_get_latency(VST3Chain* chain) {
+    if (!chain) return 0;
+
+    int32_t latency = 0;
+    for (auto& stage : chain->stages) {
+        if (!stage->bypass.load(std::memory_order_relaxed)) {
+            latency += stage->plugin->latency_samples.load(std::memory_order_relaxed);
+        }
+    }
+    return latency;
+}
+
+void vst3_chain_free(VST3Chain* chain) {
+    if (!chain) return;
+    free(chain->scratch);
+    delete chain;
+}
+
+} // extern "C"
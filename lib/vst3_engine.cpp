@@ -0,0 +1,72 @@
+// Parallel processing of many independent plugin instances
+//
+// vst3_process_many runs one block of every job on a process-wide
+// work-stealing pool. The caller's thread works too, and the call returns when
+// every job has finished.
+
+#include "vst3_host.h"
+
+#include <mutex>
+
+#include "vst3_host_internal.h"
+#include "vst3_work_pool.h"
+
+namespace {
+
+struct ProcessBatch {
+    VST3ProcessJob* jobs;
+    int32_t num_samples;
+};
+
+// Batches are serialized; the order buffer keeps its capacity between them
+std::mutex gEngineMutex;
+std::unique_ptr<WorkStealingPool> gEnginePool;
+std::vector<int32_t> gJobOrder;
+
+void run_job(void* context, int32_t index, int32_t /*worker*/) {
+    ProcessBatch* batch = static_cast<ProcessBatch*>(context);
+    VST3ProcessJob& job = batch->jobs[index];
+
+    for (int32_t e = 0; e < job.num_events; e++) {
+        queue_midi_event(job.plugin, &job.events[e]);
+    }
+    job.result = vst3_process(job.plugin, job.inputs, job.outputs, batch->num_samples,
+                              job.num_input_channels, job.num_output_channels);
+}
+
+} // namespace
+
+extern "C" {
+
+int vst3_set_process_threads(int32_t num_threads) {
+    std::lock_guard<std::mutex> lock(gEngineMutex);
+    gEnginePool.reset(new WorkStealingPool(num_threads));
+    return gEnginePool->size();
+}
+
+int vst3_process_many(VST3ProcessJob* jobs, int32_t num_jobs, int32_t num_samples) {
+    if (!jobs || num_jobs < 0) return -1;
+
+    std::lock_guard<std::mutex> lock(gEngineMutex);
+    if (!gEnginePool) {
+        gEnginePool.reset(new WorkStealingPool(0));
+    }
+
+    if (static_cast<int32_t>(gJobOrder.size()) < num_jobs) {
+        gJobOrder.resize(num_jobs);
+    }
+    for (int32_t i = 0; i < num_jobs; i++) {
+        gJobOrder[i] = i;
+    }
+
+    ProcessBatch batch = {jobs, num_samples};
+    gEnginePool->run(gJobOrder.data(), num_jobs, num_jobs, run_job, &batch);
+
+    int failed = 0;
+    for (int32_t i = 0; i < num_jobs; i++) {
+        if (jobs[i].result != 0) failed++;
+    }
+    return failed;
+}
+
+} // extern "C"
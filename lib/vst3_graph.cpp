@@ -0,0 +1,937 @@
+// Plugin processing graphs
+//
+// A graph wires plugins into an acyclic network: parallel buses, sends, summing
+// and sidechains. Compiling it orders the nodes topologically and assigns
+// scratch buffers by liveness: a buffer is handed to a later node once every
+// node that writes or reads it is certain to have finished. Since independent
+// branches run concurrently, "finished" means being an ancestor of the new
+// writer, not merely earlier in the order.
+//
+// Each block, nodes whose inputs are ready run on a work-stealing pool. Every
+// node counts its unfinished predecessors; whichever predecessor brings the
+// count to zero queues the node on its own worker, so nothing is locked per
+// node. The graph does not own its plugins.
+//
+// Latency compensation: every connection into a summing point (an input with
+// several sources, counting the sidechain, or the graph output) gets a ring
+// buffer delay line, preallocated at compile time. Before each block the path
+// latencies are recomputed if any plugin's latency changed, and each line is
+// set to delay its source by the difference to the slowest path into that point.
+// Lines of aligned paths run with zero delay, but are still written every block.
+//
+// Summing, send levels and gain run on the vectorized kernels of
+// vst3_kernels.h. Connection gains can change while processing: the new level
+// is ramped in across the next block. An input fed by one undelayed source at
+// unity gain is read from that source's buffer in place; every input still has a
+// mix buffer of its own, so a gain change never needs a recompile (which would
+// restart the delay lines from silence).
+//
+// Cost-aware ordering: each node keeps a moving average of its measured process
+// time. Before a block, every node's priority becomes its cost plus the most
+// expensive path below it, and ready work is queued so the most critical node
+// is taken next: roots are dealt in ascending priority (each worker starts on
+// its newest, highest one) and a finished node queues its ready successors in
+// ascending priority, so its own worker continues down the critical path while
+// thieves take the rest.
+//
+// Live edits: nodes and connections are edited on control threads, and compiling
+// publishes the new schedule with one atomic pointer swap that the processing
+// thread picks up at its next block. The processing thread never locks or frees
+// anything: the schedule is reached through that pointer, nodes are handed out
+// by the lock-free deques of vst3_work_pool.h, and idle workers are woken with a
+// semaphore post rather than a mutex and condition variable. It keeps an epoch
+// counter that is odd while a block runs; replaced schedules (and removed plugins
+// to unload) are retired with the epoch seen after the swap and released by a
+// reclaimer thread once no block can still be using them. Edits never reconfigure
+// a plugin a block may be running: a node's first sidechain connection, which
+// activates its sidechain bus, is refused once the node has been compiled.
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "vst3_host_internal.h"
+#include "vst3_kernels.h"
+#include "vst3_work_pool.h"
+
+namespace {
+
+// Scratch channels start on cache-line (and widest SIMD register) boundaries
+const size_t kBufferAlignment = 64;
+
+// Buffer index standing for the caller's input channels
+const int32_t kInputBuffer = -1;
+
+// Weight of the newest measurement in a node's moving average cost
+const double kCostSmoothing = 0.1;
+
+// How often the reclaimer rechecks retired schedules still in use
+const int32_t kReclaimIntervalMs = 20;
+
+// Default largest path latency difference delay lines absorb without reallocating
+const int32_t kDefaultMaxLatency = 8192;
+
+struct Connection {
+    int32_t source;     // Node id or VST3_GRAPH_INPUT
+    int32_t dest;       // Node id or VST3_GRAPH_OUTPUT
+    float gain;
+    bool sidechain;
+    std::shared_ptr<std::atomic<float>> level;  // Live gain, shared with the schedules
+};
+
+struct Source {
+    int32_t buffer;     // Scratch buffer or kInputBuffer
+    float gain;         // Applied in the last block
+    const std::atomic<float>* level;    // Target gain
+    int32_t node;       // Index into GraphSchedule::nodes, -1 for the graph input
+    int32_t delay_line; // Index into GraphSchedule::delay_lines, -1 if not compensated
+};
+
+// Delays one connection into a summing point
+struct DelayLine {
+    std::vector<float*> channels;   // mask + 1 samples each
+    int32_t mask;                   // Capacity is a power of two
+    int32_t max_delay;              // Capacity less one block, so a block never overwrites unread input
+    int32_t delay;                  // Samples
+    int32_t position;               // Next write
+};
+
+struct ScheduledNode {
+    VST3Plugin* plugin;
+    std::vector<Source> inputs;         // Summed into the main input
+    std::vector<Source> sidechain;      // Summed into the sidechain input
+    int32_t input_buffer;               // Mix buffer of the main input
+    int32_t sidechain_buffer;           // Mix buffer of the sidechain, kInputBuffer without sources
+    int32_t output_buffer;
+
+    std::vector<int32_t> successors;    // Indices into GraphSchedule::nodes
+    int32_t num_predecessors;
+    std::atomic<int32_t> pending;       // Predecessors not yet finished in this block
+    int result;
+
+    int32_t latency;                    // Plugin latency the delays were computed for
+    int32_t arrival;                    // Latency of this node's output relative to the graph input
+
+    std::atomic<double> cost_ms;        // Moving average of the node's run time, read when recompiling
+    double priority_ms;                 // cost_ms plus the costliest path through its successors
+};
+
+} // namespace
+
+/* A compiled graph: nodes in topological order and their buffer assignment */
+struct GraphSchedule {
+    int32_t num_channels;
+    std::vector<std::unique_ptr<ScheduledNode>> nodes;
+    std::vector<int32_t> roots;         // Nodes without predecessors
+    std::vector<Source> outputs;        // Summed into the caller's output
+    std::vector<std::shared_ptr<std::atomic<float>>> levels;   // Keeps Source::level alive
+
+    float* memory;
+    std::vector<std::vector<float*>> buffers;   // Channel pointers into memory
+
+    float* delay_memory;
+    std::vector<DelayLine> delay_lines;
+    std::atomic<int32_t> latency;               // Of the graph output
+
+    // Per block
+    WorkStealingPool* pool;
+    float** graph_inputs;
+    int32_t num_samples;
+
+    GraphSchedule()
+        : num_channels(0), memory(nullptr), delay_memory(nullptr), latency(0),
+          pool(nullptr), graph_inputs(nullptr), num_samples(0) {}
+    ~GraphSchedule() {
+        free(memory);
+        free(delay_memory);
+    }
+};
+
+/* A schedule replaced by a compile, waiting until no block can be using it */
+struct RetiredSchedule {
+    GraphSchedule* schedule;
+    std::vector<VST3Plugin*> unload;    // Plugins removed with unload, referenced only by schedule
+    uint64_t epoch;                     // Processing epoch right after the swap
+};
+
+struct VST3Graph {
+    int32_t num_channels;
+    int32_t max_block_size;
+    size_t channel_stride;              // Floats between scratch channels
+    int32_t max_latency;                // Delay line capacity for the next compile
+
+    // Edited on control threads under edit_mutex
+    std::mutex edit_mutex;
+    std::vector<VST3Plugin*> nodes;             // nullptr for removed nodes, so ids stay stable
+    std::vector<Connection> connections;
+    std::vector<VST3Plugin*> pending_unload;    // Removed, but possibly in the published schedule
+
+    std::unique_ptr<WorkStealingPool> pool;
+    std::atomic<GraphSchedule*> schedule {nullptr};
+    std::atomic<uint64_t> epoch {0};            // Odd while a block is processed
+
+    std::mutex retire_mutex;
+    std::condition_variable retire_wake;
+    std::vector<RetiredSchedule> retired;
+    bool stopping = false;
+    std::thread reclaimer;
+
+    // Statistics of the last block, readable from any thread
+    std::atomic<double> predicted_ms {0.0};
+    std::atomic<double> actual_ms {0.0};
+    std::atomic<double> critical_path_ms {0.0};
+    std::atomic<double> total_work_ms {0.0};
+};
+
+static float** channels(GraphSchedule* s, int32_t buffer) {
+    return buffer == kInputBuffer ? s->graph_inputs : s->buffers[buffer].data();
+}
+
+// dst = or += gain * src, ramping the gain from `from` to `to`
+static void apply_gain(const MixKernels& k, float* dst, const float* src, int32_t n, bool first,
+                       float from, float to) {
+    if (n <= 0) return;
+    if (from != to) {
+        if (first) k.gain_ramp(dst, src, from, to, n);
+        else k.mul_add_ramp(dst, src, from, to, n);
+    } else if (first) {
+        k.copy_gain(dst, src, from, n);
+    } else if (from == 1.0f) {
+        k.add(dst, src, n);
+    } else {
+        k.mul_add(dst, src, from, n);
+    }
+}
+
+// Push a block of one channel into its delay line and mix the block that comes out.
+// Both may wrap around the end of the ring, so each is done in up to two pieces.
+// The line is written even at zero delay, so raising the delay later replays
+// this audio rather than whatever the ring held when the delay was last used.
+static void apply_delayed(const MixKernels& k, const DelayLine& line, int32_t ch, float* dst, const float* src,
+                          int32_t n, bool first, float from, float to) {
+    float* ring = line.channels[ch];
+    const int32_t capacity = line.mask + 1;
+
+    int32_t write = line.position;
+    int32_t head = std::min(n, capacity - write);
+    memcpy(ring + write, src, sizeof(float) * head);
+    memcpy(ring, src + head, sizeof(float) * (n - head));
+
+    if (line.delay == 0) {
+        apply_gain(k, dst, src, n, first, from, to);
+        return;
+    }
+
+    int32_t read = (write - line.delay) & line.mask;
+    head = std::min(n, capacity - read);
+    float split = from + (to - from) * head / n;
+    apply_gain(k, dst, ring + read, head, first, from, split);
+    apply_gain(k, dst + head, ring, n - head, first, split, to);
+}
+
+// Sum the sources, each delayed and scaled by its gain, into dest. No sources gives silence.
+static void mix_sources(GraphSchedule* s, std::vector<Source>& sources, float** dest, int32_t numSamples) {
+    const MixKernels& k = mix_kernels();
+
+    if (sources.empty()) {
+        for (int32_t ch = 0; ch < s->num_channels; ch++) {
+            k.clear(dest[ch], numSamples);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        Source& source = sources[i];
+        const float from = source.gain;
+        const float to = source.level->load(std::memory_order_relaxed);
+        const DelayLine* line = source.delay_line >= 0 ? &s->delay_lines[source.delay_line] : nullptr;
+        float** src = channels(s, source.buffer);
+
+        for (int32_t ch = 0; ch < s->num_channels; ch++) {
+            if (line) {
+                apply_delayed(k, *line, ch, dest[ch], src[ch], numSamples, i == 0, from, to);
+            } else {
+                apply_gain(k, dest[ch], src[ch], numSamples, i == 0, from, to);
+            }
+        }
+
+        source.gain = to;
+        if (line) {
+            s->delay_lines[source.delay_line].position = (line->position + numSamples) & line->mask;
+        }
+    }
+}
+
+// Buffer holding an input for this block: a lone undelayed source at unity gain (its
+// ramp finished) is read in place, anything else is mixed into the input's own buffer
+static int32_t gather(GraphSchedule* s, std::vector<Source>& sources, int32_t mixBuffer, int32_t numSamples) {
+    if (sources.size() == 1 && sources[0].delay_line < 0 && sources[0].gain == 1.0f &&
+        sources[0].level->load(std::memory_order_relaxed) == 1.0f) {
+        return sources[0].buffer;
+    }
+    mix_sources(s, sources, channels(s, mixBuffer), numSamples);
+    return mixBuffer;
+}
+
+static int32_t arrival(GraphSchedule* s, const Source& source) {
+    return source.node < 0 ? 0 : s->nodes[source.node]->arrival;
+}
+
+// Delay every compensated source to the slowest path into the summing point.
+// Returns the latency of that path.
+static int32_t align_sources(GraphSchedule* s, const std::vector<Source>& a, const std::vector<Source>& b) {
+    int32_t slowest = 0;
+    for (const Source& source : a) slowest = std::max(slowest, arrival(s, source));
+    for (const Source& source : b) slowest = std::max(slowest, arrival(s, source));
+
+    for (const std::vector<Source>* sources : {&a, &b}) {
+        for (const Source& source : *sources) {
+            if (source.delay_line < 0) continue;
+            DelayLine& line = s->delay_lines[source.delay_line];
+            line.delay = std::min(slowest - arrival(s, source), line.max_delay);
+        }
+    }
+    return slowest;
+}
+
+// Recompute path latencies and delays if a plugin's latency changed. Nodes are in
+// topological order, so sources are settled before the points they feed.
+static void update_latency(GraphSchedule* s) {
+    bool changed = false;
+    for (auto& node : s->nodes) {
+        int32_t latency = node->plugin->latency_samples.load(std::memory_order_relaxed);
+        if (latency != node->latency) {
+            node->latency = latency;
+            changed = true;
+        }
+    }
+    if (!changed) return;
+
+    for (auto& node : s->nodes) {
+        node->arrival = align_sources(s, node->inputs, node->sidechain) + node->latency;
+    }
+    static const std::vector<Source> none;
+    s->latency.store(align_sources(s, s->outputs, none), std::memory_order_relaxed);
+}
+
+static void run_node(void* context, int32_t index, int32_t worker) {
+    auto start = std::chrono::steady_clock::now();
+    GraphSchedule* s = static_cast<GraphSchedule*>(context);
+    ScheduledNode& node = *s->nodes[index];
+    VST3Plugin* plugin = node.plugin;
+    const int32_t width = s->num_channels;
+    const int32_t numSamples = s->num_samples;
+
+    float** in = channels(s, gather(s, node.inputs, node.input_buffer, numSamples));
+    float** out = channels(s, node.output_buffer);
+    float** side = node.sidechain.empty() ? nullptr
+                   : channels(s, gather(s, node.sidechain, node.sidechain_buffer, numSamples));
+
+    int32_t numIn = plugin->num_inputs < width ? plugin->num_inputs : width;
+    int32_t numOut = plugin->num_outputs < width ? plugin->num_outputs : width;
+    int32_t numSide = plugin->sidechain_channels < width ? plugin->sidechain_channels : width;
+
+    node.result = process_with_sidechain(plugin, in, out, numSamples, numIn, numOut, side, numSide);
+
+    // Channels the plugin does not produce pass through unchanged
+    for (int32_t ch = numOut; ch < width; ch++) {
+        memcpy(out[ch], in[ch], sizeof(float) * numSamples);
+    }
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double cost = node.cost_ms.load(std::memory_order_relaxed);
+    node.cost_ms.store(cost + kCostSmoothing * (elapsed - cost), std::memory_order_relaxed);
+
+    for (int32_t next : node.successors) {
+        if (s->nodes[next]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            s->pool->push(worker, next);
+        }
+    }
+}
+
+// Recompute priorities from the measured costs and order the ready queues by them.
+// Returns the critical path length; total work is added to totalWork.
+static double prioritize(GraphSchedule* s, double& totalWork) {
+    auto byPriority = [s](int32_t a, int32_t b) { return s->nodes[a]->priority_ms < s->nodes[b]->priority_ms; };
+
+    double critical = 0.0;
+    for (auto it = s->nodes.rbegin(); it != s->nodes.rend(); ++it) {
+        ScheduledNode& node = **it;
+        double below = 0.0;
+        for (int32_t next : node.successors) {
+            below = std::max(below, s->nodes[next]->priority_ms);
+        }
+        double cost = node.cost_ms.load(std::memory_order_relaxed);
+        node.priority_ms = cost + below;
+        critical = std::max(critical, node.priority_ms);
+        totalWork += cost;
+
+        std::sort(node.successors.begin(), node.successors.end(), byPriority);
+    }
+    std::sort(s->roots.begin(), s->roots.end(), byPriority);
+    return critical;
+}
+
+static bool valid_node(VST3Graph* graph, int32_t id) {
+    return id >= 0 && id < static_cast<int32_t>(graph->nodes.size()) && graph->nodes[id];
+}
+
+// Whether a block may be running the plugin: it is in the published schedule, or in a
+// replaced one the reclaimer has not released yet. Called with edit_mutex held.
+static bool plugin_in_use(VST3Graph* graph, VST3Plugin* plugin) {
+    auto contains = [plugin](const GraphSchedule* s) {
+        if (!s) return false;
+        for (auto& node : s->nodes) {
+            if (node->plugin == plugin) return true;
+        }
+        return false;
+    };
+
+    if (contains(graph->schedule.load(std::memory_order_acquire))) return true;
+    std::lock_guard<std::mutex> lock(graph->retire_mutex);
+    for (const RetiredSchedule& retired : graph->retired) {
+        if (contains(retired.schedule)) return true;
+    }
+    return false;
+}
+
+// Removed plugins are usually handed over active, and a component must not be
+// terminated while active
+static void unload_removed(VST3Plugin* plugin) {
+    if (plugin->active) {
+        vst3_set_active(plugin, 0);
+    }
+    vst3_unload_plugin(plugin);
+}
+
+static void release_retired(RetiredSchedule& retired) {
+    delete retired.schedule;
+    for (VST3Plugin* plugin : retired.unload) {
+        unload_removed(plugin);
+    }
+}
+
+// Hand a replaced schedule to the reclaimer. Called after the new one is published.
+static void retire(VST3Graph* graph, GraphSchedule* schedule, std::vector<VST3Plugin*> unload) {
+    RetiredSchedule retired{schedule, std::move(unload), graph->epoch.load(std::memory_order_seq_cst)};
+    {
+        std::lock_guard<std::mutex> lock(graph->retire_mutex);
+        graph->retired.push_back(std::move(retired));
+    }
+    graph->retire_wake.notify_one();
+}
+
+// A retired schedule is unused once no block was running at the swap (even epoch),
+// or the block that was running has finished.
+static void reclaimer_main(VST3Graph* graph) {
+    std::unique_lock<std::mutex> lock(graph->retire_mutex);
+    while (!graph->stopping) {
+        if (graph->retired.empty()) {
+            graph->retire_wake.wait(lock, [graph] { return graph->stopping || !graph->retired.empty(); });
+        } else {
+            graph->retire_wake.wait_for(lock, std::chrono::milliseconds(kReclaimIntervalMs));
+        }
+
+        uint64_t epoch = graph->epoch.load(std::memory_order_seq_cst);
+        std::vector<RetiredSchedule> unused;
+        auto& retired = graph->retired;
+        for (auto it = retired.begin(); it != retired.end();) {
+            if (it->epoch % 2 == 0 || epoch > it->epoch) {
+                unused.push_back(std::move(*it));
+                it = retired.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        lock.unlock();
+        for (RetiredSchedule& r : unused) {
+            release_retired(r);
+        }
+        lock.lock();
+    }
+}
+
+static int add_connection(VST3Graph* graph, int32_t source, int32_t dest, float gain, bool sidechain) {
+    for (Connection& c : graph->connections) {
+        if (c.source == source && c.dest == dest && c.sidechain == sidechain) {
+            c.gain = gain;
+            c.level->store(gain, std::memory_order_relaxed);
+            return 0;
+        }
+    }
+    graph->connections.push_back(Connection{source, dest, gain, sidechain,
+                                            std::make_shared<std::atomic<float>>(gain)});
+    return 0;
+}
+
+// One block of a published schedule
+static int process_schedule(VST3Graph* graph, GraphSchedule* s, float** inputs, float** outputs,
+                            int32_t num_samples) {
+    s->pool = graph->pool.get();
+    s->graph_inputs = inputs;
+    s->num_samples = num_samples;
+    update_latency(s);
+
+    double totalWork = 0.0;
+    double critical = prioritize(s, totalWork);
+    const int32_t numWorkers = s->pool->size();
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto& node : s->nodes) {
+        node->pending.store(node->num_predecessors, std::memory_order_relaxed);
+        node->result = 0;
+    }
+
+    const int32_t numNodes = static_cast<int32_t>(s->nodes.size());
+    s->pool->run(s->roots.data(), static_cast<int32_t>(s->roots.size()), numNodes, run_node, s);
+
+    mix_sources(s, s->outputs, outputs, num_samples);
+
+    // Neither the critical path nor the work shared evenly can be beaten
+    graph->critical_path_ms.store(critical, std::memory_order_relaxed);
+    graph->total_work_ms.store(totalWork, std::memory_order_relaxed);
+    graph->predicted_ms.store(std::max(critical, totalWork / numWorkers), std::memory_order_relaxed);
+    graph->actual_ms.store(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+                           std::memory_order_relaxed);
+
+    int result = 0;
+    for (auto& node : s->nodes) {
+        if (node->result != 0) result = -1;
+    }
+    return result;
+}
+
+int32_t graph_channels(const VST3Graph* graph) {
+    return graph->num_channels;
+}
+
+extern "C" {
+
+VST3Graph* vst3_graph_create(int32_t num_channels, int32_t max_block_size, int32_t num_threads) {
+    if (num_channels <= 0 || max_block_size <= 0) return nullptr;
+
+    VST3Graph* graph = new VST3Graph();
+    graph->num_channels = num_channels;
+    graph->max_block_size = max_block_size;
+    graph->max_latency = kDefaultMaxLatency;
+
+    size_t floatsPerLine = kBufferAlignment / sizeof(float);
+    graph->channel_stride = (static_cast<size_t>(max_block_size) + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+
+    graph->pool.reset(new WorkStealingPool(num_threads));
+    graph->reclaimer = std::thread(reclaimer_main, graph);
+    return graph;
+}
+
+int32_t vst3_graph_add_node(VST3Graph* graph, VST3Plugin* plugin) {
+    if (!graph || !plugin || !plugin->processor) return -1;
+
+    if (plugin->max_block_size < graph->max_block_size) {
+        fprintf(stderr, "Error: Plugin is set up for blocks of %d samples, graph needs %d\n",
+                plugin->max_block_size, graph->max_block_size);
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    graph->nodes.push_back(plugin);
+    return static_cast<int32_t>(graph->nodes.size()) - 1;
+}
+
+int vst3_graph_remove_node(VST3Graph* graph, int32_t node, int unload) {
+    if (!graph) return -1;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    if (!valid_node(graph, node)) return -1;
+
+    auto& connections = graph->connections;
+    connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                     [&](const Connection& c) { return c.source == node || c.dest == node; }),
+                      connections.end());
+
+    if (unload) {
+        graph->pending_unload.push_back(graph->nodes[node]);
+    }
+    graph->nodes[node] = nullptr;
+    return 0;
+}
+
+int vst3_graph_connect(VST3Graph* graph, int32_t source, int32_t dest, float gain) {
+    if (!graph) return -1;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    if (source != VST3_GRAPH_INPUT && !valid_node(graph, source)) return -1;
+    if (dest != VST3_GRAPH_OUTPUT && !valid_node(graph, dest)) return -1;
+    if (source == dest) return -1;
+
+    return add_connection(graph, source, dest, gain, false);
+}
+
+int vst3_graph_connect_sidechain(VST3Graph* graph, int32_t source, int32_t dest, float gain) {
+    if (!graph) return -1;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    if (!valid_node(graph, dest)) return -1;
+    if (source != VST3_GRAPH_INPUT && !valid_node(graph, source)) return -1;
+    if (source == dest) return -1;
+
+    // Activating the bus deactivates the plugin and reallocates its process data, so
+    // it has to happen before any schedule can run the node
+    VST3Plugin* plugin = graph->nodes[dest];
+    if (plugin->sidechain_bus < 0 && plugin_in_use(graph, plugin)) {
+        fprintf(stderr, "Error: Connect the sidechain of node %d before it is first compiled\n", dest);
+        return -1;
+    }
+
+    int32_t numChannels = enable_sidechain(plugin);
+    if (numChannels <= 0) {
+        if (numChannels == 0) {
+            fprintf(stderr, "Error: Plugin has no sidechain input\n");
+        }
+        return -1;
+    }
+
+    return add_connection(graph, source, dest, gain, true);
+}
+
+int vst3_graph_disconnect(VST3Graph* graph, int32_t source, int32_t dest) {
+    if (!graph) return -1;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    auto& connections = graph->connections;
+    size_t before = connections.size();
+    connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                     [&](const Connection& c) { return c.source == source && c.dest == dest; }),
+                      connections.end());
+    return connections.size() < before ? 0 : -1;
+}
+
+// vst3_graph_compile with edit_mutex held
+static int compile_locked(VST3Graph* graph) {
+    const int32_t n = static_cast<int32_t>(graph->nodes.size());
+
+    // Predecessors of each node, counting a source feeding both inputs once
+    std::vector<std::vector<int32_t>> successors(n);
+    std::vector<std::vector<int32_t>> consumers(n);
+    std::vector<bool> feedsOutput(n, false);
+    for (const Connection& c : graph->connections) {
+        if (c.source == VST3_GRAPH_INPUT) continue;
+        if (c.dest == VST3_GRAPH_OUTPUT) {
+            feedsOutput[c.source] = true;
+        } else {
+            successors[c.source].push_back(c.dest);
+        }
+    }
+
+    std::vector<int32_t> indegree(n, 0);
+    for (int32_t v = 0; v < n; v++) {
+        auto& next = successors[v];
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+        for (int32_t d : next) indegree[d]++;
+        consumers[v] = next;
+    }
+
+    // Kahn's algorithm over the nodes not removed
+    std::vector<int32_t> order;
+    order.reserve(n);
+    std::vector<int32_t> remaining = indegree;
+    int32_t numLive = 0;
+    for (int32_t v = 0; v < n; v++) {
+        if (!graph->nodes[v]) continue;
+        numLive++;
+        if (remaining[v] == 0) order.push_back(v);
+    }
+    for (size_t k = 0; k < order.size(); k++) {
+        for (int32_t d : successors[order[k]]) {
+            if (--remaining[d] == 0) order.push_back(d);
+        }
+    }
+    if (static_cast<int32_t>(order.size()) < numLive) {
+        fprintf(stderr, "Error: Graph connections form a cycle\n");
+        return -1;
+    }
+
+    // ancestors[v][u]: u always finishes before v starts
+    std::vector<std::vector<bool>> ancestors(n, std::vector<bool>(n, false));
+    for (int32_t v : order) {
+        for (int32_t d : successors[v]) {
+            ancestors[d][v] = true;
+            for (int32_t u = 0; u < n; u++) {
+                if (ancestors[v][u]) ancestors[d][u] = true;
+            }
+        }
+    }
+
+    // Liveness-based assignment: a buffer is free for a writer once all nodes using it
+    // are its ancestors. Buffers feeding the graph output stay live until the block ends.
+    struct BufferUse {
+        std::vector<int32_t> users;
+        bool pinned;
+    };
+    std::vector<BufferUse> uses;
+    auto allocate = [&](int32_t writer) -> int32_t {
+        for (size_t b = 0; b < uses.size(); b++) {
+            if (uses[b].pinned) continue;
+            bool available = true;
+            for (int32_t u : uses[b].users) {
+                if (u == writer || !ancestors[writer][u]) {
+                    available = false;
+                    break;
+                }
+            }
+            if (available) {
+                uses[b].users.assign(1, writer);
+                return static_cast<int32_t>(b);
+            }
+        }
+        uses.push_back(BufferUse{std::vector<int32_t>(1, writer), false});
+        return static_cast<int32_t>(uses.size()) - 1;
+    };
+
+    std::unique_ptr<GraphSchedule> schedule(new GraphSchedule());
+    schedule->num_channels = graph->num_channels;
+
+    std::vector<int32_t> position(n, -1);
+    for (int32_t k = 0; k < numLive; k++) {
+        position[order[k]] = k;
+    }
+
+    // Only compiles replace the published schedule, so it stays valid under edit_mutex
+    GraphSchedule* previous = graph->schedule.load(std::memory_order_acquire);
+    std::unordered_map<VST3Plugin*, double> previousCost;
+    if (previous) {
+        for (auto& node : previous->nodes) {
+            previousCost[node->plugin] = node->cost_ms.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<int32_t> outputBuffer(n, kInputBuffer);
+    int32_t numDelayLines = 0;
+    auto make_source = [&](const Connection& c) {
+        bool external = c.source == VST3_GRAPH_INPUT;
+        schedule->levels.push_back(c.level);
+        return Source{external ? kInputBuffer : outputBuffer[c.source], c.gain, c.level.get(),
+                      external ? -1 : position[c.source], -1};
+    };
+
+    for (int32_t k = 0; k < numLive; k++) {
+        int32_t v = order[k];
+        std::unique_ptr<ScheduledNode> node(new ScheduledNode());
+        node->plugin = graph->nodes[v];
+        node->num_predecessors = indegree[v];
+        node->result = 0;
+
+        node->latency = -1;
+        node->arrival = 0;
+        node->priority_ms = 0.0;
+
+        // Costs measured under the previous schedule carry over
+        auto measured = previousCost.find(node->plugin);
+        node->cost_ms.store(measured != previousCost.end() ? measured->second : 0.0, std::memory_order_relaxed);
+
+        // Predecessors come earlier in the order, so their buffers are assigned
+        for (const Connection& c : graph->connections) {
+            if (c.dest != v) continue;
+            (c.sidechain ? node->sidechain : node->inputs).push_back(make_source(c));
+        }
+        if (node->inputs.size() + node->sidechain.size() > 1) {
+            for (Source& src : node->inputs) src.delay_line = numDelayLines++;
+            for (Source& src : node->sidechain) src.delay_line = numDelayLines++;
+        }
+
+        // Allocated even where the source is read in place, for when its gain moves off 1
+        node->input_buffer = allocate(v);
+        node->sidechain_buffer = node->sidechain.empty() ? kInputBuffer : allocate(v);
+
+        int32_t out = allocate(v);
+        for (int32_t d : consumers[v]) {
+            uses[out].users.push_back(d);
+        }
+        uses[out].pinned = feedsOutput[v];
+        outputBuffer[v] = out;
+        node->output_buffer = out;
+
+        for (int32_t d : successors[v]) {
+            node->successors.push_back(position[d]);
+        }
+        if (indegree[v] == 0) {
+            schedule->roots.push_back(k);
+        }
+        schedule->nodes.push_back(std::move(node));
+    }
+
+    for (const Connection& c : graph->connections) {
+        if (c.dest != VST3_GRAPH_OUTPUT) continue;
+        schedule->outputs.push_back(make_source(c));
+    }
+    if (schedule->outputs.size() > 1) {
+        for (Source& src : schedule->outputs) src.delay_line = numDelayLines++;
+    }
+
+    const int32_t numBuffers = static_cast<int32_t>(uses.size());
+    if (numBuffers > 0) {
+        void* memory = nullptr;
+        size_t bytes = static_cast<size_t>(numBuffers) * graph->num_channels * graph->channel_stride * sizeof(float);
+        if (posix_memalign(&memory, kBufferAlignment, bytes) != 0) {
+            fprintf(stderr, "Error: Failed to allocate graph buffers\n");
+            return -1;
+        }
+        memset(memory, 0, bytes);
+        schedule->memory = static_cast<float*>(memory);
+    }
+
+    schedule->buffers.resize(numBuffers);
+    for (int32_t b = 0; b < numBuffers; b++) {
+        schedule->buffers[b].resize(graph->num_channels);
+        for (int32_t ch = 0; ch < graph->num_channels; ch++) {
+            schedule->buffers[b][ch] = schedule->memory +
+                (static_cast<size_t>(b) * graph->num_channels + ch) * graph->channel_stride;
+        }
+    }
+
+    // Delay lines hold the configured maximum, or more if the current latencies need it
+    int32_t longest = 0;
+    for (auto& node : schedule->nodes) {
+        int32_t slowest = 0;
+        for (const Source& src : node->inputs) slowest = std::max(slowest, arrival(schedule.get(), src));
+        for (const Source& src : node->sidechain) slowest = std::max(slowest, arrival(schedule.get(), src));
+        node->arrival = slowest + node->plugin->latency_samples.load(std::memory_order_relaxed);
+        longest = std::max(longest, node->arrival);
+    }
+    int32_t capacity = 1;
+    while (capacity < std::max(graph->max_latency, longest) + graph->max_block_size) capacity <<= 1;
+
+    if (numDelayLines > 0) {
+        void* memory = nullptr;
+        size_t bytes = static_cast<size_t>(numDelayLines) * graph->num_channels * capacity * sizeof(float);
+        if (posix_memalign(&memory, kBufferAlignment, bytes) != 0) {
+            fprintf(stderr, "Error: Failed to allocate graph delay lines\n");
+            return -1;
+        }
+        memset(memory, 0, bytes);
+        schedule->delay_memory = static_cast<float*>(memory);
+    }
+
+    schedule->delay_lines.resize(numDelayLines);
+    for (int32_t l = 0; l < numDelayLines; l++) {
+        DelayLine& line = schedule->delay_lines[l];
+        line.mask = capacity - 1;
+        line.max_delay = capacity - graph->max_block_size;
+        line.delay = 0;
+        line.position = 0;
+        line.channels.resize(graph->num_channels);
+        for (int32_t ch = 0; ch < graph->num_channels; ch++) {
+            line.channels[ch] = schedule->delay_memory +
+                (static_cast<size_t>(l) * graph->num_channels + ch) * capacity;
+        }
+    }
+    update_latency(schedule.get());
+
+    graph->schedule.store(schedule.release(), std::memory_order_seq_cst);
+    if (previous || !graph->pending_unload.empty()) {
+        retire(graph, previous, std::move(graph->pending_unload));
+        graph->pending_unload.clear();
+    }
+    return 0;
+}
+
+int vst3_graph_compile(VST3Graph* graph) {
+    if (!graph) return -1;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    return compile_locked(graph);
+}
+
+int vst3_graph_set_gain(VST3Graph* graph, int32_t source, int32_t dest, float gain) {
+    if (!graph) return -1;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    bool found = false;
+    for (Connection& c : graph->connections) {
+        if (c.source != source || c.dest != dest) continue;
+        c.gain = gain;
+        c.level->store(gain, std::memory_order_relaxed);
+        found = true;
+    }
+    return found ? 0 : -1;
+}
+
+int vst3_graph_process(VST3Graph* graph, float** inputs, float** outputs, int32_t num_samples) {
+    if (!graph || !inputs || !outputs || num_samples < 0 || num_samples > graph->max_block_size) return -1;
+
+    // Enter the epoch before loading the schedule so a concurrent compile cannot
+    // retire it as unused while this block runs
+    graph->epoch.fetch_add(1, std::memory_order_seq_cst);
+    GraphSchedule* s = graph->schedule.load(std::memory_order_seq_cst);
+    int result = s ? process_schedule(graph, s, inputs, outputs, num_samples) : -1;
+    graph->epoch.fetch_add(1, std::memory_order_release);
+    return result;
+}
+
+int vst3_graph_set_max_latency(VST3Graph* graph, int32_t max_latency) {
+    if (!graph || max_latency < 0) return -1;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    graph->max_latency = max_latency;
+    return 0;
+}
+
+int32_t vst3_graph_get_latency(VST3Graph* graph) {
+    if (!graph) return 0;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    GraphSchedule* s = graph->schedule.load(std::memory_order_acquire);
+    return s ? s->latency.load(std::memory_order_relaxed) : 0;
+}
+
+int vst3_graph_get_stats(VST3Graph* graph, VST3GraphStats* stats) {
+    if (!graph || !stats) return -1;
+
+    stats->predicted_ms = graph->predicted_ms.load(std::memory_order_relaxed);
+    stats->actual_ms = graph->actual_ms.load(std::memory_order_relaxed);
+    stats->critical_path_ms = graph->critical_path_ms.load(std::memory_order_relaxed);
+    stats->total_work_ms = graph->total_work_ms.load(std::memory_order_relaxed);
+    stats->num_workers = graph->pool->size();
+    return 0;
+}
+
+int32_t vst3_graph_buffer_count(VST3Graph* graph) {
+    if (!graph) return 0;
+
+    std::lock_guard<std::mutex> lock(graph->edit_mutex);
+    GraphSchedule* s = graph->schedule.load(std::memory_order_acquire);
+    return s ? static_cast<int32_t>(s->buffers.size()) : 0;
+}
+
+void vst3_graph_free(VST3Graph* graph) {
+    if (!graph) return;
+
+    {
+        std::lock_guard<std::mutex> lock(graph->retire_mutex);
+        graph->stopping = true;
+    }
+    graph->retire_wake.notify_one();
+    graph->reclaimer.join();
+
+    for (RetiredSchedule& retired : graph->retired) {
+        release_retired(retired);
+    }
+    delete graph->schedule.load();
+    for (VST3Plugin* plugin : graph->pending_unload) {
+        unload_removed(plugin);
+    }
+    delete graph;
+}
+
+} // extern "C"
@@ -2,116 +2,354 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <vector>
-#include <memory>
-
-// VST3 SDK includes
-#include "public.sdk/source/vst/hosting/module.h"
-#include "public.sdk/source/vst/hosting/plugprovider.h"
-#include "public.sdk/source/vst/hosting/hostclasses.h"
-#include "public.sdk/source/vst/hosting/processdata.h"
-#include "public.sdk/source/vst/hosting/parameterchanges.h"
-#include "public.sdk/source/vst/hosting/eventlist.h"
+
+#include <mutex>
+
+#include "vst3_host_internal.h"
+
 #include "public.sdk/source/vst/utility/stringconvert.h"
-#include "pluginterfaces/vst/ivstaudioprocessor.h"
-#include "pluginterfaces/vst/ivsteditcontroller.h"
-#include "pluginterfaces/vst/ivstcomponent.h"
-#include "pluginterfaces/vst/ivstparameterchanges.h"
-#include "pluginterfaces/vst/ivstevents.h"
-#include "pluginterfaces/vst/vsttypes.h"
-
-using namespace Steinberg;
-using namespace Steinberg::Vst;
-
-// Global host context
-static FUnknown* gHostContext = nullptr;
-
-/* Plugin structure */
-struct VST3Plugin {
-    std::shared_ptr<VST3::Hosting::Module> module;
-    IPtr<IComponent> component;
-    IPtr<IAudioProcessor> processor;
-    IPtr<IEditController> controller;
-
-    int32_t num_inputs;
-    int32_t num_outputs;
-    double sample_rate;
-    int32_t max_block_size;
-
-    std::vector<float*> input_buffers;
-    std::vector<float*> output_buffers;
-
-    HostProcessData processData;
-    ParameterChanges inputParameterChanges;
-    ParameterChanges outputParameterChanges;
-    EventList inputEvents;
-    EventList outputEvents;
-};
+#include "public.sdk/source/common/memorystream.h"
+#include "pluginterfaces/vst/ivstmidicontrollers.h"
 
-extern "C" {
+// Global host context, created by vst3_init or the first load
+static std::mutex gHostMutex;
+static HostApplication* gHostContext = nullptr;
 
-VST3Plugin* vst3_load_plugin(const char* bundle_path) {
-    if (!bundle_path) {
-        fprintf(stderr, "Error: null bundle path\n");
-        return nullptr;
+// Instances alive across all modules; vst3_shutdown refuses to run while any exist
+static std::atomic<int32_t> gLiveInstances {0};
+
+// Capacity of the per-block event lists (input and output)
+static const int32 kMaxEventsPerBlock = 1024;
+
+// State blob layout written by vst3_save_state:
+//   magic 'VHST', uint32 version, uint64 component size, uint64 controller size,
+//   component state bytes, controller state bytes
+static const uint32_t kStateMagic = 0x54534856;  // 'VHST' little-endian
+static const uint32_t kStateVersion = 1;
+static const int64_t kStateHeaderSize = 24;
+
+/* Restart flags that need the plugin to be idle, applied by vst3_apply_restart or activation */
+static const int32 kDeferredRestartFlags = kReloadComponent | kIoChanged | kLatencyChanged |
+                                           kParamTitlesChanged | kParamIDMappingChanged;
+
+// Read channel counts of the main audio buses
+static void query_bus_layout(VST3Plugin* plugin) {
+    plugin->num_inputs = 0;
+    plugin->num_outputs = 0;
+
+    if (plugin->component->getBusCount(kAudio, kInput) > 0) {
+        BusInfo busInfo;
+        if (plugin->component->getBusInfo(kAudio, kInput, 0, busInfo) == kResultOk) {
+            plugin->num_inputs = busInfo.channelCount;
+        }
     }
 
-    // Initialize host context if not already done
-    if (!gHostContext) {
-        gHostContext = new HostApplication();
+    if (plugin->component->getBusCount(kAudio, kOutput) > 0) {
+        BusInfo busInfo;
+        if (plugin->component->getBusInfo(kAudio, kOutput, 0, busInfo) == kResultOk) {
+            plugin->num_outputs = busInfo.channelCount;
+        }
     }
+}
 
-    printf("Loading VST3 plugin from: %s\n", bundle_path);
+// Activate main buses, call setupProcessing and prepare the process data.
+// The component must be inactive.
+static int configure_processing(VST3Plugin* plugin) {
+    if (plugin->num_inputs > 0) {
+        plugin->component->activateBus(kAudio, kInput, 0, true);
+    }
 
-    // Create module
-    std::string error;
-    auto module = VST3::Hosting::Module::create(bundle_path, error);
-    if (!module) {
-        fprintf(stderr, "Error: Failed to load module: %s\n", error.c_str());
-        return nullptr;
+    if (plugin->num_outputs > 0) {
+        plugin->component->activateBus(kAudio, kOutput, 0, true);
     }
 
-    // Get factory
-    auto factory = module->getFactory();
+    if (plugin->sidechain_bus >= 0) {
+        plugin->component->activateBus(kAudio, kInput, plugin->sidechain_bus, true);
+        plugin->sidechain_silence.assign(plugin->max_block_size, 0.0f);
+    }
 
-    // Find the first audio effect class
-    VST3::Hosting::ClassInfo audioEffectClass;
-    bool found = false;
+    ProcessSetup setup;
+    setup.processMode = kRealtime;
+    setup.symbolicSampleSize = kSample32;
+    setup.maxSamplesPerBlock = plugin->max_block_size;
+    setup.sampleRate = plugin->sample_rate;
 
-    for (auto& classInfo : factory.classInfos()) {
-        if (classInfo.category() == kVstAudioEffectClass) {
-            audioEffectClass = classInfo;
-            found = true;
-            printf("Found audio effect: %s\n", classInfo.name().c_str());
-            break;
+    if (plugin->processor->setupProcessing(setup) != kResultOk) {
+        fprintf(stderr, "Error: setupProcessing failed\n");
+        return -1;
+    }
+
+    plugin->processData.prepare(*plugin->component, plugin->max_block_size, kSample32);
+
+    // Preallocate one queue per parameter so the plugin's output changes
+    // never allocate on the processing path
+    int32 numParams = plugin->controller ? plugin->controller->getParameterCount() : 0;
+    plugin->inputParameterChanges.setMaxParameters(numParams);
+    plugin->outputParameterChanges.setMaxParameters(numParams);
+
+    plugin->latency_samples.store(plugin->processor->getLatencySamples());
+    return 0;
+}
+
+// Apply restart requests recorded by restartComponent. Runs on a control thread while
+// the plugin is not processing; an active plugin is cycled through deactivation.
+static int32 apply_pending_restart(VST3Plugin* plugin) {
+    int32 flags = plugin->pending_restart.exchange(0);
+    if (flags == 0) return 0;
+
+    if (flags & (kParamTitlesChanged | kParamIDMappingChanged)) {
+        plugin->paramMailbox.drain(plugin->inputParameterChanges);
+        plugin->paramMailbox.rebuild(plugin->controller);
+        scan_program_lists(plugin);
+    }
+
+    // A new latency only takes effect across a deactivate/activate cycle, like a
+    // bus change
+    if (flags & (kIoChanged | kReloadComponent | kLatencyChanged)) {
+        bool wasActive = plugin->active;
+        if (wasActive) {
+            plugin->processor->setProcessing(false);
+            plugin->component->setActive(false);
+        }
+
+        if (flags & (kIoChanged | kReloadComponent)) {
+            query_bus_layout(plugin);
+            if (plugin->max_block_size > 0) {
+                configure_processing(plugin);
+            }
+        }
+
+        if (wasActive) {
+            plugin->component->setActive(true);
+            plugin->processor->setProcessing(true);
         }
+        plugin->latency_samples.store(plugin->processor->getLatencySamples());
     }
 
-    if (!found) {
-        fprintf(stderr, "Error: No audio effect class found in plugin\n");
+    return flags;
+}
+
+int capture_state(VST3Plugin* plugin, MemoryStream* componentStream, MemoryStream* controllerStream) {
+    if (plugin->component->getState(componentStream) != kResultOk) {
+        fprintf(stderr, "Error: Failed to get component state\n");
+        return -1;
+    }
+
+    if (plugin->controller && plugin->controller->getState(controllerStream) != kResultOk) {
+        // Controllers without state of their own are common; store an empty chunk
+        controllerStream->setSize(0);
+    } else if (plugin->controller_deferred && !plugin->deferred_controller_state.empty()) {
+        const std::vector<char>& state = plugin->deferred_controller_state;
+        int32 written = 0;
+        controllerStream->write(const_cast<char*>(state.data()), static_cast<int32>(state.size()), &written);
+    }
+
+    return 0;
+}
+
+int restore_state(VST3Plugin* plugin, const char* componentData, int64_t componentSize,
+                  const char* controllerData, int64_t controllerSize) {
+    if (componentSize > 0) {
+        auto stream = owned(new MemoryStream(const_cast<char*>(componentData), componentSize));
+        if (plugin->component->setState(stream) != kResultOk) {
+            fprintf(stderr, "Error: Component rejected state\n");
+            return -1;
+        }
+
+        if (plugin->controller) {
+            stream->seek(0, IBStream::kIBSeekSet, nullptr);
+            plugin->controller->setComponentState(stream);
+        }
+    }
+
+    // Held until a deferred controller is created
+    if (controllerSize > 0 && plugin->controller_deferred) {
+        plugin->deferred_controller_state.assign(controllerData, controllerData + controllerSize);
+    }
+
+    if (controllerSize > 0 && plugin->controller) {
+        auto stream = owned(new MemoryStream(const_cast<char*>(controllerData), controllerSize));
+        if (plugin->controller->setState(stream) != kResultOk) {
+            fprintf(stderr, "Error: Controller rejected state\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int flush_parameters(VST3Plugin* plugin) {
+    if (!plugin->processor || plugin->max_block_size <= 0) return -1;
+
+    HostProcessData& data = plugin->processData;
+    int32 numInputs = data.numInputs;
+    int32 numOutputs = data.numOutputs;
+
+    data.processContext = nullptr;
+    data.numSamples = 0;
+    data.numInputs = 0;
+    data.numOutputs = 0;
+    data.inputParameterChanges = &plugin->inputParameterChanges;
+    data.outputParameterChanges = &plugin->outputParameterChanges;
+    data.inputEvents = nullptr;
+    data.outputEvents = nullptr;
+
+    plugin->outputParameterChanges.clearQueue();
+    plugin->paramMailbox.drain(plugin->inputParameterChanges);
+
+    tresult result = plugin->processor->process(data);
+
+    data.numInputs = numInputs;
+    data.numOutputs = numOutputs;
+    plugin->inputParameterChanges.clearQueue();
+
+    return result == kResultOk ? 0 : -1;
+}
+
+tresult PLUGIN_API HostComponentHandler::beginEdit(ParamID /*id*/) {
+    plugin->edits_in_progress.fetch_add(1);
+    return kResultOk;
+}
+
+tresult PLUGIN_API HostComponentHandler::performEdit(ParamID id, ParamValue valueNormalized) {
+    return plugin->paramMailbox.post(id, valueNormalized) ? kResultOk : kInvalidArgument;
+}
+
+tresult PLUGIN_API HostComponentHandler::endEdit(ParamID /*id*/) {
+    plugin->edits_in_progress.fetch_sub(1);
+    return kResultOk;
+}
+
+tresult PLUGIN_API HostComponentHandler::restartComponent(int32 flags) {
+    // Reconfiguring is left to the host's control thread (vst3_apply_restart); reporting
+    // every flag right away tells the host that it is needed
+    int32 deferred = flags & kDeferredRestartFlags;
+    if (deferred) {
+        plugin->pending_restart.fetch_or(deferred);
+    }
+
+    plugin->reported_restart.fetch_or(flags);
+    return kResultOk;
+}
+
+// Create, initialize and connect the edit controller of a component, if it has one
+static void create_controller(VST3Plugin* plugin) {
+    TUID controllerCID;
+    if (plugin->component->getControllerClassId(controllerCID) != kResultOk) return;
+
+    plugin->controller = plugin->module->factory().createInstance<IEditController>(VST3::UID(controllerCID));
+    if (!plugin->controller) return;
+
+    plugin->controller->initialize(host_context());
+    plugin->controller->setComponentHandler(plugin->componentHandler.get());
+
+    // Connect component and controller
+    FUnknownPtr<IConnectionPoint> componentCP(plugin->component);
+    FUnknownPtr<IConnectionPoint> controllerCP(plugin->controller);
+
+    if (componentCP && controllerCP) {
+        componentCP->connect(controllerCP);
+        controllerCP->connect(componentCP);
+    }
+}
+
+IEditController* ensure_controller(VST3Plugin* plugin) {
+    if (!plugin->controller_deferred) return plugin->controller;
+
+    // Creating it resizes the parameter queues and swaps the mailbox table, which an
+    // active plugin's processing thread may be using
+    if (plugin->active) {
+        fprintf(stderr, "Error: Cannot create the deferred controller while the plugin is active\n");
         return nullptr;
     }
+    plugin->controller_deferred = false;
+
+    create_controller(plugin);
+    if (!plugin->controller) {
+        plugin->deferred_controller_state.clear();
+        return nullptr;
+    }
+
+    // Bring the new controller up to date with the component, then apply any
+    // controller state restored while it did not exist
+    auto componentState = owned(new MemoryStream());
+    if (plugin->component->getState(componentState) == kResultOk) {
+        componentState->seek(0, IBStream::kIBSeekSet, nullptr);
+        plugin->controller->setComponentState(componentState);
+    }
+    if (!plugin->deferred_controller_state.empty()) {
+        std::vector<char>& state = plugin->deferred_controller_state;
+        auto stream = owned(new MemoryStream(state.data(), static_cast<TSize>(state.size())));
+        plugin->controller->setState(stream);
+        state.clear();
+        state.shrink_to_fit();
+    }
+
+    // Never reached while active, so nothing here races processing
+    int32 numParams = plugin->controller->getParameterCount();
+    plugin->inputParameterChanges.setMaxParameters(numParams);
+    plugin->outputParameterChanges.setMaxParameters(numParams);
+    plugin->paramMailbox.rebuild(plugin->controller);
+    scan_program_lists(plugin);
+
+    return plugin->controller;
+}
+
+// host_context for a new instance: also counts the instance as live
+static FUnknown* retain_host_context() {
+    std::lock_guard<std::mutex> lock(gHostMutex);
+    if (!gHostContext) {
+        gHostContext = new HostApplication();
+    }
+    gLiveInstances.fetch_add(1);
+    return gHostContext;
+}
+
+// Free an instance that failed to come up after retain_host_context
+static void discard_instance(VST3Plugin* plugin) {
+    delete plugin;
+    gLiveInstances.fetch_sub(1);
+}
+
+VST3Plugin* instantiate_plugin(const std::shared_ptr<SharedModule>& module, const VST3::UID& classId,
+                               uint32_t flags) {
+    const auto& factory = module->factory();
+
+    // Counted as live before the context is used, under the lock vst3_shutdown holds
+    // while it checks the count, so the context cannot be released under this load
+    FUnknown* context = retain_host_context();
 
     // Create plugin structure
     VST3Plugin* plugin = new VST3Plugin();
     plugin->module = module;
+    plugin->class_id = classId;
+    for (const auto& classInfo : module->classInfos) {
+        if (classInfo.ID() == classId) {
+            plugin->class_info = classInfo;
+            break;
+        }
+    }
     plugin->num_inputs = 0;
     plugin->num_outputs = 0;
     plugin->sample_rate = 0;
     plugin->max_block_size = 0;
+    plugin->active = false;
+    plugin->componentHandler.reset(new HostComponentHandler(plugin));
+    plugin->inputEvents.setMaxSize(kMaxEventsPerBlock);
+    plugin->outputEvents.setMaxSize(kMaxEventsPerBlock);
 
     // Create component
-    plugin->component = factory.createInstance<IComponent>(audioEffectClass.ID());
+    plugin->component = factory.createInstance<IComponent>(classId);
     if (!plugin->component) {
         fprintf(stderr, "Error: Failed to create component\n");
-        delete plugin;
+        discard_instance(plugin);
         return nullptr;
     }
 
     // Initialize component
-    if (plugin->component->initialize(gHostContext) != kResultOk) {
+    if (plugin->component->initialize(context) != kResultOk) {
         fprintf(stderr, "Error: Failed to initialize component\n");
-        delete plugin;
+        discard_instance(plugin);
         return nullptr;
     }
 
@@ -120,45 +358,200 @@ VST3Plugin* vst3_load_plugin(const char* bundle_path) {
     if (!plugin->processor) {
         fprintf(stderr, "Error: Component does not support IAudioProcessor\n");
         plugin->component->terminate();
-        delete plugin;
+        discard_instance(plugin);
         return nullptr;
     }
 
-    // Get controller
-    TUID controllerCID;
-    if (plugin->component->getControllerClassId(controllerCID) == kResultOk) {
-        plugin->controller = factory.createInstance<IEditController>(VST3::UID(controllerCID));
-        if (plugin->controller) {
-            plugin->controller->initialize(gHostContext);
+    // Get controller, now or on first use
+    plugin->load_flags = flags;
+    if (flags & VST3_LOAD_LAZY_CONTROLLER) {
+        plugin->controller_deferred = true;
+    } else {
+        create_controller(plugin);
+    }
 
-            // Connect component and controller
-            FUnknownPtr<IConnectionPoint> componentCP(plugin->component);
-            FUnknownPtr<IConnectionPoint> controllerCP(plugin->controller);
+    // Query bus information
+    query_bus_layout(plugin);
+    plugin->paramMailbox.rebuild(plugin->controller);
+    scan_program_lists(plugin);
 
-            if (componentCP && controllerCP) {
-                componentCP->connect(controllerCP);
-                controllerCP->connect(componentCP);
-            }
+    return plugin;
+}
+
+FUnknown* host_context() {
+    std::lock_guard<std::mutex> lock(gHostMutex);
+    if (!gHostContext) {
+        gHostContext = new HostApplication();
+    }
+    return gHostContext;
+}
+
+int process_with_sidechain(VST3Plugin* plugin, float** inputs, float** outputs,
+                           int32_t num_samples, int32_t num_input_channels,
+                           int32_t num_output_channels, float** sidechain,
+                           int32_t num_sidechain_channels) {
+    if (!plugin || !plugin->processor) return -1;
+
+    // Setup process data
+    plugin->processData.processContext = nullptr;
+    plugin->processData.numSamples = num_samples;
+
+    // Setup input/output parameter changes
+    plugin->processData.inputParameterChanges = &plugin->inputParameterChanges;
+    plugin->processData.outputParameterChanges = &plugin->outputParameterChanges;
+
+    // Setup input/output events
+    plugin->processData.inputEvents = &plugin->inputEvents;
+    plugin->processData.outputEvents = &plugin->outputEvents;
+
+    // Output containers only hold what the plugin reports for this block
+    plugin->outputParameterChanges.clearQueue();
+    plugin->outputEvents.clear();
+
+    // Parameter edits posted since the last block (host or plugin initiated)
+    plugin->paramMailbox.drain(plugin->inputParameterChanges);
+
+    // Setup input buffers
+    if (num_input_channels > 0 && plugin->processData.numInputs > 0) {
+        for (int32_t ch = 0; ch < num_input_channels && ch < plugin->num_inputs; ch++) {
+            plugin->processData.inputs[0].channelBuffers32[ch] = inputs[ch];
         }
+        plugin->processData.inputs[0].numChannels = num_input_channels;
     }
 
-    // Query bus information
-    int32_t numInputBuses = plugin->component->getBusCount(kAudio, kInput);
-    int32_t numOutputBuses = plugin->component->getBusCount(kAudio, kOutput);
+    // Setup output buffers
+    if (num_output_channels > 0 && plugin->processData.numOutputs > 0) {
+        for (int32_t ch = 0; ch < num_output_channels && ch < plugin->num_outputs; ch++) {
+            plugin->processData.outputs[0].channelBuffers32[ch] = outputs[ch];
+        }
+        plugin->processData.outputs[0].numChannels = num_output_channels;
+    }
 
-    // Get channel counts from first bus
-    if (numInputBuses > 0) {
-        BusInfo busInfo;
-        if (plugin->component->getBusInfo(kAudio, kInput, 0, busInfo) == kResultOk) {
-            plugin->num_inputs = busInfo.channelCount;
+    // Setup the sidechain bus, if enabled
+    if (plugin->sidechain_bus >= 0 && plugin->sidechain_bus < plugin->processData.numInputs) {
+        AudioBusBuffers& bus = plugin->processData.inputs[plugin->sidechain_bus];
+        int32_t count = sidechain ? num_sidechain_channels : 0;
+        if (count > plugin->sidechain_channels) count = plugin->sidechain_channels;
+        for (int32_t ch = 0; ch < count; ch++) {
+            bus.channelBuffers32[ch] = sidechain[ch];
+        }
+        // Without a source the plugin reads silence
+        for (int32_t ch = count; ch < plugin->sidechain_channels; ch++) {
+            bus.channelBuffers32[ch] = plugin->sidechain_silence.data();
         }
+        bus.numChannels = plugin->sidechain_channels;
     }
 
-    if (numOutputBuses > 0) {
+    // Process
+    if (plugin->processor->process(plugin->processData) != kResultOk) {
+        return -1;
+    }
+
+    // Clear input events after processing
+    plugin->inputEvents.clear();
+    plugin->inputParameterChanges.clearQueue();
+
+    return 0;
+}
+
+int32_t enable_sidechain(VST3Plugin* plugin) {
+    if (plugin->sidechain_bus >= 0) return plugin->sidechain_channels;
+
+    int32 numBuses = plugin->component->getBusCount(kAudio, kInput);
+    for (int32 bus = 1; bus < numBuses; bus++) {
         BusInfo busInfo;
-        if (plugin->component->getBusInfo(kAudio, kOutput, 0, busInfo) == kResultOk) {
-            plugin->num_outputs = busInfo.channelCount;
+        if (plugin->component->getBusInfo(kAudio, kInput, bus, busInfo) != kResultOk) continue;
+        if (busInfo.busType != kAux || busInfo.channelCount <= 0) continue;
+
+        // Buses can only be activated while the component is inactive
+        bool wasActive = plugin->active;
+        if (wasActive) vst3_set_active(plugin, 0);
+
+        plugin->sidechain_bus = bus;
+        plugin->sidechain_channels = busInfo.channelCount;
+        int result = plugin->max_block_size > 0 ? configure_processing(plugin) : 0;
+
+        if (wasActive) vst3_set_active(plugin, 1);
+        return result == 0 ? plugin->sidechain_channels : -1;
+    }
+
+    return 0;
+}
+
+extern "C" {
+
+int vst3_init(void) {
+    return host_context() ? 0 : -1;
+}
+
+int vst3_shutdown(void) {
+    wait_for_async_loads();
+
+    // Loads count their instance under this lock before using the context
+    std::lock_guard<std::mutex> lock(gHostMutex);
+    int32_t live = gLiveInstances.load();
+    if (live > 0) {
+        fprintf(stderr, "Error: Cannot shut down with %d plugin instance(s) still loaded\n", live);
+        return -1;
+    }
+
+    if (gHostContext) {
+        gHostContext->release();
+        gHostContext = nullptr;
+    }
+    return 0;
+}
+
+VST3Plugin* vst3_load_plugin(const char* bundle_path) {
+    return vst3_load_plugin_class(bundle_path, nullptr);
+}
+
+VST3Plugin* vst3_load_plugin_class(const char* bundle_path, const char* class_name_or_id) {
+    return vst3_load_plugin_ex(bundle_path, class_name_or_id, 0);
+}
+
+VST3Plugin* vst3_load_plugin_ex(const char* bundle_path, const char* class_name_or_id, uint32_t flags) {
+    if (!bundle_path) {
+        fprintf(stderr, "Error: null bundle path\n");
+        return nullptr;
+    }
+
+    printf("Loading VST3 plugin from: %s\n", bundle_path);
+
+    // Load the module, or share it with other instances of the same bundle
+    std::string error;
+    auto module = acquire_module(bundle_path, error);
+    if (!module) {
+        fprintf(stderr, "Error: Failed to load module: %s\n", error.c_str());
+        return nullptr;
+    }
+
+    // Select the class by ID or name, or the first audio effect if none is given
+    bool any = !class_name_or_id || !*class_name_or_id;
+    auto uid = any ? VST3::Optional<VST3::UID>() : VST3::UID::fromString(class_name_or_id);
+    const VST3::Hosting::ClassInfo* selected = nullptr;
+
+    for (auto& classInfo : module->classInfos) {
+        if (classInfo.category() != kVstAudioEffectClass) continue;
+        if (any || (uid && classInfo.ID() == *uid) || classInfo.name() == class_name_or_id) {
+            selected = &classInfo;
+            break;
+        }
+    }
+
+    if (!selected) {
+        if (any) {
+            fprintf(stderr, "Error: No audio effect class found in plugin\n");
+        } else {
+            fprintf(stderr, "Error: No audio effect class '%s' in plugin\n", class_name_or_id);
         }
+        return nullptr;
+    }
+    printf("Found audio effect: %s\n", selected->name().c_str());
+
+    VST3Plugin* plugin = instantiate_plugin(module, selected->ID(), flags);
+    if (!plugin) {
+        return nullptr;
     }
 
     printf("Plugin loaded successfully\n");
@@ -168,25 +561,41 @@ VST3Plugin* vst3_load_plugin(const char* bundle_path) {
     return plugin;
 }
 
-int vst3_get_plugin_info(VST3Plugin* plugin, VST3PluginInfo* info) {
-    if (!plugin || !info) return -1;
-
-    // Get factory info
-    auto factoryInfo = plugin->module->getFactory().info();
+int32_t vst3_enumerate_classes(const char* bundle_path, VST3ClassInfo* classes, int32_t max_classes) {
+    if (!bundle_path || (!classes && max_classes > 0)) return -1;
 
-    // Get class info
-    std::string pluginName = "Unknown";
-    std::string vendor = factoryInfo.vendor();
+    std::string error;
+    auto module = acquire_module(bundle_path, error);
+    if (!module) {
+        fprintf(stderr, "Error: Failed to load module: %s\n", error.c_str());
+        return -1;
+    }
 
-    for (auto& classInfo : plugin->module->getFactory().classInfos()) {
-        if (classInfo.category() == kVstAudioEffectClass) {
-            pluginName = classInfo.name();
-            if (!classInfo.vendor().empty()) {
-                vendor = classInfo.vendor();
-            }
-            break;
-        }
+    auto copy = [](char* dest, size_t destSize, const std::string& src) {
+        strncpy(dest, src.c_str(), destSize - 1);
+        dest[destSize - 1] = '\0';
+    };
+
+    int32_t count = static_cast<int32_t>(module->classInfos.size());
+    for (int32_t i = 0; i < count && i < max_classes; i++) {
+        const auto& classInfo = module->classInfos[i];
+        VST3ClassInfo& out = classes[i];
+        copy(out.class_id, sizeof(out.class_id), classInfo.ID().toString(false));
+        copy(out.name, sizeof(out.name), classInfo.name());
+        copy(out.vendor, sizeof(out.vendor), classInfo.vendor().empty() ? module->vendor : classInfo.vendor());
+        copy(out.version, sizeof(out.version), classInfo.version());
+        copy(out.category, sizeof(out.category), classInfo.category());
+        copy(out.subcategories, sizeof(out.subcategories), classInfo.subCategoriesString());
     }
+    return count;
+}
+
+int vst3_get_plugin_info(VST3Plugin* plugin, VST3PluginInfo* info) {
+    if (!plugin || !info) return -1;
+
+    const auto& classInfo = plugin->class_info;
+    std::string pluginName = classInfo.name().empty() ? "Unknown" : classInfo.name();
+    std::string vendor = classInfo.vendor().empty() ? plugin->module->vendor : classInfo.vendor();
 
     strncpy(info->name, pluginName.c_str(), sizeof(info->name) - 1);
     info->name[sizeof(info->name) - 1] = '\0';
@@ -196,19 +605,23 @@ int vst3_get_plugin_info(VST3Plugin* plugin, VST3PluginInfo* info) {
 
     info->num_inputs = plugin->num_inputs;
     info->num_outputs = plugin->num_outputs;
-    info->num_parameters = plugin->controller ? plugin->controller->getParameterCount() : 0;
+    if (plugin->controller_deferred) {
+        info->num_parameters = -1;
+    } else {
+        info->num_parameters = plugin->controller ? plugin->controller->getParameterCount() : 0;
+    }
     info->sample_rate = plugin->sample_rate;
 
     return 0;
 }
 
 int vst3_get_parameter_count(VST3Plugin* plugin) {
-    if (!plugin || !plugin->controller) return 0;
+    if (!plugin || !ensure_controller(plugin)) return 0;
     return plugin->controller->getParameterCount();
 }
 
 int vst3_get_parameter_info(VST3Plugin* plugin, int32_t index, VST3ParameterInfo* info) {
-    if (!plugin || !plugin->controller || !info) return -1;
+    if (!plugin || !info || !ensure_controller(plugin)) return -1;
 
     ParameterInfo paramInfo;
     if (plugin->controller->getParameterInfo(index, paramInfo) != kResultOk) {
@@ -243,24 +656,19 @@ int vst3_get_parameter_info(VST3Plugin* plugin, int32_t index, VST3ParameterInfo
 }
 
 double vst3_get_parameter(VST3Plugin* plugin, int32_t param_id) {
-    if (!plugin || !plugin->controller) return 0.0;
+    if (!plugin || !ensure_controller(plugin)) return 0.0;
     return plugin->controller->getParamNormalized(param_id);
 }
 
 int vst3_set_parameter(VST3Plugin* plugin, int32_t param_id, double value) {
-    if (!plugin || !plugin->controller) return -1;
+    if (!plugin || !ensure_controller(plugin)) return -1;
 
     if (plugin->controller->setParamNormalized(param_id, value) != kResultOk) {
         return -1;
     }
 
-    // Also notify component if connected
-    if (plugin->component) {
-        FUnknownPtr<IConnectionPoint> componentCP(plugin->component);
-        if (componentCP) {
-            // The parameter change will be communicated through the connection
-        }
-    }
+    // Deliver the change to the processor at the start of the next block
+    plugin->paramMailbox.post(param_id, value);
 
     return 0;
 }
@@ -271,37 +679,15 @@ int vst3_setup_processing(VST3Plugin* plugin, double sample_rate, int32_t max_sa
     plugin->sample_rate = sample_rate;
     plugin->max_block_size = max_samples_per_block;
 
-    // Activate buses
-    if (plugin->num_inputs > 0) {
-        plugin->component->activateBus(kAudio, kInput, 0, true);
-    }
-
-    if (plugin->num_outputs > 0) {
-        plugin->component->activateBus(kAudio, kOutput, 0, true);
-    }
-
-    // Setup processing
-    ProcessSetup setup;
-    setup.processMode = kRealtime;
-    setup.symbolicSampleSize = kSample32;
-    setup.maxSamplesPerBlock = max_samples_per_block;
-    setup.sampleRate = sample_rate;
-
-    if (plugin->processor->setupProcessing(setup) != kResultOk) {
-        fprintf(stderr, "Error: setupProcessing failed\n");
-        return -1;
-    }
-
-    // Initialize process data
-    plugin->processData.prepare(*plugin->component, max_samples_per_block, kSample32);
-
-    return 0;
+    return configure_processing(plugin);
 }
 
 int vst3_set_active(VST3Plugin* plugin, int active) {
     if (!plugin || !plugin->component) return -1;
 
     if (active) {
+        apply_pending_restart(plugin);
+
         if (plugin->component->setActive(true) != kResultOk) {
             fprintf(stderr, "Error: Failed to activate component\n");
             return -1;
@@ -311,58 +697,218 @@ int vst3_set_active(VST3Plugin* plugin, int active) {
             fprintf(stderr, "Error: Failed to start processing\n");
             return -1;
         }
+        plugin->active = true;
     } else {
         plugin->processor->setProcessing(false);
         plugin->component->setActive(false);
+        plugin->active = false;
+        apply_pending_restart(plugin);
     }
 
     return 0;
 }
 
+int32_t vst3_apply_restart(VST3Plugin* plugin) {
+    if (!plugin || !plugin->processor) return 0;
+    return apply_pending_restart(plugin);
+}
+
 int vst3_process(VST3Plugin* plugin, float** inputs, float** outputs,
                  int32_t num_samples, int32_t num_input_channels,
                  int32_t num_output_channels) {
-    if (!plugin || !plugin->processor) return -1;
+    return process_with_sidechain(plugin, inputs, outputs, num_samples, num_input_channels,
+                                  num_output_channels, nullptr, 0);
+}
 
-    // Setup process data
-    plugin->processData.processContext = nullptr;
-    plugin->processData.numSamples = num_samples;
+int vst3_read_output_parameters(VST3Plugin* plugin, VST3ParameterPoint* points, int32_t max_points) {
+    if (!plugin || (!points && max_points > 0)) return -1;
 
-    // Setup input/output parameter changes
-    plugin->processData.inputParameterChanges = &plugin->inputParameterChanges;
-    plugin->processData.outputParameterChanges = &plugin->outputParameterChanges;
+    int32_t available = 0;
+    int32 numQueues = plugin->outputParameterChanges.getParameterCount();
 
-    // Setup input/output events
-    plugin->processData.inputEvents = &plugin->inputEvents;
-    plugin->processData.outputEvents = &plugin->outputEvents;
+    for (int32 i = 0; i < numQueues; i++) {
+        IParamValueQueue* queue = plugin->outputParameterChanges.getParameterData(i);
+        if (!queue) continue;
 
-    // Setup input buffers
-    if (num_input_channels > 0 && plugin->processData.numInputs > 0) {
-        for (int32_t ch = 0; ch < num_input_channels && ch < plugin->num_inputs; ch++) {
-            plugin->processData.inputs[0].channelBuffers32[ch] = inputs[ch];
+        ParamID id = queue->getParameterId();
+        int32 numPoints = queue->getPointCount();
+
+        for (int32 p = 0; p < numPoints; p++) {
+            int32 sampleOffset = 0;
+            ParamValue value = 0.0;
+            if (queue->getPoint(p, sampleOffset, value) != kResultOk) continue;
+
+            if (available < max_points) {
+                points[available].id = static_cast<int32_t>(id);
+                points[available].sample_offset = sampleOffset;
+                points[available].value = value;
+            }
+            available++;
         }
-        plugin->processData.inputs[0].numChannels = num_input_channels;
     }
 
-    // Setup output buffers
-    if (num_output_channels > 0 && plugin->processData.numOutputs > 0) {
-        for (int32_t ch = 0; ch < num_output_channels && ch < plugin->num_outputs; ch++) {
-            plugin->processData.outputs[0].channelBuffers32[ch] = outputs[ch];
+    // Kept for a retry with a larger buffer if they did not all fit
+    if (available <= max_points) {
+        plugin->outputParameterChanges.clearQueue();
+    }
+    return available;
+}
+
+// Pack a VST3 event as MIDI 1.0 bytes. Returns false for events with no MIDI equivalent.
+static bool pack_midi_event(const Event& e, VST3MidiEvent& out) {
+    auto to7bit = [](float v) -> uint8_t {
+        int32_t i = static_cast<int32_t>(v * 127.0f + 0.5f);
+        return static_cast<uint8_t>(i < 0 ? 0 : (i > 127 ? 127 : i));
+    };
+
+    out.sample_offset = e.sampleOffset;
+    out.reserved = 0;
+
+    switch (e.type) {
+        case Event::kNoteOnEvent:
+            out.status = 0x90 | (e.noteOn.channel & 0x0F);
+            out.data1 = e.noteOn.pitch & 0x7F;
+            out.data2 = to7bit(e.noteOn.velocity);
+            return true;
+
+        case Event::kNoteOffEvent:
+            out.status = 0x80 | (e.noteOff.channel & 0x0F);
+            out.data1 = e.noteOff.pitch & 0x7F;
+            out.data2 = to7bit(e.noteOff.velocity);
+            return true;
+
+        case Event::kPolyPressureEvent:
+            out.status = 0xA0 | (e.polyPressure.channel & 0x0F);
+            out.data1 = e.polyPressure.pitch & 0x7F;
+            out.data2 = to7bit(e.polyPressure.pressure);
+            return true;
+
+        case Event::kLegacyMIDICCOutEvent: {
+            uint8_t channel = e.midiCCOut.channel & 0x0F;
+            uint8_t value = e.midiCCOut.value & 0x7F;
+            uint8_t value2 = e.midiCCOut.value2 & 0x7F;
+
+            if (e.midiCCOut.controlNumber < kCountCtrlNumber) {
+                out.status = 0xB0 | channel;
+                out.data1 = e.midiCCOut.controlNumber;
+                out.data2 = value;
+            } else if (e.midiCCOut.controlNumber == kAfterTouch) {
+                out.status = 0xD0 | channel;
+                out.data1 = value;
+                out.data2 = 0;
+            } else if (e.midiCCOut.controlNumber == kPitchBend) {
+                out.status = 0xE0 | channel;
+                out.data1 = value;   // LSB
+                out.data2 = value2;  // MSB
+            } else if (e.midiCCOut.controlNumber == kCtrlProgramChange) {
+                out.status = 0xC0 | channel;
+                out.data1 = value;
+                out.data2 = 0;
+            } else if (e.midiCCOut.controlNumber == kCtrlPolyPressure) {
+                out.status = 0xA0 | channel;
+                out.data1 = value;   // Key
+                out.data2 = value2;  // Pressure
+            } else {
+                return false;
+            }
+            return true;
         }
-        plugin->processData.outputs[0].numChannels = num_output_channels;
+
+        default:
+            return false;
     }
+}
 
-    // Process
-    if (plugin->processor->process(plugin->processData) != kResultOk) {
-        return -1;
+} // extern "C"
+
+// vst3_send_midi_event; from the processing thread a program change only moves the
+// program-change parameter
+static int send_midi_event(VST3Plugin* plugin, const VST3MidiEvent* midi, bool processing) {
+    if (!plugin || !midi) return -1;
+
+    uint8_t type = midi->status & 0xF0;
+    int16 channel = midi->status & 0x0F;
+    uint8_t data1 = midi->data1 & 0x7F;
+    uint8_t data2 = midi->data2 & 0x7F;
+
+    switch (type) {
+        case 0x90:
+            if (data2 > 0) return vst3_send_note_on(plugin, channel, data1, data2, midi->sample_offset);
+            return vst3_send_note_off(plugin, channel, data1, midi->sample_offset);
+        case 0x80:
+            return vst3_send_note_off(plugin, channel, data1, midi->sample_offset);
+        case 0xB0:
+            return vst3_send_midi_cc(plugin, channel, data1, data2, midi->sample_offset);
+        case 0xC0:
+            if (processing) return post_program_change(plugin, channel, data1, midi->sample_offset);
+            return vst3_send_program_change(plugin, channel, data1, midi->sample_offset);
+        default:
+            break;
     }
 
-    // Clear input events after processing
-    plugin->inputEvents.clear();
+    // Pressure and pitch bend travel as legacy controller events
+    Event event = {};
+    event.busIndex = 0;
+    event.sampleOffset = midi->sample_offset;
+    event.flags = Event::kIsLive;
+    event.type = Event::kLegacyMIDICCOutEvent;
+    event.midiCCOut.channel = channel;
+
+    if (type == 0xA0) {
+        event.type = Event::kPolyPressureEvent;
+        event.polyPressure.channel = channel;
+        event.polyPressure.pitch = data1;
+        event.polyPressure.pressure = data2 / 127.0f;
+        event.polyPressure.noteId = -1;
+    } else if (type == 0xD0) {
+        event.midiCCOut.controlNumber = kAfterTouch;
+        event.midiCCOut.value = data1;
+    } else if (type == 0xE0) {
+        event.midiCCOut.controlNumber = kPitchBend;
+        event.midiCCOut.value = data1;   // LSB
+        event.midiCCOut.value2 = data2;  // MSB
+    } else {
+        return -1;
+    }
 
+    plugin->inputEvents.addEvent(event);
     return 0;
 }
 
+int queue_midi_event(VST3Plugin* plugin, const VST3MidiEvent* midi) {
+    return send_midi_event(plugin, midi, true);
+}
+
+extern "C" {
+
+int vst3_send_midi_event(VST3Plugin* plugin, const VST3MidiEvent* midi) {
+    return send_midi_event(plugin, midi, false);
+}
+
+int vst3_read_output_events(VST3Plugin* plugin, VST3MidiEvent* events, int32_t max_events) {
+    if (!plugin || (!events && max_events > 0)) return -1;
+
+    int32_t available = 0;
+    int32 numEvents = plugin->outputEvents.getEventCount();
+
+    for (int32 i = 0; i < numEvents; i++) {
+        Event* e = plugin->outputEvents.getEventByIndex(i);
+        VST3MidiEvent packed;
+        if (!e || !pack_midi_event(*e, packed)) continue;
+
+        if (available < max_events) {
+            events[available] = packed;
+        }
+        available++;
+    }
+
+    // Kept for a retry with a larger buffer if they did not all fit
+    if (available <= max_events) {
+        plugin->outputEvents.clear();
+    }
+    return available;
+}
+
 int vst3_send_note_on(VST3Plugin* plugin, int32_t channel, int32_t note, int32_t velocity, int32_t sample_offset) {
     if (!plugin) return -1;
 
@@ -421,50 +967,78 @@ int vst3_send_midi_cc(VST3Plugin* plugin, int32_t channel, int32_t cc, int32_t v
     return 0;
 }
 
-int vst3_send_program_change(VST3Plugin* plugin, int32_t channel, int32_t program, int32_t sample_offset) {
-    if (!plugin) return -1;
+int64_t vst3_save_state(VST3Plugin* plugin, void* buffer, int64_t capacity) {
+    if (!plugin || !plugin->component) return -1;
 
-    // MIDI Program Change is sent as two CC messages in VST3:
-    // Bank Select MSB (CC 0) = 0
-    // Program Change is typically done via parameter change or the preset system
-    // For standard MIDI compatibility, we'll send it as a legacy MIDI event
+    auto componentStream = owned(new MemoryStream());
+    auto controllerStream = owned(new MemoryStream());
+    if (capture_state(plugin, componentStream, controllerStream) != 0) {
+        return -1;
+    }
 
-    // Some plugins support this, but VST3 prefers using the preset/program interface
-    // We'll send both a CC 0 (bank select) set to 0 and then handle program via parameters
+    uint64_t componentSize = static_cast<uint64_t>(componentStream->getSize());
+    uint64_t controllerSize = static_cast<uint64_t>(controllerStream->getSize());
+    int64_t total = kStateHeaderSize + static_cast<int64_t>(componentSize + controllerSize);
 
-    Event event = {};
-    event.busIndex = 0;
-    event.sampleOffset = sample_offset;
-    event.ppqPosition = 0;
-    event.flags = Event::kIsLive;
-    event.type = Event::kLegacyMIDICCOutEvent;
-    event.midiCCOut.channel = channel;
-    event.midiCCOut.controlNumber = 0;  // Bank Select MSB
-    event.midiCCOut.value = 0;
-    event.midiCCOut.value2 = 0;
+    if (!buffer || capacity < total) {
+        return total;
+    }
 
-    plugin->inputEvents.addEvent(event);
+    char* out = static_cast<char*>(buffer);
+    memcpy(out, &kStateMagic, 4);
+    memcpy(out + 4, &kStateVersion, 4);
+    memcpy(out + 8, &componentSize, 8);
+    memcpy(out + 16, &controllerSize, 8);
+    if (componentSize > 0) {
+        memcpy(out + kStateHeaderSize, componentStream->getData(), componentSize);
+    }
+    if (controllerSize > 0) {
+        memcpy(out + kStateHeaderSize + componentSize, controllerStream->getData(), controllerSize);
+    }
 
-    // Add program change as CC 32 (unofficial but some plugins recognize it)
-    Event pcEvent = {};
-    pcEvent.busIndex = 0;
-    pcEvent.sampleOffset = sample_offset;
-    pcEvent.ppqPosition = 0;
-    pcEvent.flags = Event::kIsLive;
-    pcEvent.type = Event::kLegacyMIDICCOutEvent;
-    pcEvent.midiCCOut.channel = channel;
-    pcEvent.midiCCOut.controlNumber = 32;  // Program change (non-standard)
-    pcEvent.midiCCOut.value = program;
-    pcEvent.midiCCOut.value2 = 0;
+    return total;
+}
 
-    plugin->inputEvents.addEvent(pcEvent);
+int vst3_load_state(VST3Plugin* plugin, const void* data, int64_t size) {
+    if (!plugin || !plugin->component || !data || size < kStateHeaderSize) return -1;
+
+    const char* in = static_cast<const char*>(data);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t componentSize = 0;
+    uint64_t controllerSize = 0;
+    memcpy(&magic, in, 4);
+    memcpy(&version, in + 4, 4);
+    memcpy(&componentSize, in + 8, 8);
+    memcpy(&controllerSize, in + 16, 8);
+
+    if (magic != kStateMagic || version != kStateVersion ||
+        componentSize > static_cast<uint64_t>(size) ||
+        controllerSize > static_cast<uint64_t>(size) - componentSize ||
+        kStateHeaderSize + componentSize + controllerSize > static_cast<uint64_t>(size)) {
+        fprintf(stderr, "Error: Invalid state data\n");
+        return -1;
+    }
 
-    return 0;
+    return restore_state(plugin, in + kStateHeaderSize, static_cast<int64_t>(componentSize),
+                         in + kStateHeaderSize + componentSize, static_cast<int64_t>(controllerSize));
+}
+
+int32_t vst3_get_latency_samples(VST3Plugin* plugin) {
+    if (!plugin) return 0;
+    return plugin->latency_samples.load();
+}
+
+int32_t vst3_poll_restart_flags(VST3Plugin* plugin) {
+    if (!plugin) return 0;
+    return plugin->reported_restart.exchange(0);
 }
 
 void vst3_unload_plugin(VST3Plugin* plugin) {
     if (!plugin) return;
 
+    stop_process_worker(plugin);
+
     // Disconnect connection points
     if (plugin->component && plugin->controller) {
         FUnknownPtr<IConnectionPoint> componentCP(plugin->component);
@@ -478,6 +1052,7 @@ void vst3_unload_plugin(VST3Plugin* plugin) {
 
     // Terminate interfaces
     if (plugin->controller) {
+        plugin->controller->setComponentHandler(nullptr);
         plugin->controller->terminate();
         plugin->controller = nullptr;
     }
@@ -491,6 +1066,7 @@ void vst3_unload_plugin(VST3Plugin* plugin) {
     plugin->module = nullptr;
 
     delete plugin;
+    gLiveInstances.fetch_sub(1);
 }
 
 } // extern "C"
@@ -8,9 +8,61 @@
 extern "C" {
 #endif
 
+/* Threading
+ *
+ * Library-wide calls are thread-safe: vst3_init/vst3_shutdown, loading (vst3_load_plugin*,
+ * vst3_load_plugin_async), vst3_enumerate_classes, scanning, preset indexes, pool
+ * checkout/checkin, and vst3_unload_plugin of different instances. Different instances
+ * may be used concurrently from different threads, including instances of the same bundle.
+ *
+ * A single instance is not thread-safe, with two exceptions: vst3_set_parameter and
+ * vst3_get_latency_samples / vst3_poll_restart_flags may be called from one control
+ * thread while another thread runs vst3_process. Graphs are edited and compiled from
+ * control threads while one thread runs vst3_graph_process. */
+
 /* Opaque handle to VST3 plugin */
 typedef struct VST3Plugin VST3Plugin;
 
+/* Opaque handle to a plugin load running on the loader thread pool */
+typedef struct VST3LoadRequest VST3LoadRequest;
+
+/* Called on a loader thread when an asynchronous load completes */
+typedef void (*VST3LoadCallback)(void* user_data);
+
+/* Opaque handle to a serial chain of plugins */
+typedef struct VST3Chain VST3Chain;
+
+/* Opaque handle to a processing graph of plugins */
+typedef struct VST3Graph VST3Graph;
+
+/* Pseudo node ids for a graph's external input and output */
+enum {
+    VST3_GRAPH_INPUT = -1,
+    VST3_GRAPH_OUTPUT = -2
+};
+
+/* Opaque handle to a host-owned realtime processing thread */
+typedef struct VST3AudioThread VST3AudioThread;
+
+/* Opaque handle to a push/pull stream that re-blocks audio for a target */
+typedef struct VST3Stream VST3Stream;
+
+/* What an audio thread or stream processes */
+enum {
+    VST3_AUDIO_TARGET_PLUGIN = 0,   /* VST3Plugin* */
+    VST3_AUDIO_TARGET_CHAIN = 1,    /* VST3Chain* */
+    VST3_AUDIO_TARGET_GRAPH = 2     /* VST3Graph* */
+};
+
+/* Opaque handle to a pool of identically configured plugin instances */
+typedef struct VST3PluginPool VST3PluginPool;
+
+/* Opaque handle to the result of a plugin scan */
+typedef struct VST3PluginScan VST3PluginScan;
+
+/* Opaque handle to an index of .vstpreset files */
+typedef struct VST3PresetIndex VST3PresetIndex;
+
 /* Parameter information */
 typedef struct {
     int32_t id;
@@ -33,10 +85,237 @@ typedef struct {
     double sample_rate;
 } VST3PluginInfo;
 
-/* Load a VST3 plugin from bundle path */
+/* Outcome of probing a bundle during a plugin scan */
+enum {
+    VST3_SCAN_OK = 0,
+    VST3_SCAN_FAILED = 1,       /* Could not be loaded, or the probe crashed */
+    VST3_SCAN_TIMEOUT = 2       /* Probe killed after exceeding the timeout */
+};
+
+/* Plugin scan options. Zero-initialized (or NULL) means defaults. */
+typedef struct {
+    int32_t num_threads;        /* Concurrent probes, <= 0 for one per core */
+    int32_t timeout_ms;         /* Per-bundle limit for child-process probes, <= 0 for none */
+    const char* probe_path;     /* vst3probe executable; NULL probes bundles in-process */
+} VST3ScanOptions;
+
+/* Audio effect class found by a plugin scan, or a bundle that failed to probe */
+typedef struct {
+    char name[128];
+    char vendor[128];
+    char version[64];
+    char subcategories[128];    /* '|' separated, e.g. "Fx|Reverb|Stereo" */
+    char class_id[33];
+    char path[1024];            /* Bundle path */
+    int32_t num_inputs;         /* Main bus channels, -1 if unknown */
+    int32_t num_outputs;
+    int32_t from_module_info;   /* 1 if described by moduleinfo.json without loading */
+    int32_t status;             /* VST3_SCAN_*; failed bundles have an empty class_id */
+    double load_time_ms;        /* Time taken to describe the bundle when it was scanned */
+} VST3ScanEntry;
+
+/* Class exported by a plugin bundle */
+typedef struct {
+    char class_id[33];
+    char name[128];
+    char vendor[128];
+    char version[64];
+    char category[64];          /* e.g. "Audio Module Class" for loadable processors */
+    char subcategories[128];    /* '|' separated, e.g. "Instrument|Synth" */
+} VST3ClassInfo;
+
+/* Scheduling statistics of a graph's last processed block. Node costs are moving
+   averages of measured run times. */
+typedef struct {
+    double predicted_ms;        /* Expected makespan: max(critical_path_ms, total_work_ms / num_workers) */
+    double actual_ms;           /* Measured time from the first node starting to the output being mixed */
+    double critical_path_ms;    /* Costliest chain of dependent nodes */
+    double total_work_ms;       /* Sum of all node costs */
+    int32_t num_workers;
+} VST3GraphStats;
+
+/* Simulated audio device driving a VST3AudioThread */
+typedef struct {
+    double sample_rate;
+    int32_t period_frames;      /* Samples per period; the clock ticks every period_frames / sample_rate */
+    int32_t num_input_channels; /* Chains and graphs need their own channel count for both, or start fails */
+    int32_t num_output_channels;
+    int32_t ring_periods;       /* Capacity of each ring in periods, <= 0 for 4 */
+    int32_t realtime;           /* Request SCHED_FIFO, where permitted */
+    int32_t priority;           /* SCHED_FIFO priority, <= 0 for a default near the maximum */
+    int32_t lock_memory;        /* mlockall(MCL_CURRENT | MCL_FUTURE). Process-wide: pins every page of
+                                   the process, not only this thread's, until the last audio thread
+                                   that locked memory stops */
+} VST3AudioThreadConfig;
+
+/* Timing of an audio thread since it started */
+typedef struct {
+    int64_t periods;            /* Periods processed */
+    int64_t deadline_misses;    /* Periods whose processing ended after the next period began */
+    int64_t underruns;          /* Periods processed as silence because the input ring lacked a period */
+    int64_t overruns;           /* Output periods dropped because the output ring was full */
+    double period_ms;
+    double max_process_ms;
+    double avg_process_ms;
+    double max_wakeup_ms;       /* Worst lateness of the thread waking at a clock tick */
+    int32_t realtime;           /* SCHED_FIFO was granted */
+    int32_t memory_locked;      /* lock_memory was requested and mlockall succeeded */
+} VST3AudioThreadStats;
+
+/* Parameter change at a point of a rendered file */
+typedef struct {
+    double time;                /* Seconds from the start of the input */
+    int32_t param_id;
+    double value;               /* Normalized 0.0 - 1.0 */
+} VST3AutomationPoint;
+
+/* Options of vst3_render_file */
+typedef struct {
+    int32_t target_kind;        /* VST3_AUDIO_TARGET_* */
+    void* target;
+    int32_t num_channels;       /* Channels of a chain or graph, which must match; plugins use their own bus layout */
+    int32_t block_size;         /* Samples per process call; <= 0 uses a plugin's maximum */
+    int32_t chunk_frames;       /* Frames per queued chunk, rounded up to whole blocks; <= 0 for 16 blocks */
+    int32_t queue_depth;        /* Chunks between stages, <= 0 for 4 */
+    double tail_seconds;        /* Silence rendered after the input, for reverb and delay tails */
+    int32_t compensate_latency; /* Drop the target's reported latency from the start of the output */
+    int32_t raw_channels;       /* Layout of headerless 32-bit float input; 0 accepts WAV only */
+    double raw_sample_rate;
+    const VST3AutomationPoint* automation;  /* Parameter changes of a plugin target, sorted by time; may be NULL */
+    int32_t num_automation;
+} VST3RenderOptions;
+
+/* Result of vst3_render_file */
+typedef struct {
+    int64_t input_frames;
+    int64_t output_frames;
+    int32_t latency_samples;    /* Dropped from the start of the output */
+    double seconds;             /* Wall time */
+    double realtime_factor;     /* Output duration divided by wall time */
+    double reader_stall_ms;     /* Time processing waited for decoded input */
+    double writer_stall_ms;     /* Time processing waited for the writer to free a chunk */
+} VST3RenderStats;
+
+/* Preset file information from a preset index */
+typedef struct {
+    char name[128];
+    char plugin_name[128];
+    char category[128];
+    char class_id[33];
+    char path[1024];
+} VST3PresetInfo;
+
+/* Program list information */
+typedef struct {
+    int32_t id;
+    char name[128];
+    int32_t program_count;
+    int32_t param_id;       /* Program-change parameter, -1 if none */
+    int32_t num_cached;     /* Programs with a cached state */
+} VST3ProgramListInfo;
+
+/* Parameter change point reported by the plugin during processing */
+typedef struct {
+    int32_t id;
+    int32_t sample_offset;
+    double value;
+} VST3ParameterPoint;
+
+/* MIDI event reported by the plugin during processing, packed as MIDI 1.0 bytes */
+typedef struct {
+    int32_t sample_offset;
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+    uint8_t reserved;
+} VST3MidiEvent;
+
+/* Create the host context. Optional: loading creates it on first use. Returns 0 on success. */
+int vst3_init(void);
+
+/* Wait for pending asynchronous loads and release the host context. Returns -1 (and
+   does nothing else) while plugin instances are still loaded. vst3_init or a later load
+   creates a fresh context. */
+int vst3_shutdown(void);
+
+/* One plugin's share of a vst3_process_many block */
+typedef struct {
+    VST3Plugin* plugin;
+    float** inputs;
+    float** outputs;
+    int32_t num_input_channels;
+    int32_t num_output_channels;
+    const VST3MidiEvent* events;    /* Queued before processing, may be NULL */
+    int32_t num_events;
+    int32_t result;                 /* Set by vst3_process_many: 0 or -1 */
+} VST3ProcessJob;
+
+/* Load a VST3 plugin from bundle path. Instances of the same bundle (by canonical
+   path) share one loaded module, which is unloaded with its last instance. Thread-safe.
+   Loads the first audio effect class of the bundle. */
 VST3Plugin* vst3_load_plugin(const char* bundle_path);
 
-/* Get plugin information */
+/* Load flags */
+enum {
+    /* Create the edit controller on first use (parameters, program lists, parameter count)
+       instead of at load time. For processing-only instances that at most restore state:
+       activation and processing leave it uncreated. Since creating it must not overlap
+       with processing, first use has to happen while the plugin is inactive; controller
+       calls on an active plugin whose controller was never created fail. */
+    VST3_LOAD_LAZY_CONTROLLER = 1 << 0
+};
+
+/* Load a specific audio effect class of a bundle, selected by class ID (32 hex digits)
+   or by exact class name. NULL or "" selects the first audio effect class. */
+VST3Plugin* vst3_load_plugin_class(const char* bundle_path, const char* class_name_or_id);
+
+/* vst3_load_plugin_class with VST3_LOAD_* flags */
+VST3Plugin* vst3_load_plugin_ex(const char* bundle_path, const char* class_name_or_id, uint32_t flags);
+
+/* Load a plugin on the host's loader thread pool and return immediately. If block_size
+   > 0 the plugin is also set up for processing. callback (may be NULL) is called with
+   user_data from the loader thread once the load has finished; vst3_load_poll only
+   reports the load as finished after the callback has returned, so user_data may be
+   released from then on. The callback must not call vst3_load_poll or vst3_load_wait.
+   Every request must be completed with vst3_load_wait exactly once. */
+VST3LoadRequest* vst3_load_plugin_async(const char* bundle_path, const char* class_name_or_id,
+                                        double sample_rate, int32_t block_size,
+                                        VST3LoadCallback callback, void* user_data);
+
+/* 1 if the load has finished, 0 if it is still running */
+int vst3_load_poll(VST3LoadRequest* request);
+
+/* Wait for the load to finish, free the request and return the plugin (NULL if the
+   load failed). The caller owns the plugin. */
+VST3Plugin* vst3_load_wait(VST3LoadRequest* request);
+
+/* Describe all classes of a bundle in one pass. Fills up to max_classes entries and
+   returns the total number of classes, or -1 if the bundle cannot be loaded. */
+int32_t vst3_enumerate_classes(const char* bundle_path, VST3ClassInfo* classes, int32_t max_classes);
+
+/* Number of plugin modules currently loaded and shared by live instances */
+int32_t vst3_get_loaded_module_count(void);
+
+/* Find .vst3 bundles under the given directories (the standard VST3 locations if
+   num_dirs is 0) and describe their audio effect classes. Bundles are described from
+   moduleinfo.json when present, otherwise probed concurrently: in-process, or with
+   options->probe_path in a child process per bundle that is killed after
+   options->timeout_ms. If cache_path is not NULL, results of bundles whose modification
+   time is unchanged are read from that file and the file is rewritten when anything
+   changed. options may be NULL. */
+VST3PluginScan* vst3_scan_plugins(const char* const* dirs, int32_t num_dirs,
+                                  const char* cache_path, const VST3ScanOptions* options);
+
+/* Number of entries of a scan: classes found plus bundles that failed */
+int32_t vst3_scan_count(VST3PluginScan* scan);
+
+/* Get a scanned class by index (0-based) */
+int vst3_scan_get(VST3PluginScan* scan, int32_t index, VST3ScanEntry* entry);
+
+/* Free a scan result */
+void vst3_scan_free(VST3PluginScan* scan);
+
+/* Get plugin information. num_parameters is -1 while a lazy controller is not created. */
 int vst3_get_plugin_info(VST3Plugin* plugin, VST3PluginInfo* info);
 
 /* Get number of parameters */
@@ -62,12 +341,318 @@ int vst3_process(VST3Plugin* plugin, float** inputs, float** outputs,
                  int32_t num_samples, int32_t num_input_channels,
                  int32_t num_output_channels);
 
+/* Process one block of num_samples for every job on the host's work-stealing thread
+   pool; the calling thread works too. Returns when all jobs have finished, with the
+   number of failed jobs (see each job's result), or -1 on invalid arguments. Each
+   plugin may appear in only one job. Concurrent calls are serialized. */
+int vst3_process_many(VST3ProcessJob* jobs, int32_t num_jobs, int32_t num_samples);
+
+/* Resize the processing pool used by vst3_process_many (num_threads counts the
+   calling thread; <= 0 for one per core). Returns the resulting number of workers. */
+int vst3_set_process_threads(int32_t num_threads);
+
+/* Queue one block of num_samples for job->plugin on the plugin's own worker thread
+   and return at once with a ticket (> 0), or -1. Blocks run in submission order, so
+   the caller can prepare the next block while this one is processed. Up to 8 blocks may
+   be pending; further submits wait for the oldest. The job, its buffers and events must
+   stay untouched until the block has finished; its result is then set as by
+   vst3_process_many. Submit, poll and wait from one thread; meanwhile only
+   vst3_set_parameter may be called on the plugin. */
+int64_t vst3_process_submit(VST3ProcessJob* job, int32_t num_samples);
+
+/* 1 if the block of ticket has finished, 0 if not, -1 for an unknown ticket */
+int vst3_process_poll(VST3Plugin* plugin, int64_t ticket);
+
+/* Wait until the block of ticket, and every block submitted before it, has finished.
+   Returns 0, or -1 for an unknown ticket; the block's outcome is in its job's result. */
+int vst3_process_wait(VST3Plugin* plugin, int64_t ticket);
+
+/* Create an empty serial chain processing num_channels channels in blocks of up to
+   max_block_size samples. The chain owns its scratch buffers, not its plugins. */
+VST3Chain* vst3_chain_create(int32_t num_channels, int32_t max_block_size);
+
+/* Append a set up plugin. Returns its index in the chain, or -1. Not concurrent with
+   vst3_chain_process. */
+int32_t vst3_chain_add(VST3Chain* chain, VST3Plugin* plugin);
+
+/* Number of plugins in the chain */
+int32_t vst3_chain_size(VST3Chain* chain);
+
+/* Skip (bypass != 0) or re-enable a plugin of the chain. Safe to call while processing;
+   takes effect at the next block. */
+int vst3_chain_set_bypass(VST3Chain* chain, int32_t index, int bypass);
+
+/* Run one block through every active plugin in order. inputs and outputs hold the
+   chain's num_channels channels; they may be the same buffers. Events and parameter
+   changes queued on the plugins are delivered as with vst3_process. */
+int vst3_chain_process(VST3Chain* chain, float** inputs, float** outputs, int32_t num_samples);
+
+/* Total latency in samples of the chain's active plugins */
+int32_t vst3_chain_get_latency(VST3Chain* chain);
+
+/* Free the chain. Its plugins stay loaded. */
+void vst3_chain_free(VST3Chain* chain);
+
+/* Create an empty processing graph of num_channels channels in blocks of up to
+   max_block_size samples, processed by num_threads workers (counting the calling thread;
+   <= 0 for one per core). The graph owns its scratch buffers, not its plugins.
+   Edits and compiles are thread-safe and may run while another thread processes: each
+   compile publishes a new schedule that processing picks up at its next block, and
+   replaced schedules are freed on a background thread. */
+VST3Graph* vst3_graph_create(int32_t num_channels, int32_t max_block_size, int32_t num_threads);
+
+/* Add a set up plugin as a node. Returns its node id, or -1. */
+int32_t vst3_graph_add_node(VST3Graph* graph, VST3Plugin* plugin);
+
+/* Route source's output into dest's main input, scaled by gain. source may be
+   VST3_GRAPH_INPUT and dest VST3_GRAPH_OUTPUT; several sources into one input are summed.
+   Connecting an existing pair again updates its gain. */
+int vst3_graph_connect(VST3Graph* graph, int32_t source, int32_t dest, float gain);
+
+/* Route source's output into dest's sidechain (its first auxiliary input bus). Fails if
+   dest has no such bus. The first sidechain connection of a plugin activates the bus,
+   which reconfigures the plugin, so it fails once the node has been compiled into a
+   schedule: connect sidechains between vst3_graph_add_node and the first compile
+   that includes the node. Later sidechain connections to it are live edits. */
+int vst3_graph_connect_sidechain(VST3Graph* graph, int32_t source, int32_t dest, float gain);
+
+/* Change the gain of the connections from source to dest while processing. The next
+   block ramps from the old gain to the new one. */
+int vst3_graph_set_gain(VST3Graph* graph, int32_t source, int32_t dest, float gain);
+
+/* Remove the main and sidechain connections from source to dest */
+int vst3_graph_disconnect(VST3Graph* graph, int32_t source, int32_t dest);
+
+/* Remove a node and its connections; other node ids are unchanged. With unload != 0 the
+   plugin is deactivated and unloaded on the background thread once no running block
+   can use it.
+   Otherwise the caller keeps it, but must not unload it before the next compile and a
+   vst3_graph_process started after that compile has returned. */
+int vst3_graph_remove_node(VST3Graph* graph, int32_t node, int unload);
+
+/* Order the nodes, assign scratch buffers and publish the result to vst3_graph_process.
+   Edits take effect with the next compile. Fails, keeping the current schedule, if the
+   connections form a cycle. Never blocks a concurrent vst3_graph_process. */
+int vst3_graph_compile(VST3Graph* graph);
+
+/* Process one block. inputs and outputs hold the graph's num_channels channels and must
+   not be the same buffers. Independent branches run concurrently, the node with the
+   costliest remaining path (by measured run times) first. Channels a node does not
+   produce pass its input through. Returns -1 if the graph is not compiled or any node failed. */
+int vst3_graph_process(VST3Graph* graph, float** inputs, float** outputs, int32_t num_samples);
+
+/* Largest latency difference between paths into a summing point that the delay lines
+   absorb without reallocating (default 8192 samples). Applies from the next compile,
+   which also grows the lines to fit the latencies reported at that time. */
+int vst3_graph_set_max_latency(VST3Graph* graph, int32_t max_latency);
+
+/* Latency in samples of the graph output, as compensated in the last processed block.
+   Paths into each summing point are delayed to match the slowest one. */
+int32_t vst3_graph_get_latency(VST3Graph* graph);
+
+/* Scheduling statistics of the last processed block. Safe to call while processing. */
+int vst3_graph_get_stats(VST3Graph* graph, VST3GraphStats* stats);
+
+/* Number of scratch buffers (of num_channels channels each) the compiled graph uses */
+int32_t vst3_graph_buffer_count(VST3Graph* graph);
+
+/* Free the graph. Its plugins stay loaded, except removed nodes awaiting unload.
+   Not concurrent with vst3_graph_process. */
+void vst3_graph_free(VST3Graph* graph);
+
+/* Start a thread that processes target (a VST3_AUDIO_TARGET_* kind) once per period
+   of a simulated device clock, with denormals flushed to zero. Each period it takes
+   period_frames of input from the input ring, or silence if the ring holds less, and
+   puts the output on the output ring, dropping it if the ring is full. The target
+   must be set up for blocks of period_frames and must not be processed elsewhere
+   while the thread runs; parameters, events and graph edits go through as usual. */
+VST3AudioThread* vst3_audio_thread_start(const VST3AudioThreadConfig* config, int32_t target_kind, void* target);
+
+/* Queue interleaved input. Lock-free; call from one thread. Returns the frames
+   accepted, fewer than num_frames when the ring is full, or -1. */
+int32_t vst3_audio_thread_write(VST3AudioThread* thread, const float* interleaved, int32_t num_frames);
+
+/* Take interleaved output. Lock-free; call from one thread. Returns the frames
+   copied, fewer than num_frames when the ring runs dry, or -1. */
+int32_t vst3_audio_thread_read(VST3AudioThread* thread, float* interleaved, int32_t num_frames);
+
+/* Deadline and ring statistics. Safe to call while the thread runs. */
+int vst3_audio_thread_get_stats(VST3AudioThread* thread, VST3AudioThreadStats* stats);
+
+/* Stop the thread after its current period and free it. The target stays loaded. */
+void vst3_audio_thread_stop(VST3AudioThread* thread);
+
+/* Create a stream that processes target (a VST3_AUDIO_TARGET_* kind) in blocks of
+   exactly block_size samples, whatever chunk sizes are pushed and pulled. Input and
+   output pass through lock-free rings holding capacity_frames plus one block. One
+   producer thread may push while one consumer thread pulls. num_output_channels must be
+   positive; num_input_channels may be 0 for instruments. For a chain or graph both must
+   equal its channel count, or creation fails. The target must be set up
+   for block_size and not processed elsewhere while the stream is in use. */
+VST3Stream* vst3_stream_create(int32_t target_kind, void* target, int32_t block_size,
+                               int32_t num_input_channels, int32_t num_output_channels,
+                               int32_t capacity_frames);
+
+/* Producer: queue interleaved input. Returns the frames accepted, fewer than num_frames
+   when the ring is full, or -1. */
+int32_t vst3_stream_push(VST3Stream* stream, const float* interleaved, int32_t num_frames);
+
+/* Consumer: process queued whole blocks until num_frames of output are ready (or input
+   runs short), then copy out up to num_frames interleaved frames. Output lags input by
+   up to one block. Targets without inputs process on demand. Returns the frames copied,
+   or -1 if processing failed. */
+int32_t vst3_stream_pull(VST3Stream* stream, float* interleaved, int32_t num_frames);
+
+/* Consumer: process the input left over, including a final partial block, once the
+   producer has finished. Stops when the output ring is full; pull and flush again until
+   it returns 0. Returns the frames processed, or -1. */
+int32_t vst3_stream_flush(VST3Stream* stream);
+
+/* Frames of output ready to pull without processing */
+int32_t vst3_stream_available(VST3Stream* stream);
+
+/* Free the stream. The target stays loaded. */
+void vst3_stream_free(VST3Stream* stream);
+
+/* Render a file through a plugin, chain or graph into a 32-bit float WAV file (RF64
+   beyond 4 GiB). Input is WAV (8-32 bit PCM or float) or raw float, read through a
+   memory map on a read-ahead thread; output is written on a write-behind thread; the
+   calling thread processes. Memory use is bounded by the chunk queues, whatever the
+   file length. A mono input feeds every input channel. Automation points take effect at
+   the start of the block containing their time. The target must be set up and
+   active, and not processed elsewhere meanwhile. stats may be NULL. Returns 0 on
+   success, -1 on failure (the output file may then be incomplete). */
+int vst3_render_file(const char* input_path, const char* output_path, const VST3RenderOptions* options,
+                     VST3RenderStats* stats);
+
+/* Read back the parameter changes the plugin reported in the last vst3_process call.
+   Returns the number of points available, or -1 on error. If they all fit in
+   max_points they are copied and the container is reset; otherwise only the first
+   max_points are copied and the points are kept, so the call can be repeated with a
+   buffer of the returned size before the next block. */
+int vst3_read_output_parameters(VST3Plugin* plugin, VST3ParameterPoint* points, int32_t max_points);
+
+/* Read back the MIDI events the plugin emitted in the last vst3_process call.
+   Events without a MIDI 1.0 equivalent are skipped. Returns the number of events
+   available, or -1 on error; as with vst3_read_output_parameters, a result larger
+   than max_events means only max_events were copied and the events are kept for a
+   retry with a larger buffer. */
+int vst3_read_output_events(VST3Plugin* plugin, VST3MidiEvent* events, int32_t max_events);
+
 /* MIDI event functions */
 int vst3_send_note_on(VST3Plugin* plugin, int32_t channel, int32_t note, int32_t velocity, int32_t sample_offset);
 int vst3_send_note_off(VST3Plugin* plugin, int32_t channel, int32_t note, int32_t sample_offset);
 int vst3_send_midi_cc(VST3Plugin* plugin, int32_t channel, int32_t cc, int32_t value, int32_t sample_offset);
+
+/* Queue a MIDI 1.0 channel message (note on/off, poly pressure, CC, program change,
+   channel pressure, pitch bend) for the next process call */
+int vst3_send_midi_event(VST3Plugin* plugin, const VST3MidiEvent* event);
+
+/* Program change for a MIDI channel (0-15). Delivered as a sample-accurate point on the
+   program-change parameter the plugin assigns to that channel (IMidiMapping, else the
+   program list of the channel's unit). If the program's state was cached with
+   vst3_cache_program_states, the cached state is restored instead, on the calling
+   thread before this returns, so the switch lands at the next block boundary; such a
+   call fails unless sample_offset is 0. Program changes among the events of process
+   jobs always use the parameter. Returns -1 if the plugin has no program change
+   parameter. */
 int vst3_send_program_change(VST3Plugin* plugin, int32_t channel, int32_t program, int32_t sample_offset);
 
+/* Program lists published by the plugin's controller (IUnitInfo) */
+int32_t vst3_get_program_list_count(VST3Plugin* plugin);
+int vst3_get_program_list_info(VST3Plugin* plugin, int32_t list_index, VST3ProgramListInfo* info);
+int vst3_get_program_name(VST3Plugin* plugin, int32_t list_index, int32_t program,
+                          char* name, int32_t name_size);
+
+/* Capture the state of every program in a list so later program changes become a
+   cached state restore. Requires vst3_setup_processing. Leaves the current state as it
+   was. Must not run concurrently with vst3_process, nor must vst3_clear_program_states.
+   Returns the number of programs cached, or -1 on error. */
+int vst3_cache_program_states(VST3Plugin* plugin, int32_t list_index);
+
+/* Drop cached program states */
+void vst3_clear_program_states(VST3Plugin* plugin, int32_t list_index);
+
+/* Serialize component and controller state into buffer.
+   Returns the total state size in bytes; nothing is written if buffer is NULL or
+   capacity is smaller than that size, so callers can query and retry. Returns -1 on error. */
+int64_t vst3_save_state(VST3Plugin* plugin, void* buffer, int64_t capacity);
+
+/* Restore state produced by vst3_save_state. Must not run concurrently with vst3_process
+   on the same instance. Returns 0 on success, -1 on error. */
+int vst3_load_state(VST3Plugin* plugin, const void* data, int64_t size);
+
+/* Load a .vstpreset file into the plugin. The preset must belong to the plugin's class.
+   Returns 0 on success, -1 on error. */
+int vst3_load_preset(VST3Plugin* plugin, const char* path);
+
+/* Save the plugin's component and controller state as a .vstpreset file */
+int vst3_save_preset(VST3Plugin* plugin, const char* path);
+
+/* Index all .vstpreset files below the given directories. Files are read on
+   num_threads workers (<= 0 for one per core); only each file's header, chunk list
+   and meta info are read. Returns NULL on error. */
+VST3PresetIndex* vst3_preset_index_create(const char* const* dirs, int32_t num_dirs, int32_t num_threads);
+
+/* Number of presets in the index */
+int32_t vst3_preset_index_count(VST3PresetIndex* index);
+
+/* Get information about the preset at position i */
+int vst3_preset_index_get(VST3PresetIndex* index, int32_t i, VST3PresetInfo* info);
+
+/* Position of the first preset with exactly this name, or -1 */
+int32_t vst3_preset_index_find(VST3PresetIndex* index, const char* name);
+
+/* Case-insensitive substring search over preset names. Writes up to max_results
+   positions to results and returns the number written, or -1 on error. */
+int32_t vst3_preset_index_search(VST3PresetIndex* index, const char* query,
+                                 int32_t* results, int32_t max_results);
+
+/* Apply the preset with this name that belongs to the plugin's class */
+int vst3_preset_index_apply(VST3PresetIndex* index, VST3Plugin* plugin, const char* name);
+
+/* Free a preset index */
+void vst3_preset_index_free(VST3PresetIndex* index);
+
+/* Create a pool of num_instances clones of a configured template plugin. The template
+   must be set up with vst3_setup_processing; its state is snapshotted and the clones are
+   created in parallel on num_threads workers (<= 0 for one per core) from the template's
+   already loaded module. Clones are set up with the same sample rate and block size and
+   left active. The template itself is not part of the pool. Returns NULL on error. */
+VST3PluginPool* vst3_pool_create(VST3Plugin* template_plugin, int32_t num_instances, int32_t num_threads);
+
+/* Number of instances in the pool, and how many are currently checked in */
+int32_t vst3_pool_size(VST3PluginPool* pool);
+int32_t vst3_pool_available(VST3PluginPool* pool);
+
+/* Take an instance out of the pool, or NULL if none is available. Thread-safe. */
+VST3Plugin* vst3_pool_checkout(VST3PluginPool* pool);
+
+/* Return a checked-out instance. It is reset to the template state and left active.
+   Thread-safe. Returns -1 if the instance is not checked out of this pool (including a
+   second checkin), or if it could not be reset; it is then unloaded and replaced by a
+   new clone, and the pool shrinks if cloning fails. */
+int vst3_pool_checkin(VST3PluginPool* pool, VST3Plugin* plugin);
+
+/* Unload all pooled instances and free the pool. Checked-out instances become invalid. */
+void vst3_pool_free(VST3PluginPool* pool);
+
+/* Processing latency in samples, updated when a reported latency change is applied */
+int32_t vst3_get_latency_samples(VST3Plugin* plugin);
+
+/* Restart flags (Steinberg::Vst::RestartFlags) the plugin has requested since the
+   last call, reported as soon as the plugin requests them. Latency changes, I/O
+   changes and parameter remapping are not applied on the processing thread: they wait
+   for vst3_apply_restart or the next vst3_set_active. */
+int32_t vst3_poll_restart_flags(VST3Plugin* plugin);
+
+/* Apply the latency changes, I/O changes and parameter remapping the plugin has
+   requested, cycling an active plugin through deactivation where it needs one. Call
+   from a control thread while the plugin is not being processed (for a plugin in a
+   chain, graph, stream or audio thread: while that is not processing). Afterwards the
+   latency and channel counts are current. Returns the flags applied, 0 if none. */
+int32_t vst3_apply_restart(VST3Plugin* plugin);
+
 /* Unload plugin */
 void vst3_unload_plugin(VST3Plugin* plugin);
 
@@ -0,0 +1,292 @@
+#ifndef VST3_HOST_INTERNAL_H
+#define VST3_HOST_INTERNAL_H
+
+// Internal definitions shared by the library's translation units.
+// Not part of the C API.
+
+#include "vst3_host.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+
+// VST3 SDK includes
+#include "public.sdk/source/vst/hosting/module.h"
+#include "public.sdk/source/vst/hosting/hostclasses.h"
+#include "public.sdk/source/vst/hosting/processdata.h"
+#include "public.sdk/source/vst/hosting/parameterchanges.h"
+#include "public.sdk/source/vst/hosting/eventlist.h"
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+#include "pluginterfaces/vst/ivsteditcontroller.h"
+#include "pluginterfaces/vst/ivstcomponent.h"
+#include "pluginterfaces/vst/ivstparameterchanges.h"
+#include "pluginterfaces/vst/ivstevents.h"
+#include "pluginterfaces/vst/vsttypes.h"
+
+namespace Steinberg { class MemoryStream; }
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+/* Lock-free mailbox of parameter values destined for the processor.
+   Any thread may post; the processing thread drains dirty slots into the
+   input parameter changes at the start of each block. The slot table is
+   immutable once published, so remapping parameters swaps in a new table
+   and keeps the old ones alive until the plugin is unloaded. */
+class ParameterMailbox {
+public:
+    ParameterMailbox() : table(nullptr), pending(0) {}
+
+    // Build a slot per controller parameter. Not concurrent with drain().
+    void rebuild(IEditController* controller) {
+        std::unique_ptr<Table> next(new Table());
+        int32 count = controller ? controller->getParameterCount() : 0;
+        next->ids.reserve(count);
+        next->slots.reset(new Slot[count > 0 ? count : 1]);
+        for (int32 i = 0; i < count; i++) {
+            ParameterInfo info;
+            if (controller->getParameterInfo(i, info) != kResultOk) continue;
+            next->index[info.id] = static_cast<int32>(next->ids.size());
+            next->ids.push_back(info.id);
+        }
+        table.store(next.get(), std::memory_order_release);
+        tables.push_back(std::move(next));
+    }
+
+    // sampleOffset places the change within the next block; a later post to the
+    // same parameter before that block replaces both value and offset
+    bool post(ParamID id, ParamValue value, int32 sampleOffset = 0) {
+        Table* t = table.load(std::memory_order_acquire);
+        if (!t) return false;
+        auto it = t->index.find(id);
+        if (it == t->index.end()) return false;
+
+        Slot& slot = t->slots[it->second];
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.offset.store(sampleOffset, std::memory_order_relaxed);
+        slot.dirty.store(true, std::memory_order_release);
+        pending.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    void drain(ParameterChanges& changes) {
+        if (pending.exchange(0, std::memory_order_acquire) == 0) return;
+
+        Table* t = table.load(std::memory_order_acquire);
+        int32 count = static_cast<int32>(t->ids.size());
+        for (int32 i = 0; i < count; i++) {
+            Slot& slot = t->slots[i];
+            if (!slot.dirty.exchange(false, std::memory_order_acquire)) continue;
+
+            int32 queueIndex = 0;
+            int32 pointIndex = 0;
+            IParamValueQueue* queue = changes.addParameterData(t->ids[i], queueIndex);
+            if (queue) {
+                queue->addPoint(slot.offset.load(std::memory_order_relaxed),
+                                slot.value.load(std::memory_order_relaxed), pointIndex);
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<double> value {0.0};
+        std::atomic<int32> offset {0};
+        std::atomic<bool> dirty {false};
+    };
+
+    struct Table {
+        std::unordered_map<ParamID, int32> index;
+        std::vector<ParamID> ids;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    std::atomic<Table*> table;
+    std::vector<std::unique_ptr<Table>> tables;
+    std::atomic<int32> pending;
+};
+
+/* Receives edits and restart requests initiated by the plugin's controller.
+   Owned by the VST3Plugin, so reference counting is a no-op. */
+class HostComponentHandler : public IComponentHandler {
+public:
+    explicit HostComponentHandler(VST3Plugin* plugin) : plugin(plugin) {}
+
+    tresult PLUGIN_API beginEdit(ParamID id) override;
+    tresult PLUGIN_API performEdit(ParamID id, ParamValue valueNormalized) override;
+    tresult PLUGIN_API endEdit(ParamID id) override;
+    tresult PLUGIN_API restartComponent(int32 flags) override;
+
+    tresult PLUGIN_API queryInterface(const TUID _iid, void** obj) override {
+        QUERY_INTERFACE(_iid, obj, FUnknown::iid, IComponentHandler)
+        QUERY_INTERFACE(_iid, obj, IComponentHandler::iid, IComponentHandler)
+        *obj = nullptr;
+        return kNoInterface;
+    }
+    uint32 PLUGIN_API addRef() override { return 1000; }
+    uint32 PLUGIN_API release() override { return 1000; }
+
+private:
+    VST3Plugin* plugin;
+};
+
+/* Captured component and controller state */
+struct CachedState {
+    std::vector<char> component;
+    std::vector<char> controller;
+};
+
+/* Program list exposed through IUnitInfo */
+struct ProgramList {
+    ProgramListID id;
+    std::string name;
+    std::vector<std::string> programs;
+    ParamID param_id;                       // Program-change parameter, kNoParamId if none
+    int32 step_count;                       // Of param_id; program p is sent as p / step_count
+    std::vector<CachedState> cached_states; // Per program, empty unless cached
+};
+
+/* Where a MIDI program change on one channel is delivered */
+struct ProgramChangeTarget {
+    ParamID param_id = kNoParamId;
+    int32 step_count = 0;
+    int32 list_index = -1;
+};
+
+static const int32 kNumMidiChannels = 16;
+
+/* A loaded bundle shared by all of its instances (see vst3_modules.cpp) */
+struct SharedModule {
+    std::string path;                       // Canonical bundle path, the cache key
+    VST3::Hosting::Module::Ptr module;
+    std::vector<VST3::Hosting::ClassInfo> classInfos;  // Read once from the factory
+    std::string vendor;
+
+    const VST3::Hosting::PluginFactory& factory() const { return module->getFactory(); }
+};
+
+// Thread running a plugin's submitted blocks (vst3_async.cpp)
+struct ProcessWorker;
+
+/* Plugin structure */
+struct VST3Plugin {
+    std::shared_ptr<SharedModule> module;
+    VST3::UID class_id;
+    VST3::Hosting::ClassInfo class_info;    // Entry of class_id in module->classInfos
+    IPtr<IComponent> component;
+    IPtr<IAudioProcessor> processor;
+    IPtr<IEditController> controller;
+
+    int32_t num_inputs;
+    int32_t num_outputs;
+    double sample_rate;
+    int32_t max_block_size;
+    bool active;
+
+    uint32_t load_flags = 0;                    // VST3_LOAD_* flags the instance was created with
+    bool controller_deferred = false;           // Controller not created yet (VST3_LOAD_LAZY_CONTROLLER)
+    std::vector<char> deferred_controller_state;
+
+    std::unique_ptr<HostComponentHandler> componentHandler;
+    ParameterMailbox paramMailbox;
+    std::atomic<int32_t> latency_samples {0};
+    std::atomic<int32_t> edits_in_progress {0};
+    std::atomic<int32_t> pending_restart {0};
+    std::atomic<int32_t> reported_restart {0};
+
+    std::vector<ProgramList> programLists;
+    ProgramChangeTarget programTargets[kNumMidiChannels];
+
+    int32_t sidechain_bus = -1;                 // Auxiliary input bus in use, -1 if none
+    int32_t sidechain_channels = 0;
+    std::vector<float> sidechain_silence;       // Read when a block has no sidechain source
+
+    ProcessWorker* worker = nullptr;            // Created by the first vst3_process_submit
+
+    std::vector<float*> input_buffers;
+    std::vector<float*> output_buffers;
+
+    HostProcessData processData;
+    ParameterChanges inputParameterChanges;
+    ParameterChanges outputParameterChanges;
+    EventList inputEvents;
+    EventList outputEvents;
+};
+
+// Load a bundle, or share the module already loaded for the same canonical path.
+// Thread-safe. Returns nullptr and sets error on failure.
+std::shared_ptr<SharedModule> acquire_module(const std::string& bundlePath, std::string& error);
+
+// Host context passed to every component and controller, created on first use.
+// Thread-safe.
+FUnknown* host_context();
+
+// Block until queued asynchronous loads have finished (vst3_loader.cpp)
+void wait_for_async_loads();
+
+// Create, initialize and connect component and controller for a class of an
+// already loaded module. With VST3_LOAD_LAZY_CONTROLLER
+// the controller is left to ensure_controller.
+VST3Plugin* instantiate_plugin(const std::shared_ptr<SharedModule>& module, const VST3::UID& classId,
+                               uint32_t flags = 0);
+
+// The plugin's controller, creating a deferred one on first use. nullptr if the
+// plugin has none, or if a deferred one would have to be created while the plugin is
+// active: it is only ever created while nothing can be processing.
+IEditController* ensure_controller(VST3Plugin* plugin);
+
+// Write component and controller state into the given streams.
+int capture_state(VST3Plugin* plugin, MemoryStream* componentStream, MemoryStream* controllerStream);
+
+// Restore component state and sync it to the controller, then restore controller state.
+// The buffers are only read, so they are wrapped without copying.
+int restore_state(VST3Plugin* plugin, const char* componentData, int64_t componentSize,
+                  const char* controllerData, int64_t controllerSize);
+
+// Deliver pending input parameter changes with a zero-length process call.
+// The plugin must be set up and active.
+int flush_parameters(VST3Plugin* plugin);
+
+// Activate the plugin's first auxiliary input bus for process_with_sidechain.
+// Returns its channel count, 0 if the plugin has none, -1 on failure.
+int32_t enable_sidechain(VST3Plugin* plugin);
+
+// vst3_process, also feeding the sidechain bus. Missing sidechain channels read silence.
+int process_with_sidechain(VST3Plugin* plugin, float** inputs, float** outputs,
+                           int32_t num_samples, int32_t num_input_channels,
+                           int32_t num_output_channels, float** sidechain,
+                           int32_t num_sidechain_channels);
+
+// Enumerate program lists and resolve the program change target of each MIDI channel
+void scan_program_lists(VST3Plugin* plugin);
+
+// Post a program change to the channel's program-change parameter, never restoring a
+// cached state or touching the controller, so the processing thread may call it.
+// Returns -1 if the channel has no such parameter.
+int post_program_change(VST3Plugin* plugin, int32_t channel, int32_t program, int32_t sample_offset);
+
+// vst3_send_midi_event for the processing thread (events of process jobs): program
+// changes go through post_program_change
+int queue_midi_event(VST3Plugin* plugin, const VST3MidiEvent* midi);
+
+// Finish the blocks submitted to the plugin and stop its worker thread, if any
+void stop_process_worker(VST3Plugin* plugin);
+
+// Channels a chain or graph processes (vst3_chain.cpp, vst3_graph.cpp)
+int32_t chain_channels(const VST3Chain* chain);
+int32_t graph_channels(const VST3Graph* graph);
+
+// Check that a VST3_AUDIO_TARGET_* target can process blocks of block_size samples with
+// the given channel counts, which for a chain or graph must both equal its own.
+// Prints the reason and returns false otherwise (vst3_audio_thread.cpp).
+bool check_audio_target(int32_t kind, void* target, int32_t block_size,
+                        int32_t num_input_channels, int32_t num_output_channels);
+
+// Process one block of a VST3_AUDIO_TARGET_* target. Channel counts apply to plugins;
+// chains and graphs use their own.
+int process_audio_target(int32_t kind, void* target, float** inputs, float** outputs,
+                         int32_t num_samples, int32_t num_input_channels, int32_t num_output_channels);
+
+#endif /* VST3_HOST_INTERNAL_H */
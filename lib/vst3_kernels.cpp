@@ -0,0 +1,308 @@
+// Mixing kernels with runtime CPU dispatch (see vst3_kernels.h)
+//
+// The x86-64 variants are compiled with per-function target attributes, so
+// the library itself still builds for the baseline ISA and only calls them
+// after checking the CPU. NEON is part of the ARM64 baseline and needs no check.
+
+#include "vst3_kernels.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VST3_KERNELS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VST3_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Scalar
+
+void clear_scalar(float* dst, int32_t n) {
+    memset(dst, 0, sizeof(float) * n);
+}
+
+void copy_gain_scalar(float* dst, const float* src, float gain, int32_t n) {
+    if (gain == 1.0f) {
+        if (dst != src) memmove(dst, src, sizeof(float) * n);
+        return;
+    }
+    for (int32_t i = 0; i < n; i++) dst[i] = gain * src[i];
+}
+
+void add_scalar(float* dst, const float* src, int32_t n) {
+    for (int32_t i = 0; i < n; i++) dst[i] += src[i];
+}
+
+void mul_add_scalar(float* dst, const float* src, float gain, int32_t n) {
+    for (int32_t i = 0; i < n; i++) dst[i] += gain * src[i];
+}
+
+void gain_ramp_scalar(float* dst, const float* src, float from, float to, int32_t n) {
+    const float step = n > 0 ? (to - from) / n : 0.0f;
+    for (int32_t i = 0; i < n; i++) dst[i] = (from + step * i) * src[i];
+}
+
+void mul_add_ramp_scalar(float* dst, const float* src, float from, float to, int32_t n) {
+    const float step = n > 0 ? (to - from) / n : 0.0f;
+    for (int32_t i = 0; i < n; i++) dst[i] += (from + step * i) * src[i];
+}
+
+const MixKernels kScalar = {
+    "scalar", clear_scalar, copy_gain_scalar, add_scalar, mul_add_scalar,
+    gain_ramp_scalar, mul_add_ramp_scalar
+};
+
+#if VST3_KERNELS_X86
+
+// AVX2 + FMA, 8 lanes
+
+__attribute__((target("avx2,fma")))
+void clear_avx2(float* dst, int32_t n) {
+    const __m256 zero = _mm256_setzero_ps();
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, zero);
+    for (; i < n; i++) dst[i] = 0.0f;
+}
+
+__attribute__((target("avx2,fma")))
+void copy_gain_avx2(float* dst, const float* src, float gain, int32_t n) {
+    if (gain == 1.0f) {
+        if (dst != src) memmove(dst, src, sizeof(float) * n);
+        return;
+    }
+    const __m256 g = _mm256_set1_ps(gain);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_mul_ps(g, _mm256_loadu_ps(src + i)));
+    for (; i < n; i++) dst[i] = gain * src[i];
+}
+
+__attribute__((target("avx2,fma")))
+void add_avx2(float* dst, const float* src, int32_t n) {
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+    }
+    for (; i < n; i++) dst[i] += src[i];
+}
+
+__attribute__((target("avx2,fma")))
+void mul_add_avx2(float* dst, const float* src, float gain, int32_t n) {
+    const __m256 g = _mm256_set1_ps(gain);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(g, _mm256_loadu_ps(src + i), _mm256_loadu_ps(dst + i)));
+    }
+    for (; i < n; i++) dst[i] += gain * src[i];
+}
+
+__attribute__((target("avx2,fma")))
+void gain_ramp_avx2(float* dst, const float* src, float from, float to, int32_t n) {
+    const float step = n > 0 ? (to - from) / n : 0.0f;
+    const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 s = _mm256_set1_ps(step);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 g = _mm256_fmadd_ps(s, _mm256_add_ps(lanes, _mm256_set1_ps(static_cast<float>(i))), _mm256_set1_ps(from));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(g, _mm256_loadu_ps(src + i)));
+    }
+    for (; i < n; i++) dst[i] = (from + step * i) * src[i];
+}
+
+__attribute__((target("avx2,fma")))
+void mul_add_ramp_avx2(float* dst, const float* src, float from, float to, int32_t n) {
+    const float step = n > 0 ? (to - from) / n : 0.0f;
+    const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 s = _mm256_set1_ps(step);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 g = _mm256_fmadd_ps(s, _mm256_add_ps(lanes, _mm256_set1_ps(static_cast<float>(i))), _mm256_set1_ps(from));
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(g, _mm256_loadu_ps(src + i), _mm256_loadu_ps(dst + i)));
+    }
+    for (; i < n; i++) dst[i] += (from + step * i) * src[i];
+}
+
+const MixKernels kAvx2 = {
+    "avx2", clear_avx2, copy_gain_avx2, add_avx2, mul_add_avx2,
+    gain_ramp_avx2, mul_add_ramp_avx2
+};
+
+// AVX-512F, 16 lanes; tails use masked loads and stores
+
+__attribute__((target("avx512f")))
+void clear_avx512(float* dst, int32_t n) {
+    const __m512 zero = _mm512_setzero_ps();
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) _mm512_storeu_ps(dst + i, zero);
+    if (i < n) _mm512_mask_storeu_ps(dst + i, static_cast<__mmask16>((1u << (n - i)) - 1), zero);
+}
+
+__attribute__((target("avx512f")))
+void copy_gain_avx512(float* dst, const float* src, float gain, int32_t n) {
+    if (gain == 1.0f) {
+        if (dst != src) memmove(dst, src, sizeof(float) * n);
+        return;
+    }
+    const __m512 g = _mm512_set1_ps(gain);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) _mm512_storeu_ps(dst + i, _mm512_mul_ps(g, _mm512_loadu_ps(src + i)));
+    if (i < n) {
+        __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_mul_ps(g, _mm512_maskz_loadu_ps(m, src + i)));
+    }
+}
+
+__attribute__((target("avx512f")))
+void add_avx512(float* dst, const float* src, int32_t n) {
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_loadu_ps(src + i)));
+    }
+    if (i < n) {
+        __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, dst + i),
+                                                        _mm512_maskz_loadu_ps(m, src + i)));
+    }
+}
+
+__attribute__((target("avx512f")))
+void mul_add_avx512(float* dst, const float* src, float gain, int32_t n) {
+    const __m512 g = _mm512_set1_ps(gain);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_fmadd_ps(g, _mm512_loadu_ps(src + i), _mm512_loadu_ps(dst + i)));
+    }
+    if (i < n) {
+        __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_fmadd_ps(g, _mm512_maskz_loadu_ps(m, src + i),
+                                                          _mm512_maskz_loadu_ps(m, dst + i)));
+    }
+}
+
+__attribute__((target("avx512f")))
+void gain_ramp_avx512(float* dst, const float* src, float from, float to, int32_t n) {
+    const float step = n > 0 ? (to - from) / n : 0.0f;
+    const __m512 lanes = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512 s = _mm512_set1_ps(step);
+    for (int32_t i = 0; i < n; i += 16) {
+        __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 g = _mm512_fmadd_ps(s, _mm512_add_ps(lanes, _mm512_set1_ps(static_cast<float>(i))), _mm512_set1_ps(from));
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_mul_ps(g, _mm512_maskz_loadu_ps(m, src + i)));
+    }
+}
+
+__attribute__((target("avx512f")))
+void mul_add_ramp_avx512(float* dst, const float* src, float from, float to, int32_t n) {
+    const float step = n > 0 ? (to - from) / n : 0.0f;
+    const __m512 lanes = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512 s = _mm512_set1_ps(step);
+    for (int32_t i = 0; i < n; i += 16) {
+        __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 g = _mm512_fmadd_ps(s, _mm512_add_ps(lanes, _mm512_set1_ps(static_cast<float>(i))), _mm512_set1_ps(from));
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_fmadd_ps(g, _mm512_maskz_loadu_ps(m, src + i),
+                                                          _mm512_maskz_loadu_ps(m, dst + i)));
+    }
+}
+
+const MixKernels kAvx512 = {
+    "avx512", clear_avx512, copy_gain_avx512, add_avx512, mul_add_avx512,
+    gain_ramp_avx512, mul_add_ramp_avx512
+};
+
+#endif // VST3_KERNELS_X86
+
+#if VST3_KERNELS_NEON
+
+// NEON, 4 lanes
+
+void clear_neon(float* dst, int32_t n) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, zero);
+    for (; i < n; i++) dst[i] = 0.0f;
+}
+
+void copy_gain_neon(float* dst, const float* src, float gain, int32_t n) {
+    if (gain == 1.0f) {
+        if (dst != src) memmove(dst, src, sizeof(float) * n);
+        return;
+    }
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(src + i), gain));
+    for (; i < n; i++) dst[i] = gain * src[i];
+}
+
+void add_neon(float* dst, const float* src, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+    for (; i < n; i++) dst[i] += src[i];
+}
+
+void mul_add_neon(float* dst, const float* src, float gain, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vfmaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+    for (; i < n; i++) dst[i] += gain * src[i];
+}
+
+void gain_ramp_neon(float* dst, const float* src, float from, float to, int32_t n) {
+    const float step = n > 0 ? (to - from) / n : 0.0f;
+    const float lanes[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    const float32x4_t base = vfmaq_n_f32(vdupq_n_f32(from), vld1q_f32(lanes), step);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t g = vaddq_f32(base, vdupq_n_f32(step * i));
+        vst1q_f32(dst + i, vmulq_f32(g, vld1q_f32(src + i)));
+    }
+    for (; i < n; i++) dst[i] = (from + step * i) * src[i];
+}
+
+void mul_add_ramp_neon(float* dst, const float* src, float from, float to, int32_t n) {
+    const float step = n > 0 ? (to - from) / n : 0.0f;
+    const float lanes[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    const float32x4_t base = vfmaq_n_f32(vdupq_n_f32(from), vld1q_f32(lanes), step);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t g = vaddq_f32(base, vdupq_n_f32(step * i));
+        vst1q_f32(dst + i, vfmaq_f32(vld1q_f32(dst + i), g, vld1q_f32(src + i)));
+    }
+    for (; i < n; i++) dst[i] += (from + step * i) * src[i];
+}
+
+const MixKernels kNeon = {
+    "neon", clear_neon, copy_gain_neon, add_neon, mul_add_neon,
+    gain_ramp_neon, mul_add_ramp_neon
+};
+
+#endif // VST3_KERNELS_NEON
+
+} // namespace
+
+int32_t available_mix_kernels(const MixKernels** sets, int32_t max_sets) {
+    int32_t count = 0;
+    auto offer = [&](const MixKernels& k) {
+        if (count < max_sets) sets[count] = &k;
+        count++;
+    };
+
+    offer(kScalar);
+#if VST3_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) offer(kAvx2);
+    if (__builtin_cpu_supports("avx512f")) offer(kAvx512);
+#elif VST3_KERNELS_NEON
+    offer(kNeon);
+#endif
+
+    return count < max_sets ? count : max_sets;
+}
+
+const MixKernels& mix_kernels() {
+    static const MixKernels* best = [] {
+        const MixKernels* sets[4];
+        int32_t count = available_mix_kernels(sets, 4);
+        return sets[count - 1];
+    }();
+    return *best;
+}
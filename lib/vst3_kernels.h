@@ -0,0 +1,38 @@
+#ifndef VST3_KERNELS_H
+#define VST3_KERNELS_H
+
+// Buffer kernels for mixing busses: clearing, copying and summing with gain.
+//
+// Each kernel set is a table of function pointers. mix_kernels() picks the
+// widest set the CPU supports on first use (AVX-512 or AVX2 on x86-64, NEON on
+// ARM64, scalar otherwise), so callers pay one indirect call per channel.
+// Buffers need no particular alignment. Ramps go linearly from `from` at the
+// first sample towards `to`, reaching it just after the last one, so
+// consecutive blocks join without a step.
+
+#include <stdint.h>
+
+struct MixKernels {
+    const char* name;
+
+    // dst = 0
+    void (*clear)(float* dst, int32_t n);
+    // dst = gain * src
+    void (*copy_gain)(float* dst, const float* src, float gain, int32_t n);
+    // dst += src
+    void (*add)(float* dst, const float* src, int32_t n);
+    // dst += gain * src
+    void (*mul_add)(float* dst, const float* src, float gain, int32_t n);
+    // dst = ramp * src (dst may be src)
+    void (*gain_ramp)(float* dst, const float* src, float from, float to, int32_t n);
+    // dst += ramp * src
+    void (*mul_add_ramp)(float* dst, const float* src, float from, float to, int32_t n);
+};
+
+// The fastest kernels this CPU runs. Thread-safe.
+const MixKernels& mix_kernels();
+
+// Every kernel set this CPU runs, scalar first. Returns the number written to sets.
+int32_t available_mix_kernels(const MixKernels** sets, int32_t max_sets);
+
+#endif /* VST3_KERNELS_H */
@@ -0,0 +1,116 @@
+// Asynchronous plugin loading
+//
+// Loads run on a process-wide loader pool, so a session can bring up many
+// plugins at once without blocking the caller for module loads and
+// component/controller initialization. Completion is signalled through an
+// optional callback (e.g. uv_async_send from Julia) and observed with
+// vst3_load_poll / vst3_load_wait.
+
+#include "vst3_host.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include "vst3_host_internal.h"
+#include "vst3_thread_pool.h"
+
+struct VST3LoadRequest {
+    std::string path;
+    std::string class_name_or_id;
+    double sample_rate;
+    int32_t block_size;
+    VST3LoadCallback callback;
+    void* user_data;
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    VST3Plugin* plugin = nullptr;
+};
+
+// Created on first use and never destroyed: a load may still be running at exit
+static std::mutex gLoaderMutex;
+static std::atomic<ThreadPool*> gLoaderPool {nullptr};
+
+static ThreadPool& loader_pool() {
+    ThreadPool* pool = gLoaderPool.load(std::memory_order_acquire);
+    if (pool) return *pool;
+
+    std::lock_guard<std::mutex> lock(gLoaderMutex);
+    pool = gLoaderPool.load(std::memory_order_relaxed);
+    if (!pool) {
+        pool = new ThreadPool(0);
+        gLoaderPool.store(pool, std::memory_order_release);
+    }
+    return *pool;
+}
+
+void wait_for_async_loads() {
+    ThreadPool* pool = gLoaderPool.load(std::memory_order_acquire);
+    if (pool) pool->wait();
+}
+
+static void run_load(VST3LoadRequest* request) {
+    const char* classSpec = request->class_name_or_id.empty() ? nullptr : request->class_name_or_id.c_str();
+    VST3Plugin* plugin = vst3_load_plugin_class(request->path.c_str(), classSpec);
+
+    if (plugin && request->block_size > 0 &&
+        vst3_setup_processing(plugin, request->sample_rate, request->block_size) != 0) {
+        vst3_unload_plugin(plugin);
+        plugin = nullptr;
+    }
+
+    // The callback runs under the request lock, so vst3_load_poll cannot report
+    // the load as done before it has returned: a caller that frees what user_data
+    // points to once the poll succeeds (Julia closes its AsyncCondition) never
+    // races the signal. The waiter may free the request as soon as the lock is
+    // released, so nothing in it is touched afterwards.
+    std::lock_guard<std::mutex> lock(request->mutex);
+    request->plugin = plugin;
+    request->done = true;
+    if (request->callback) request->callback(request->user_data);
+    request->finished.notify_all();
+}
+
+extern "C" {
+
+VST3LoadRequest* vst3_load_plugin_async(const char* bundle_path, const char* class_name_or_id,
+                                        double sample_rate, int32_t block_size,
+                                        VST3LoadCallback callback, void* user_data) {
+    if (!bundle_path) return nullptr;
+
+    VST3LoadRequest* request = new VST3LoadRequest();
+    request->path = bundle_path;
+    request->class_name_or_id = class_name_or_id ? class_name_or_id : "";
+    request->sample_rate = sample_rate;
+    request->block_size = block_size;
+    request->callback = callback;
+    request->user_data = user_data;
+
+    loader_pool().submit([request] { run_load(request); });
+    return request;
+}
+
+int vst3_load_poll(VST3LoadRequest* request) {
+    if (!request) return -1;
+    std::lock_guard<std::mutex> lock(request->mutex);
+    return request->done ? 1 : 0;
+}
+
+VST3Plugin* vst3_load_wait(VST3LoadRequest* request) {
+    if (!request) return nullptr;
+
+    VST3Plugin* plugin;
+    {
+        std::unique_lock<std::mutex> lock(request->mutex);
+        request->finished.wait(lock, [request] { return request->done; });
+        plugin = request->plugin;
+    }
+
+    delete request;
+    return plugin;
+}
+
+} // extern "C"
@@ -0,0 +1,108 @@
+// Process-wide cache of loaded plugin modules
+//
+// Every instance of a bundle shares one Module (and so one dlopen and one
+// factory) and the class list read from its factory. Entries are keyed by
+// canonical bundle path and held weakly: the module is unloaded when the last
+// instance holding it goes away.
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include <condition_variable>
+#include <mutex>
+
+#include "vst3_host_internal.h"
+
+// A cache slot. While loading is set the bundle is being opened by one thread
+// and everyone else asking for it waits on gModuleCacheChanged.
+struct ModuleCacheEntry {
+    std::weak_ptr<SharedModule> module;
+    bool loading = false;
+};
+
+static std::mutex gModuleCacheMutex;
+static std::condition_variable gModuleCacheChanged;
+static std::unordered_map<std::string, ModuleCacheEntry> gModuleCache;
+
+static std::string canonical_path(const std::string& path) {
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved)) {
+        return std::string(resolved);
+    }
+    return path;
+}
+
+// Runs when the last reference is dropped. Unloading under the cache lock, with
+// the expired entry still in place, makes a concurrent load of the same bundle
+// wait for the teardown to finish instead of overlapping with it.
+static void release_module(SharedModule* entry) {
+    {
+        std::lock_guard<std::mutex> lock(gModuleCacheMutex);
+        gModuleCache.erase(entry->path);
+        delete entry;
+    }
+    gModuleCacheChanged.notify_all();
+}
+
+// Bundles are opened (dlopen and the module entry point) without holding the
+// cache lock, so loads of different bundles run in parallel. Loads of one bundle
+// are collapsed into a single open.
+std::shared_ptr<SharedModule> acquire_module(const std::string& bundlePath, std::string& error) {
+    std::string path = canonical_path(bundlePath);
+
+    {
+        std::unique_lock<std::mutex> lock(gModuleCacheMutex);
+        for (;;) {
+            auto it = gModuleCache.find(path);
+            if (it == gModuleCache.end()) break;
+            if (!it->second.loading) {
+                if (auto shared = it->second.module.lock()) {
+                    return shared;
+                }
+            }
+            // Being opened by another thread, or expired and being unloaded
+            gModuleCacheChanged.wait(lock);
+        }
+        gModuleCache[path].loading = true;
+    }
+
+    auto module = VST3::Hosting::Module::create(path, error);
+    std::shared_ptr<SharedModule> shared;
+    if (module) {
+        SharedModule* entry = new SharedModule();
+        entry->path = path;
+        entry->module = module;
+        entry->classInfos = module->getFactory().classInfos();
+        entry->vendor = module->getFactory().info().vendor();
+        shared.reset(entry, release_module);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(gModuleCacheMutex);
+        if (shared) {
+            ModuleCacheEntry& slot = gModuleCache[path];
+            slot.module = shared;
+            slot.loading = false;
+        } else {
+            gModuleCache.erase(path);
+        }
+    }
+    gModuleCacheChanged.notify_all();
+    return shared;
+}
+
+extern "C" {
+
+int32_t vst3_get_loaded_module_count(void) {
+    std::lock_guard<std::mutex> lock(gModuleCacheMutex);
+    int32_t count = 0;
+    for (const auto& entry : gModuleCache) {
+        if (!entry.second.module.expired()) count++;
+    }
+    return count;
+}
+
+} // extern "C"
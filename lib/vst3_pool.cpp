@@ -0,0 +1,196 @@
+// Pool of identically configured plugin instances
+//
+// The pool snapshots the state of a configured template instance and creates
+// clones of the same class from the template's already loaded module, in
+// parallel. Clones stay set up and active; returning one restores the
+// template state and resets its processing so the next user starts clean. An
+// instance that cannot be reset is replaced by a new clone.
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+
+#include <mutex>
+#include <unordered_set>
+
+#include "vst3_host_internal.h"
+#include "vst3_thread_pool.h"
+#include "public.sdk/source/common/memorystream.h"
+
+struct VST3PluginPool {
+    std::shared_ptr<SharedModule> module;
+    VST3::UID class_id;
+    double sample_rate;
+    int32_t block_size;
+    uint32_t load_flags;
+    CachedState template_state;
+
+    std::mutex mutex;
+    std::vector<VST3Plugin*> instances;
+    std::unordered_set<VST3Plugin*> checked_out;
+    std::vector<VST3Plugin*> available;
+};
+
+static int reset_to_template(VST3PluginPool* pool, VST3Plugin* plugin) {
+    const CachedState& state = pool->template_state;
+
+    plugin->inputEvents.clear();
+    plugin->inputParameterChanges.clearQueue();
+
+    // Deactivating and reactivating clears tails and internal buffers
+    if (vst3_set_active(plugin, 0) != 0) return -1;
+    if (restore_state(plugin, state.component.data(), static_cast<int64_t>(state.component.size()),
+                      state.controller.data(), static_cast<int64_t>(state.controller.size())) != 0) {
+        return -1;
+    }
+    return vst3_set_active(plugin, 1);
+}
+
+static VST3Plugin* create_clone(VST3PluginPool* pool) {
+    VST3Plugin* plugin = instantiate_plugin(pool->module, pool->class_id, pool->load_flags);
+    if (!plugin) return nullptr;
+
+    if (vst3_setup_processing(plugin, pool->sample_rate, pool->block_size) != 0 ||
+        reset_to_template(pool, plugin) != 0) {
+        vst3_unload_plugin(plugin);
+        return nullptr;
+    }
+    return plugin;
+}
+
+extern "C" {
+
+VST3PluginPool* vst3_pool_create(VST3Plugin* template_plugin, int32_t num_instances, int32_t num_threads) {
+    if (!template_plugin || !template_plugin->module || num_instances <= 0) return nullptr;
+
+    if (template_plugin->max_block_size <= 0) {
+        fprintf(stderr, "Error: Template plugin must be set up with vst3_setup_processing\n");
+        return nullptr;
+    }
+
+    VST3PluginPool* pool = new VST3PluginPool();
+    pool->module = template_plugin->module;
+    pool->class_id = template_plugin->class_id;
+    pool->sample_rate = template_plugin->sample_rate;
+    pool->block_size = template_plugin->max_block_size;
+    pool->load_flags = template_plugin->load_flags;
+
+    auto componentStream = owned(new MemoryStream());
+    auto controllerStream = owned(new MemoryStream());
+    if (capture_state(template_plugin, componentStream, controllerStream) != 0) {
+        delete pool;
+        return nullptr;
+    }
+    const char* componentData = componentStream->getData();
+    const char* controllerData = controllerStream->getData();
+    pool->template_state.component.assign(componentData, componentData + componentStream->getSize());
+    pool->template_state.controller.assign(controllerData, controllerData + controllerStream->getSize());
+
+    // Each clone is written to its own slot, so workers never share state
+    std::vector<VST3Plugin*> clones(num_instances, nullptr);
+    {
+        ThreadPool workers(num_threads);
+        for (int32_t i = 0; i < num_instances; i++) {
+            workers.submit([pool, &clones, i] { clones[i] = create_clone(pool); });
+        }
+        workers.wait();
+    }
+
+    for (VST3Plugin* clone : clones) {
+        if (!clone) continue;
+        pool->instances.push_back(clone);
+        pool->available.push_back(clone);
+    }
+
+    if (pool->instances.size() != static_cast<size_t>(num_instances)) {
+        fprintf(stderr, "Warning: Created %zu of %d pool instances\n",
+                pool->instances.size(), num_instances);
+    }
+
+    if (pool->instances.empty()) {
+        delete pool;
+        return nullptr;
+    }
+
+    return pool;
+}
+
+int32_t vst3_pool_size(VST3PluginPool* pool) {
+    if (!pool) return 0;
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    return static_cast<int32_t>(pool->instances.size());
+}
+
+int32_t vst3_pool_available(VST3PluginPool* pool) {
+    if (!pool) return 0;
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    return static_cast<int32_t>(pool->available.size());
+}
+
+VST3Plugin* vst3_pool_checkout(VST3PluginPool* pool) {
+    if (!pool) return nullptr;
+
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    if (pool->available.empty()) return nullptr;
+
+    VST3Plugin* plugin = pool->available.back();
+    pool->available.pop_back();
+    pool->checked_out.insert(plugin);
+    return plugin;
+}
+
+int vst3_pool_checkin(VST3PluginPool* pool, VST3Plugin* plugin) {
+    if (!pool || !plugin) return -1;
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (pool->checked_out.erase(plugin) == 0) {
+            fprintf(stderr, "Error: Instance is not checked out of this pool\n");
+            return -1;
+        }
+    }
+
+    // Reset outside the lock; other threads can keep checking instances in and out
+    if (reset_to_template(pool, plugin) == 0) {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->available.push_back(plugin);
+        return 0;
+    }
+
+    // An instance in an unknown state is never handed out again: replace it with
+    // a fresh clone, or shrink the pool if that fails too
+    fprintf(stderr, "Warning: Failed to reset pooled instance to template state, replacing it\n");
+    if (plugin->active) vst3_set_active(plugin, 0);
+    vst3_unload_plugin(plugin);
+    VST3Plugin* clone = create_clone(pool);
+
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    for (VST3Plugin*& instance : pool->instances) {
+        if (instance != plugin) continue;
+        if (clone) {
+            instance = clone;
+            pool->available.push_back(clone);
+        } else {
+            instance = pool->instances.back();
+            pool->instances.pop_back();
+            fprintf(stderr, "Warning: Pool shrank to %zu instances\n", pool->instances.size());
+        }
+        break;
+    }
+    return -1;
+}
+
+void vst3_pool_free(VST3PluginPool* pool) {
+    if (!pool) return;
+
+    for (VST3Plugin* plugin : pool->instances) {
+        if (plugin->active) {
+            vst3_set_active(plugin, 0);
+        }
+        vst3_unload_plugin(plugin);
+    }
+
+    delete pool;
+}
+
+} // extern "C"
@@ -0,0 +1,425 @@
+// .vstpreset file support and preset directory indexing
+//
+// File layout (all integers little-endian):
+//   header:  'VST3', int32 version, char[32] class ID, int64 chunk list offset
+//   data:    chunk payloads ('Comp', 'Cont', 'Info', ...)
+//   list:    'List', int32 entry count, entries of { char[4] id, int64 offset, int64 size }
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+
+#include "vst3_host_internal.h"
+#include "vst3_thread_pool.h"
+#include "public.sdk/source/common/memorystream.h"
+
+namespace {
+
+const int32_t kPresetFormatVersion = 1;
+const int64_t kClassIDSize = 32;
+const int64_t kPresetHeaderSize = 48;
+const int64_t kListOffsetPos = 40;
+const int64_t kListEntrySize = 20;
+
+// Files handed to one indexing task
+const size_t kFilesPerTask = 64;
+
+/* Read-only memory mapping of a whole file */
+class MappedFile {
+public:
+    explicit MappedFile(const char* path) : data(nullptr), size(0) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const char*>(mapped);
+                size = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data;
+    size_t size;
+};
+
+/* Location of the chunks of interest within a preset file */
+struct PresetLayout {
+    std::string class_id;
+    int64_t component_offset = 0;
+    int64_t component_size = 0;
+    int64_t controller_offset = 0;
+    int64_t controller_size = 0;
+    int64_t info_offset = 0;
+    int64_t info_size = 0;
+};
+
+template <typename T>
+T read_le(const char* p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+bool chunk_in_bounds(int64_t offset, int64_t size, size_t fileSize) {
+    return offset >= 0 && size >= 0 &&
+           static_cast<uint64_t>(offset) <= fileSize &&
+           static_cast<uint64_t>(size) <= fileSize - static_cast<uint64_t>(offset);
+}
+
+// Parse the header and chunk list only; chunk payloads are not touched
+bool parse_layout(const char* data, size_t size, PresetLayout& layout) {
+    if (size < static_cast<size_t>(kPresetHeaderSize)) return false;
+    if (memcmp(data, "VST3", 4) != 0) return false;
+    if (read_le<int32_t>(data + 4) < kPresetFormatVersion) return false;
+
+    layout.class_id.assign(data + 8, kClassIDSize);
+
+    int64_t listOffset = read_le<int64_t>(data + kListOffsetPos);
+    if (!chunk_in_bounds(listOffset, 8, size)) return false;
+    if (memcmp(data + listOffset, "List", 4) != 0) return false;
+
+    int32_t count = read_le<int32_t>(data + listOffset + 4);
+    if (count < 0 || !chunk_in_bounds(listOffset + 8, count * kListEntrySize, size)) return false;
+
+    for (int32_t i = 0; i < count; i++) {
+        const char* entry = data + listOffset + 8 + i * kListEntrySize;
+        int64_t offset = read_le<int64_t>(entry + 4);
+        int64_t chunkSize = read_le<int64_t>(entry + 12);
+        if (!chunk_in_bounds(offset, chunkSize, size)) return false;
+
+        if (memcmp(entry, "Comp", 4) == 0) {
+            layout.component_offset = offset;
+            layout.component_size = chunkSize;
+        } else if (memcmp(entry, "Cont", 4) == 0) {
+            layout.controller_offset = offset;
+            layout.controller_size = chunkSize;
+        } else if (memcmp(entry, "Info", 4) == 0) {
+            layout.info_offset = offset;
+            layout.info_size = chunkSize;
+        }
+    }
+
+    return layout.component_size > 0;
+}
+
+// Extract value="..." of <Attr id="key" .../> from the XML meta info chunk
+std::string meta_attribute(const char* xml, size_t size, const char* key) {
+    std::string needle = std::string("id=\"") + key + "\"";
+    const char* end = xml + size;
+    const char* found = std::search(xml, end, needle.begin(), needle.end());
+    if (found == end) return std::string();
+
+    const char* tagEnd = std::find(found, end, '>');
+    const char* valueAttr = "value=\"";
+    const char* value = std::search(found, tagEnd, valueAttr, valueAttr + 7);
+    if (value == tagEnd) return std::string();
+
+    value += 7;
+    const char* valueEnd = std::find(value, tagEnd, '"');
+    return std::string(value, valueEnd);
+}
+
+bool same_class_id(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (toupper(static_cast<unsigned char>(a[i])) != toupper(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool check_class(VST3Plugin* plugin, const std::string& classId, const char* path) {
+    if (!same_class_id(classId, plugin->class_id.toString(false))) {
+        fprintf(stderr, "Error: Preset %s belongs to a different plugin class\n", path);
+        return false;
+    }
+    return true;
+}
+
+int apply_layout(VST3Plugin* plugin, const MappedFile& file, const PresetLayout& layout) {
+    return restore_state(plugin,
+                         file.data + layout.component_offset, layout.component_size,
+                         file.data + layout.controller_offset, layout.controller_size);
+}
+
+void copy_string(char* dest, size_t destSize, const std::string& src) {
+    strncpy(dest, src.c_str(), destSize - 1);
+    dest[destSize - 1] = '\0';
+}
+
+bool is_preset_file(const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return ext == ".vstpreset";
+}
+
+} // namespace
+
+/* In-memory index of preset files */
+struct VST3PresetIndex {
+    struct Entry {
+        std::string name;
+        std::string plugin_name;
+        std::string category;
+        std::string path;
+        PresetLayout layout;
+    };
+
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, std::vector<int32_t>> by_name;
+};
+
+static bool index_file(const std::string& path, VST3PresetIndex::Entry& entry) {
+    MappedFile file(path.c_str());
+    if (!file.data) return false;
+    if (!parse_layout(file.data, file.size, entry.layout)) return false;
+
+    const char* info = file.data + entry.layout.info_offset;
+    size_t infoSize = static_cast<size_t>(entry.layout.info_size);
+
+    entry.path = path;
+    entry.name = meta_attribute(info, infoSize, "Name");
+    entry.plugin_name = meta_attribute(info, infoSize, "PlugInName");
+    entry.category = meta_attribute(info, infoSize, "PlugInCategory");
+    if (entry.name.empty()) {
+        entry.name = std::filesystem::path(path).stem().string();
+    }
+    return true;
+}
+
+extern "C" {
+
+int vst3_load_preset(VST3Plugin* plugin, const char* path) {
+    if (!plugin || !plugin->component || !path) return -1;
+
+    MappedFile file(path);
+    if (!file.data) {
+        fprintf(stderr, "Error: Cannot read preset %s\n", path);
+        return -1;
+    }
+
+    PresetLayout layout;
+    if (!parse_layout(file.data, file.size, layout)) {
+        fprintf(stderr, "Error: Not a valid .vstpreset file: %s\n", path);
+        return -1;
+    }
+
+    if (!check_class(plugin, layout.class_id, path)) return -1;
+    return apply_layout(plugin, file, layout);
+}
+
+int vst3_save_preset(VST3Plugin* plugin, const char* path) {
+    if (!plugin || !plugin->component || !path) return -1;
+
+    auto componentStream = owned(new MemoryStream());
+    auto controllerStream = owned(new MemoryStream());
+    if (capture_state(plugin, componentStream, controllerStream) != 0) {
+        return -1;
+    }
+
+    int64_t componentSize = componentStream->getSize();
+    int64_t controllerSize = controllerStream->getSize();
+    int64_t componentOffset = kPresetHeaderSize;
+    int64_t controllerOffset = componentOffset + componentSize;
+    int64_t listOffset = controllerOffset + controllerSize;
+    int32_t numChunks = controllerSize > 0 ? 2 : 1;
+
+    std::vector<char> out(static_cast<size_t>(listOffset + 8 + numChunks * kListEntrySize));
+    char* p = out.data();
+
+    std::string classId = plugin->class_id.toString(false);
+    memcpy(p, "VST3", 4);
+    memcpy(p + 4, &kPresetFormatVersion, 4);
+    memset(p + 8, 0, kClassIDSize);
+    memcpy(p + 8, classId.data(), std::min<size_t>(classId.size(), kClassIDSize));
+    memcpy(p + kListOffsetPos, &listOffset, 8);
+
+    if (componentSize > 0) {
+        memcpy(p + componentOffset, componentStream->getData(), componentSize);
+    }
+    if (controllerSize > 0) {
+        memcpy(p + controllerOffset, controllerStream->getData(), controllerSize);
+    }
+
+    char* list = p + listOffset;
+    memcpy(list, "List", 4);
+    memcpy(list + 4, &numChunks, 4);
+
+    char* entry = list + 8;
+    memcpy(entry, "Comp", 4);
+    memcpy(entry + 4, &componentOffset, 8);
+    memcpy(entry + 12, &componentSize, 8);
+    if (controllerSize > 0) {
+        entry += kListEntrySize;
+        memcpy(entry, "Cont", 4);
+        memcpy(entry + 4, &controllerOffset, 8);
+        memcpy(entry + 12, &controllerSize, 8);
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write preset %s\n", path);
+        return -1;
+    }
+    size_t written = fwrite(out.data(), 1, out.size(), f);
+    int closed = fclose(f);
+    if (written != out.size() || closed != 0) {
+        fprintf(stderr, "Error: Failed writing preset %s\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+VST3PresetIndex* vst3_preset_index_create(const char* const* dirs, int32_t num_dirs, int32_t num_threads) {
+    if (!dirs || num_dirs < 0) return nullptr;
+
+    // Collect candidate files; directory walking is cheap next to reading files
+    std::vector<std::string> files;
+    for (int32_t d = 0; d < num_dirs; d++) {
+        if (!dirs[d]) continue;
+
+        std::error_code ec;
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (std::filesystem::recursive_directory_iterator it(dirs[d], options, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && is_preset_file(it->path())) {
+                files.push_back(it->path().string());
+            }
+        }
+        if (ec) {
+            fprintf(stderr, "Warning: Error scanning preset directory %s: %s\n",
+                    dirs[d], ec.message().c_str());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    // Each task indexes a contiguous range into its own slots, so no locking is needed
+    std::vector<VST3PresetIndex::Entry> parsed(files.size());
+    std::vector<char> ok(files.size(), 0);
+    {
+        ThreadPool pool(num_threads);
+        for (size_t begin = 0; begin < files.size(); begin += kFilesPerTask) {
+            size_t end = std::min(begin + kFilesPerTask, files.size());
+            pool.submit([&, begin, end] {
+                for (size_t i = begin; i < end; i++) {
+                    ok[i] = index_file(files[i], parsed[i]) ? 1 : 0;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    VST3PresetIndex* index = new VST3PresetIndex();
+    index->entries.reserve(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!ok[i]) continue;
+        int32_t id = static_cast<int32_t>(index->entries.size());
+        index->by_name[parsed[i].name].push_back(id);
+        index->entries.push_back(std::move(parsed[i]));
+    }
+
+    return index;
+}
+
+int32_t vst3_preset_index_count(VST3PresetIndex* index) {
+    if (!index) return 0;
+    return static_cast<int32_t>(index->entries.size());
+}
+
+int vst3_preset_index_get(VST3PresetIndex* index, int32_t i, VST3PresetInfo* info) {
+    if (!index || !info || i < 0 || i >= static_cast<int32_t>(index->entries.size())) return -1;
+
+    const auto& entry = index->entries[i];
+    copy_string(info->name, sizeof(info->name), entry.name);
+    copy_string(info->plugin_name, sizeof(info->plugin_name), entry.plugin_name);
+    copy_string(info->category, sizeof(info->category), entry.category);
+    copy_string(info->class_id, sizeof(info->class_id), entry.layout.class_id);
+    copy_string(info->path, sizeof(info->path), entry.path);
+    return 0;
+}
+
+int32_t vst3_preset_index_find(VST3PresetIndex* index, const char* name) {
+    if (!index || !name) return -1;
+
+    auto it = index->by_name.find(name);
+    if (it == index->by_name.end()) return -1;
+    return it->second.front();
+}
+
+int32_t vst3_preset_index_search(VST3PresetIndex* index, const char* query,
+                                 int32_t* results, int32_t max_results) {
+    if (!index || !query || (!results && max_results > 0)) return -1;
+
+    auto lower = [](unsigned char c) { return static_cast<char>(tolower(c)); };
+    std::string needle(query);
+    std::transform(needle.begin(), needle.end(), needle.begin(), lower);
+
+    int32_t found = 0;
+    std::string name;
+    for (size_t i = 0; i < index->entries.size() && found < max_results; i++) {
+        name = index->entries[i].name;
+        std::transform(name.begin(), name.end(), name.begin(), lower);
+        if (name.find(needle) != std::string::npos) {
+            results[found++] = static_cast<int32_t>(i);
+        }
+    }
+    return found;
+}
+
+int vst3_preset_index_apply(VST3PresetIndex* index, VST3Plugin* plugin, const char* name) {
+    if (!index || !plugin || !plugin->component || !name) return -1;
+
+    auto it = index->by_name.find(name);
+    if (it == index->by_name.end()) {
+        fprintf(stderr, "Error: No preset named '%s'\n", name);
+        return -1;
+    }
+
+    // Several plugins may share a preset name; pick the one for this class
+    std::string classId = plugin->class_id.toString(false);
+    for (int32_t id : it->second) {
+        const auto& entry = index->entries[id];
+        if (!same_class_id(entry.layout.class_id, classId)) continue;
+
+        MappedFile file(entry.path.c_str());
+        PresetLayout layout;
+        if (!file.data || !parse_layout(file.data, file.size, layout)) {
+            fprintf(stderr, "Error: Preset file changed or unreadable: %s\n", entry.path.c_str());
+            return -1;
+        }
+        return apply_layout(plugin, file, layout);
+    }
+
+    fprintf(stderr, "Error: No preset named '%s' for this plugin class\n", name);
+    return -1;
+}
+
+void vst3_preset_index_free(VST3PresetIndex* index) {
+    delete index;
+}
+
+} // extern "C"
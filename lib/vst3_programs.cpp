@@ -0,0 +1,312 @@
+// Program lists (IUnitInfo) and MIDI program change handling
+//
+// A MIDI program change is delivered the way VST3 expects: as a
+// sample-accurate point on the plugin's program-change parameter. The
+// parameter for a MIDI channel comes from IMidiMapping if the controller
+// assigns one, otherwise from the program list of the unit that owns the
+// channel (falling back to the root unit). Programs can optionally have their
+// state captured up front so that switching is a cached state restore, done by
+// the processing thread at the next block boundary.
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "vst3_host_internal.h"
+
+#include "public.sdk/source/vst/utility/stringconvert.h"
+#include "public.sdk/source/common/memorystream.h"
+#include "pluginterfaces/vst/ivstunits.h"
+#include "pluginterfaces/vst/ivstmidicontrollers.h"
+
+static int32 find_program_list(VST3Plugin* plugin, ProgramListID id) {
+    for (size_t i = 0; i < plugin->programLists.size(); i++) {
+        if (plugin->programLists[i].id == id) return static_cast<int32>(i);
+    }
+    return -1;
+}
+
+// Normalized value of a program on a program-change parameter with stepCount steps
+static ParamValue program_value(int32 program, int32 stepCount) {
+    if (stepCount <= 0) return 0.0;
+    return static_cast<ParamValue>(program > stepCount ? stepCount : program) / stepCount;
+}
+
+static std::vector<char> copy_stream(MemoryStream* stream) {
+    const char* data = stream->getData();
+    return std::vector<char>(data, data + stream->getSize());
+}
+
+void scan_program_lists(VST3Plugin* plugin) {
+    plugin->programLists.clear();
+    for (auto& target : plugin->programTargets) {
+        target = ProgramChangeTarget();
+    }
+
+    if (!plugin->controller) return;
+
+    // Program-change parameters, keyed by the unit that owns them
+    std::unordered_map<UnitID, ParameterInfo> programParams;
+    std::unordered_map<ParamID, int32> stepCounts;
+    int32 numParams = plugin->controller->getParameterCount();
+    for (int32 i = 0; i < numParams; i++) {
+        ParameterInfo info;
+        if (plugin->controller->getParameterInfo(i, info) != kResultOk) continue;
+        if (info.flags & ParameterInfo::kIsProgramChange) {
+            programParams[info.unitId] = info;
+            stepCounts[info.id] = info.stepCount;
+        }
+    }
+
+    FUnknownPtr<IUnitInfo> unitInfo(plugin->controller);
+    std::unordered_map<UnitID, ProgramListID> unitLists;
+
+    if (unitInfo) {
+        namespace StringConvert = Steinberg::Vst::StringConvert;
+
+        int32 numLists = unitInfo->getProgramListCount();
+        for (int32 i = 0; i < numLists; i++) {
+            ProgramListInfo listInfo;
+            if (unitInfo->getProgramListInfo(i, listInfo) != kResultOk) continue;
+
+            ProgramList list;
+            list.id = listInfo.id;
+            list.name = StringConvert::convert(listInfo.name);
+            list.param_id = kNoParamId;
+            list.step_count = 0;
+            for (int32 p = 0; p < listInfo.programCount; p++) {
+                String128 name = {};
+                unitInfo->getProgramName(listInfo.id, p, name);
+                list.programs.push_back(StringConvert::convert(name));
+            }
+            plugin->programLists.push_back(std::move(list));
+        }
+
+        // Bind each list to the program-change parameter of the unit using it
+        int32 numUnits = unitInfo->getUnitCount();
+        for (int32 i = 0; i < numUnits; i++) {
+            UnitInfo unit;
+            if (unitInfo->getUnitInfo(i, unit) != kResultOk) continue;
+            if (unit.programListId == kNoProgramListId) continue;
+
+            unitLists[unit.id] = unit.programListId;
+            int32 listIndex = find_program_list(plugin, unit.programListId);
+            auto param = programParams.find(unit.id);
+            if (listIndex >= 0 && param != programParams.end()) {
+                plugin->programLists[listIndex].param_id = param->second.id;
+                plugin->programLists[listIndex].step_count = param->second.stepCount;
+            }
+        }
+    }
+
+    // Resolve the program change target of every MIDI channel
+    FUnknownPtr<IMidiMapping> midiMapping(plugin->controller);
+    for (int32 channel = 0; channel < kNumMidiChannels; channel++) {
+        ProgramChangeTarget& target = plugin->programTargets[channel];
+
+        ParamID mapped = kNoParamId;
+        if (midiMapping &&
+            midiMapping->getMidiControllerAssignment(0, static_cast<int16>(channel),
+                                                     kCtrlProgramChange, mapped) == kResultOk) {
+            auto steps = stepCounts.find(mapped);
+            if (steps == stepCounts.end()) {
+                ParameterInfo info;
+                for (int32 i = 0; i < numParams; i++) {
+                    if (plugin->controller->getParameterInfo(i, info) == kResultOk && info.id == mapped) {
+                        stepCounts[mapped] = info.stepCount;
+                        break;
+                    }
+                }
+                steps = stepCounts.find(mapped);
+            }
+            target.param_id = mapped;
+            target.step_count = steps != stepCounts.end() ? steps->second : 0;
+        }
+
+        UnitID unit = kRootUnitId;
+        if (unitInfo) {
+            UnitID channelUnit;
+            if (unitInfo->getUnitByBus(kEvent, kInput, 0, channel, channelUnit) == kResultOk) {
+                unit = channelUnit;
+            }
+        }
+
+        auto list = unitLists.find(unit);
+        if (list == unitLists.end()) list = unitLists.find(kRootUnitId);
+        if (list != unitLists.end()) {
+            target.list_index = find_program_list(plugin, list->second);
+        }
+
+        if (target.param_id == kNoParamId) {
+            auto param = programParams.find(unit);
+            if (param == programParams.end()) param = programParams.find(kRootUnitId);
+            if (param == programParams.end() && programParams.size() == 1) param = programParams.begin();
+            if (param != programParams.end()) {
+                target.param_id = param->second.id;
+                target.step_count = param->second.stepCount;
+            }
+        }
+    }
+}
+
+int post_program_change(VST3Plugin* plugin, int32_t channel, int32_t program, int32_t sample_offset) {
+    if (!plugin || channel < 0 || channel >= kNumMidiChannels || program < 0) return -1;
+
+    const ProgramChangeTarget& target = plugin->programTargets[channel];
+    if (target.param_id == kNoParamId) return -1;
+
+    ParamValue value = program_value(program, target.step_count);
+    return plugin->paramMailbox.post(target.param_id, value, sample_offset) ? 0 : -1;
+}
+
+extern "C" {
+
+int vst3_send_program_change(VST3Plugin* plugin, int32_t channel, int32_t program, int32_t sample_offset) {
+    if (!plugin || channel < 0 || channel >= kNumMidiChannels || program < 0) return -1;
+    ensure_controller(plugin);
+
+    const ProgramChangeTarget& target = plugin->programTargets[channel];
+
+    // Cached program state: restored here, on the calling thread, so the switch takes
+    // effect from the next block and cannot land within one
+    if (target.list_index >= 0) {
+        const ProgramList& list = plugin->programLists[target.list_index];
+        if (program < static_cast<int32_t>(list.cached_states.size())) {
+            if (sample_offset != 0) {
+                fprintf(stderr, "Error: Cached program %d switches at a block boundary; sample offset must be 0\n",
+                        program);
+                return -1;
+            }
+            const CachedState& state = list.cached_states[program];
+            return restore_state(plugin, state.component.data(), static_cast<int64_t>(state.component.size()),
+                                 state.controller.data(), static_cast<int64_t>(state.controller.size()));
+        }
+    }
+
+    if (target.param_id == kNoParamId) {
+        fprintf(stderr, "Error: Plugin has no program change parameter for channel %d\n", channel);
+        return -1;
+    }
+
+    if (post_program_change(plugin, channel, program, sample_offset) != 0) {
+        return -1;
+    }
+
+    if (plugin->controller) {
+        plugin->controller->setParamNormalized(target.param_id, program_value(program, target.step_count));
+    }
+
+    return 0;
+}
+
+int32_t vst3_get_program_list_count(VST3Plugin* plugin) {
+    if (!plugin) return 0;
+    ensure_controller(plugin);
+    return static_cast<int32_t>(plugin->programLists.size());
+}
+
+int vst3_get_program_list_info(VST3Plugin* plugin, int32_t list_index, VST3ProgramListInfo* info) {
+    if (plugin) ensure_controller(plugin);
+    if (!plugin || !info || list_index < 0 ||
+        list_index >= static_cast<int32_t>(plugin->programLists.size())) return -1;
+
+    const ProgramList& list = plugin->programLists[list_index];
+    info->id = list.id;
+    strncpy(info->name, list.name.c_str(), sizeof(info->name) - 1);
+    info->name[sizeof(info->name) - 1] = '\0';
+    info->program_count = static_cast<int32_t>(list.programs.size());
+    info->param_id = list.param_id == kNoParamId ? -1 : static_cast<int32_t>(list.param_id);
+    info->num_cached = static_cast<int32_t>(list.cached_states.size());
+    return 0;
+}
+
+int vst3_get_program_name(VST3Plugin* plugin, int32_t list_index, int32_t program,
+                          char* name, int32_t name_size) {
+    if (plugin) ensure_controller(plugin);
+    if (!plugin || !name || name_size <= 0 || list_index < 0 ||
+        list_index >= static_cast<int32_t>(plugin->programLists.size())) return -1;
+
+    const ProgramList& list = plugin->programLists[list_index];
+    if (program < 0 || program >= static_cast<int32_t>(list.programs.size())) return -1;
+
+    strncpy(name, list.programs[program].c_str(), name_size - 1);
+    name[name_size - 1] = '\0';
+    return 0;
+}
+
+int vst3_cache_program_states(VST3Plugin* plugin, int32_t list_index) {
+    if (plugin) ensure_controller(plugin);
+    if (!plugin || !plugin->component || list_index < 0 ||
+        list_index >= static_cast<int32_t>(plugin->programLists.size())) return -1;
+
+    ProgramList& list = plugin->programLists[list_index];
+    if (list.param_id == kNoParamId) {
+        fprintf(stderr, "Error: Program list '%s' has no program change parameter\n", list.name.c_str());
+        return -1;
+    }
+    if (plugin->max_block_size <= 0) {
+        fprintf(stderr, "Error: Call vst3_setup_processing before caching program states\n");
+        return -1;
+    }
+
+    // Keep the current state so the plugin is left as it was found
+    auto originalComponent = owned(new MemoryStream());
+    auto originalController = owned(new MemoryStream());
+    if (capture_state(plugin, originalComponent, originalController) != 0) return -1;
+
+    bool wasActive = plugin->active;
+    if (!wasActive && vst3_set_active(plugin, 1) != 0) return -1;
+
+    int32 numPrograms = static_cast<int32>(list.programs.size());
+    std::vector<CachedState> states;
+    states.reserve(numPrograms);
+
+    int result = 0;
+    for (int32 p = 0; p < numPrograms && result == 0; p++) {
+        ParamValue value = program_value(p, list.step_count);
+        plugin->controller->setParamNormalized(list.param_id, value);
+
+        // Let the processor switch program through a parameter flush
+        int32 queueIndex = 0;
+        int32 pointIndex = 0;
+        IParamValueQueue* queue = plugin->inputParameterChanges.addParameterData(list.param_id, queueIndex);
+        if (!queue || queue->addPoint(0, value, pointIndex) != kResultOk || flush_parameters(plugin) != 0) {
+            result = -1;
+            break;
+        }
+
+        auto componentStream = owned(new MemoryStream());
+        auto controllerStream = owned(new MemoryStream());
+        if (capture_state(plugin, componentStream, controllerStream) != 0) {
+            result = -1;
+            break;
+        }
+
+        CachedState state;
+        state.component = copy_stream(componentStream);
+        state.controller = copy_stream(controllerStream);
+        states.push_back(std::move(state));
+    }
+
+    if (!wasActive) vst3_set_active(plugin, 0);
+
+    restore_state(plugin, originalComponent->getData(), originalComponent->getSize(),
+                  originalController->getData(), originalController->getSize());
+
+    if (result != 0) {
+        fprintf(stderr, "Error: Failed to capture program states for '%s'\n", list.name.c_str());
+        return -1;
+    }
+
+    list.cached_states = std::move(states);
+    return static_cast<int>(list.cached_states.size());
+}
+
+void vst3_clear_program_states(VST3Plugin* plugin, int32_t list_index) {
+    if (!plugin || list_index < 0 || list_index >= static_cast<int32_t>(plugin->programLists.size())) return;
+    plugin->programLists[list_index].cached_states.clear();
+    plugin->programLists[list_index].cached_states.shrink_to_fit();
+}
+
+} // extern "C"
@@ -0,0 +1,286 @@
+// Streaming file renderer
+//
+// vst3_render_file runs three stages over a fixed set of chunk buffers: a
+// read-ahead thread decodes the input (mapped WAV or raw float) into chunks,
+// the calling thread processes each chunk in blocks through a plugin, chain or
+// graph, and a write-behind thread appends the results to the output file. The
+// stages hand chunks over through bounded queues, so memory use does not grow
+// with the file length and disk I/O overlaps the DSP. The input is followed by
+// silence for the requested tail, plus the target's latency when that is
+// compensated by dropping it from the start of the output.
+
+#include "vst3_host.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vst3_host_internal.h"
+#include "vst3_wav.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Chunk {
+    std::vector<float> samples;     // Interleaved
+    int64_t frames = 0;
+    bool last = false;
+};
+
+// Bounded FIFO of chunk indices between two stages. Closing it wakes every waiter
+// and makes pop fail, which is how a failing stage stops the others.
+class ChunkQueue {
+public:
+    void push(int32_t chunk) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            items.push_back(chunk);
+        }
+        ready.notify_one();
+    }
+
+    // Waits for a chunk; false once closed. Adds the time spent waiting to stall_ms.
+    bool pop(int32_t& chunk, double* stall_ms = nullptr) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.empty() && !closed && stall_ms) {
+            auto start = Clock::now();
+            ready.wait(lock, [this] { return !items.empty() || closed; });
+            *stall_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        } else {
+            ready.wait(lock, [this] { return !items.empty() || closed; });
+        }
+        if (closed) return false;
+        chunk = items.front();
+        items.pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int32_t> items;
+    bool closed = false;
+};
+
+struct RenderJob {
+    AudioFileReader reader;
+    AudioFileWriter writer;
+    int32_t num_inputs = 0;
+    int32_t num_outputs = 0;
+    int64_t total_frames = 0;       // Input, tail and latency
+    int64_t skip_frames = 0;        // Latency dropped from the start of the output
+
+    std::vector<Chunk> input_chunks;
+    std::vector<Chunk> output_chunks;
+    ChunkQueue free_inputs, full_inputs, free_outputs, full_outputs;
+
+    std::mutex error_mutex;
+    std::string error;
+
+    void fail(const std::string& message) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (error.empty()) error = message;
+        }
+        free_inputs.close();
+        full_inputs.close();
+        free_outputs.close();
+        full_outputs.close();
+    }
+};
+
+void read_ahead(RenderJob* job) {
+    int64_t position = 0;
+    int32_t index;
+    while (job->free_inputs.pop(index)) {
+        Chunk& chunk = job->input_chunks[index];
+        const int64_t capacity = static_cast<int64_t>(chunk.samples.size()) / std::max(job->num_inputs, 1);
+        chunk.frames = std::min(capacity, job->total_frames - position);
+
+        // Decoded input, then silence for the tail
+        int64_t decoded = 0;
+        if (job->num_inputs > 0) {
+            decoded = job->reader.read(chunk.samples.data(), chunk.frames, job->num_inputs);
+            std::fill(chunk.samples.begin() + decoded * job->num_inputs,
+                      chunk.samples.begin() + chunk.frames * job->num_inputs, 0.0f);
+        }
+        position += chunk.frames;
+        chunk.last = position >= job->total_frames;
+        job->full_inputs.push(index);
+        if (chunk.last) return;
+    }
+}
+
+void write_behind(RenderJob* job) {
+    int64_t skip = job->skip_frames;
+    int32_t index;
+    while (job->full_outputs.pop(index)) {
+        Chunk& chunk = job->output_chunks[index];
+        int64_t dropped = std::min(skip, chunk.frames);
+        skip -= dropped;
+        if (!job->writer.write(chunk.samples.data() + dropped * job->num_outputs, chunk.frames - dropped)) {
+            job->fail("Write error on output file");
+            return;
+        }
+        bool last = chunk.last;
+        job->free_outputs.push(index);
+        if (last) return;
+    }
+}
+
+int32_t target_latency(int32_t kind, void* target) {
+    switch (kind) {
+        case VST3_AUDIO_TARGET_PLUGIN: return vst3_get_latency_samples(static_cast<VST3Plugin*>(target));
+        case VST3_AUDIO_TARGET_CHAIN: return vst3_chain_get_latency(static_cast<VST3Chain*>(target));
+        case VST3_AUDIO_TARGET_GRAPH: return vst3_graph_get_latency(static_cast<VST3Graph*>(target));
+        default: return 0;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+int vst3_render_file(const char* input_path, const char* output_path, const VST3RenderOptions* options,
+                     VST3RenderStats* stats) {
+    if (!input_path || !output_path || !options) return -1;
+    VST3RenderOptions o = *options;
+    const auto start = Clock::now();
+
+    int32_t numInputs = o.num_channels, numOutputs = o.num_channels;
+    if (o.target_kind == VST3_AUDIO_TARGET_PLUGIN && o.target) {
+        VST3Plugin* plugin = static_cast<VST3Plugin*>(o.target);
+        numInputs = plugin->num_inputs;
+        numOutputs = plugin->num_outputs;
+        if (o.block_size <= 0) o.block_size = plugin->max_block_size;
+    }
+    if (o.block_size <= 0 || numOutputs <= 0) {
+        fprintf(stderr, "Error: Rendering needs a block size and output channels\n");
+        return -1;
+    }
+    if (!check_audio_target(o.target_kind, o.target, o.block_size, numInputs, numOutputs)) return -1;
+    if (o.num_automation > 0 && (o.target_kind != VST3_AUDIO_TARGET_PLUGIN || !o.automation)) {
+        fprintf(stderr, "Error: Automation needs a plugin target\n");
+        return -1;
+    }
+    if (o.chunk_frames <= 0) o.chunk_frames = 16 * o.block_size;
+    o.chunk_frames = (o.chunk_frames + o.block_size - 1) / o.block_size * o.block_size;
+    if (o.queue_depth <= 0) o.queue_depth = 4;
+
+    RenderJob job;
+    std::string error;
+    if (!job.reader.open(input_path, o.raw_channels, o.raw_sample_rate, error)) {
+        fprintf(stderr, "Error: %s\n", error.c_str());
+        return -1;
+    }
+    const double sampleRate = job.reader.sample_rate();
+    if (o.target_kind == VST3_AUDIO_TARGET_PLUGIN &&
+        static_cast<VST3Plugin*>(o.target)->sample_rate != sampleRate) {
+        fprintf(stderr, "Warning: %s is at %g Hz, the plugin runs at %g Hz\n", input_path, sampleRate,
+                static_cast<VST3Plugin*>(o.target)->sample_rate);
+    }
+    if (!job.writer.open(output_path, numOutputs, sampleRate, error)) {
+        fprintf(stderr, "Error: %s\n", error.c_str());
+        return -1;
+    }
+
+    const int32_t latency = o.compensate_latency ? std::max(target_latency(o.target_kind, o.target), 0) : 0;
+    job.num_inputs = numInputs;
+    job.num_outputs = numOutputs;
+    job.skip_frames = latency;
+    job.total_frames = job.reader.frames() + static_cast<int64_t>(std::max(o.tail_seconds, 0.0) * sampleRate) + latency;
+
+    job.input_chunks.resize(o.queue_depth);
+    job.output_chunks.resize(o.queue_depth);
+    for (int32_t i = 0; i < o.queue_depth; i++) {
+        job.input_chunks[i].samples.resize(static_cast<size_t>(o.chunk_frames) * std::max(numInputs, 1));
+        job.output_chunks[i].samples.resize(static_cast<size_t>(o.chunk_frames) * numOutputs);
+        job.free_inputs.push(i);
+        job.free_outputs.push(i);
+    }
+
+    // Planar scratch for one block
+    std::vector<float> inputMemory(static_cast<size_t>(o.block_size) * numInputs);
+    std::vector<float> outputMemory(static_cast<size_t>(o.block_size) * numOutputs);
+    std::vector<float*> inputs(numInputs), outputs(numOutputs);
+    for (int32_t ch = 0; ch < numInputs; ch++) inputs[ch] = &inputMemory[ch * o.block_size];
+    for (int32_t ch = 0; ch < numOutputs; ch++) outputs[ch] = &outputMemory[ch * o.block_size];
+
+    std::thread reader(read_ahead, &job);
+    std::thread writer(write_behind, &job);
+
+    int64_t position = 0;
+    int32_t nextPoint = 0;
+    double readerStall = 0.0, writerStall = 0.0;
+    int32_t in, out;
+    bool last = false;  // An empty render still forwards the reader's zero-frame last chunk
+    while (!last && job.full_inputs.pop(in, &readerStall)) {
+        if (!job.free_outputs.pop(out, &writerStall)) break;
+        const Chunk& src = job.input_chunks[in];
+        Chunk& dst = job.output_chunks[out];
+
+        for (int64_t offset = 0; offset < src.frames; offset += o.block_size) {
+            const int32_t n = static_cast<int32_t>(std::min<int64_t>(o.block_size, src.frames - offset));
+            const double blockEnd = (position + offset + n) / sampleRate;
+            while (nextPoint < o.num_automation && o.automation[nextPoint].time < blockEnd) {
+                const VST3AutomationPoint& point = o.automation[nextPoint++];
+                vst3_set_parameter(static_cast<VST3Plugin*>(o.target), point.param_id, point.value);
+            }
+            const float* s = src.samples.data() + offset * numInputs;
+            for (int32_t ch = 0; ch < numInputs; ch++) {
+                for (int32_t i = 0; i < n; i++) inputs[ch][i] = s[i * numInputs + ch];
+            }
+            if (process_audio_target(o.target_kind, o.target, inputs.data(), outputs.data(), n,
+                                     numInputs, numOutputs) != 0) {
+                job.fail("Processing failed");
+                break;
+            }
+            float* d = dst.samples.data() + offset * numOutputs;
+            for (int32_t ch = 0; ch < numOutputs; ch++) {
+                for (int32_t i = 0; i < n; i++) d[i * numOutputs + ch] = outputs[ch][i];
+            }
+        }
+
+        position += src.frames;
+        dst.frames = src.frames;
+        dst.last = last = src.last;
+        job.free_inputs.push(in);
+        job.full_outputs.push(out);
+    }
+    if (!last) job.fail("Rendering stopped early");
+
+    reader.join();
+    writer.join();
+    if (!job.writer.close() && job.error.empty()) job.error = "Cannot finish output file";
+    if (!job.error.empty()) {
+        fprintf(stderr, "Error: Rendering %s: %s\n", input_path, job.error.c_str());
+        return -1;
+    }
+
+    if (stats) {
+        stats->input_frames = job.reader.frames();
+        stats->output_frames = job.writer.frames();
+        stats->latency_samples = latency;
+        stats->seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        stats->realtime_factor = stats->seconds > 0.0 ? stats->output_frames / sampleRate / stats->seconds : 0.0;
+        stats->reader_stall_ms = readerStall;
+        stats->writer_stall_ms = writerStall;
+    }
+    return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,78 @@
+#ifndef VST3_RING_H
+#define VST3_RING_H
+
+// Lock-free single-producer single-consumer ring of floats.
+//
+// One thread writes and one thread reads; neither ever blocks or allocates.
+// Capacity is rounded up to a power of two. Indices only grow, so the fill
+// level is write - read without a wasted slot. Reads and writes move as much as
+// fits and return the count, leaving partial-frame handling to the caller.
+
+#include <stddef.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+
+class SpscRing {
+public:
+    explicit SpscRing(size_t minCapacity) : mask(0), writeIndex(0), readIndex(0) {
+        size_t capacity = 1;
+        while (capacity < minCapacity) capacity <<= 1;
+        buffer.reset(new float[capacity]());
+        mask = capacity - 1;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // Samples the consumer can read. Exact on the consumer thread, a lower bound elsewhere.
+    size_t readable() const {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+    }
+
+    // Samples the producer can write. Exact on the producer thread, a lower bound elsewhere.
+    size_t writable() const { return capacity() - readable(); }
+
+    // Producer only. Copies up to n samples in; returns how many.
+    size_t write(const float* data, size_t n) {
+        size_t w = writeIndex.load(std::memory_order_relaxed);
+        size_t r = readIndex.load(std::memory_order_acquire);
+        if (n > capacity() - (w - r)) n = capacity() - (w - r);
+        copy_in(w, data, n);
+        writeIndex.store(w + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer only. Copies up to n samples out; returns how many.
+    size_t read(float* data, size_t n) {
+        size_t r = readIndex.load(std::memory_order_relaxed);
+        size_t w = writeIndex.load(std::memory_order_acquire);
+        if (n > w - r) n = w - r;
+        copy_out(r, data, n);
+        readIndex.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    void copy_in(size_t index, const float* data, size_t n) {
+        size_t start = index & mask;
+        size_t first = n < capacity() - start ? n : capacity() - start;
+        memcpy(buffer.get() + start, data, first * sizeof(float));
+        memcpy(buffer.get(), data + first, (n - first) * sizeof(float));
+    }
+
+    void copy_out(size_t index, float* data, size_t n) const {
+        size_t start = index & mask;
+        size_t first = n < capacity() - start ? n : capacity() - start;
+        memcpy(data, buffer.get() + start, first * sizeof(float));
+        memcpy(data + first, buffer.get(), (n - first) * sizeof(float));
+    }
+
+    std::unique_ptr<float[]> buffer;
+    size_t mask;
+    // Producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> writeIndex;
+    alignas(64) std::atomic<size_t> readIndex;
+};
+
+#endif /* VST3_RING_H */
@@ -0,0 +1,521 @@
+// Plugin scanning with a persistent cache
+//
+// A bundle is described from its moduleinfo.json when it ships one, so
+// nothing is loaded. Bundles without one are probed: loaded once and each
+// audio effect class instantiated to read its main bus layout. Probes run
+// concurrently on a bounded pool, either in-process or, when a probe
+// executable is given, in a child process per bundle that is killed when it
+// exceeds the timeout, so a hanging or crashing bundle only fails itself.
+//
+// Results are kept in a tab-separated cache file keyed by bundle path and
+// modification time, one line per class:
+//
+//   path  mtime  from_module_info  status  load_ms  class_id  name  vendor  version  subcategories  inputs  outputs
+//
+// Bundles that have no audio effect class or fail to load are recorded with an
+// empty class ID so they are not probed again until they change.
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "vst3_host_internal.h"
+#include "vst3_thread_pool.h"
+#include "public.sdk/source/vst/moduleinfo/moduleinfoparser.h"
+
+extern char** environ;
+
+namespace {
+
+const char* const kScanCacheHeader = "# vst3host plugin scan cache v2";
+const int kScanCacheFields = 12;
+const int kRecordFields = 7;
+
+// Descriptor on which a probe child writes its records; stdout is discarded
+// because plugins print to it freely
+const int kProbeResultFd = 3;
+
+struct ScanRecord {
+    std::string class_id;   // Empty for a bundle without usable classes
+    std::string name;
+    std::string vendor;
+    std::string version;
+    std::string subcategories;
+    int32_t num_inputs = -1;
+    int32_t num_outputs = -1;
+};
+
+struct BundleScan {
+    std::string path;
+    int64_t mtime = 0;
+    bool from_module_info = false;
+    int32_t status = VST3_SCAN_OK;
+    double load_time_ms = 0.0;
+    std::vector<ScanRecord> records;
+};
+
+int64_t modification_time(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return -1;
+    return static_cast<int64_t>(st.st_mtime);
+}
+
+bool is_bundle(const std::filesystem::path& path) {
+    return path.extension() == ".vst3";
+}
+
+std::string join_subcategories(const std::vector<std::string>& subCategories) {
+    std::string joined;
+    for (const auto& sub : subCategories) {
+        if (!joined.empty()) joined += '|';
+        joined += sub;
+    }
+    return joined;
+}
+
+// Channel counts implied by the subcategories, -1 when they do not say
+void guess_io(ScanRecord& record, const std::vector<std::string>& subCategories) {
+    int32_t channels = -1;
+    bool instrument = false;
+    for (const auto& sub : subCategories) {
+        if (sub == "Mono") channels = 1;
+        else if (sub == "Stereo") channels = 2;
+        else if (sub == "Instrument") instrument = true;
+    }
+    record.num_outputs = channels;
+    record.num_inputs = instrument && channels > 0 ? 0 : channels;
+}
+
+bool scan_module_info(BundleScan& bundle) {
+    auto infoPath = VST3::Hosting::Module::getModuleInfoPath(bundle.path);
+    if (!infoPath) return false;
+
+    std::ifstream file(*infoPath);
+    if (!file) return false;
+    std::stringstream json;
+    json << file.rdbuf();
+
+    auto moduleInfo = Steinberg::ModuleInfoLib::parseJson(json.str(), nullptr);
+    if (!moduleInfo) {
+        fprintf(stderr, "Warning: Invalid moduleinfo.json in %s\n", bundle.path.c_str());
+        return false;
+    }
+
+    for (const auto& cls : moduleInfo->classes) {
+        if (cls.category != kVstAudioEffectClass) continue;
+
+        ScanRecord record;
+        record.class_id = cls.cid;
+        record.name = cls.name;
+        record.vendor = cls.vendor.empty() ? moduleInfo->factoryInfo.vendor : cls.vendor;
+        record.version = cls.version;
+        record.subcategories = join_subcategories(cls.subCategories);
+        guess_io(record, cls.subCategories);
+        bundle.records.push_back(std::move(record));
+    }
+    bundle.from_module_info = true;
+    return true;
+}
+
+void probe_in_process(BundleScan& bundle) {
+    std::string error;
+    auto module = acquire_module(bundle.path, error);
+    if (!module) {
+        fprintf(stderr, "Warning: Failed to load %s: %s\n", bundle.path.c_str(), error.c_str());
+        bundle.status = VST3_SCAN_FAILED;
+        return;
+    }
+
+    for (const auto& cls : module->classInfos) {
+        if (cls.category() != kVstAudioEffectClass) continue;
+
+        ScanRecord record;
+        record.class_id = cls.ID().toString(false);
+        record.name = cls.name();
+        record.vendor = cls.vendor().empty() ? module->vendor : cls.vendor();
+        record.version = cls.version();
+        record.subcategories = join_subcategories(cls.subCategories());
+
+        VST3Plugin* plugin = instantiate_plugin(module, cls.ID());
+        if (plugin) {
+            record.num_inputs = plugin->num_inputs;
+            record.num_outputs = plugin->num_outputs;
+            vst3_unload_plugin(plugin);
+        } else {
+            guess_io(record, cls.subCategories());
+        }
+        bundle.records.push_back(std::move(record));
+    }
+}
+
+// Tabs and newlines would break the cache format
+std::string sanitize(const std::string& field) {
+    std::string out = field;
+    std::replace_if(out.begin(), out.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+    return out;
+}
+
+std::vector<std::string> split_fields(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    return fields;
+}
+
+// A class record is kRecordFields fields, shared by the cache and probe output
+void write_record(FILE* f, const ScanRecord& r) {
+    fprintf(f, "%s\t%s\t%s\t%s\t%s\t%d\t%d\n",
+            sanitize(r.class_id).c_str(), sanitize(r.name).c_str(),
+            sanitize(r.vendor).c_str(), sanitize(r.version).c_str(),
+            sanitize(r.subcategories).c_str(), r.num_inputs, r.num_outputs);
+}
+
+ScanRecord parse_record(const std::vector<std::string>& fields, size_t first) {
+    ScanRecord record;
+    record.class_id = fields[first];
+    record.name = fields[first + 1];
+    record.vendor = fields[first + 2];
+    record.version = fields[first + 3];
+    record.subcategories = fields[first + 4];
+    record.num_inputs = static_cast<int32_t>(strtol(fields[first + 5].c_str(), nullptr, 10));
+    record.num_outputs = static_cast<int32_t>(strtol(fields[first + 6].c_str(), nullptr, 10));
+    return record;
+}
+
+// Run the probe executable on one bundle and collect the records it reports
+void probe_in_child(BundleScan& bundle, const char* probePath, int32_t timeoutMs) {
+    bundle.status = VST3_SCAN_FAILED;
+
+    // Both ends are close-on-exec, so probes spawned concurrently by other workers
+    // never inherit this pipe; a sibling holding the write end would keep the read
+    // below from seeing EOF. The child gets its end through dup2 only.
+    int fds[2];
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC) != 0) return;
+#else
+    if (pipe(fds) != 0) return;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+    if (fds[1] == kProbeResultFd) {
+        // dup2 onto itself would leave close-on-exec set
+        int moved = fcntl(fds[1], F_DUPFD_CLOEXEC, kProbeResultFd + 1);
+        close(fds[1]);
+        if (moved < 0) {
+            close(fds[0]);
+            return;
+        }
+        fds[1] = moved;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], kProbeResultFd);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+#ifdef __APPLE__
+    // Closes the window between pipe() and fcntl() above, during which another
+    // thread's spawn could still inherit both ends
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_CLOEXEC_DEFAULT);
+    posix_spawn_file_actions_addinherit_np(&actions, STDIN_FILENO);
+    posix_spawn_file_actions_addinherit_np(&actions, STDERR_FILENO);
+#endif
+
+    char* const argv[] = {const_cast<char*>(probePath), const_cast<char*>(bundle.path.c_str()), nullptr};
+    pid_t pid;
+    int spawned = posix_spawn(&pid, probePath, &actions, &attributes, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(fds[1]);
+
+    if (spawned != 0) {
+        fprintf(stderr, "Warning: Cannot run probe %s: %s\n", probePath, strerror(spawned));
+        close(fds[0]);
+        return;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::string output;
+    bool timedOut = false;
+    char chunk[4096];
+    while (true) {
+        int waitMs = -1;
+        if (timeoutMs > 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) {
+                timedOut = true;
+                break;
+            }
+            waitMs = static_cast<int>(left);
+        }
+
+        struct pollfd pfd = {fds[0], POLLIN, 0};
+        int ready = poll(&pfd, 1, waitMs);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) continue;
+        if (ready < 0) break;
+
+        ssize_t n = read(fds[0], chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        output.append(chunk, static_cast<size_t>(n));
+    }
+    close(fds[0]);
+
+    // The child may close its end and keep running; the deadline covers its exit too
+    int status = 0;
+    while (!timedOut && timeoutMs > 0) {
+        pid_t done = waitpid(pid, &status, WNOHANG);
+        if (done == pid || (done < 0 && errno != EINTR)) break;
+        if (done == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                timedOut = true;
+                break;
+            }
+            usleep(1000);
+        }
+    }
+    if (timedOut) {
+        kill(pid, SIGKILL);
+    }
+    if (timedOut || timeoutMs <= 0) {
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    }
+
+    if (timedOut) {
+        fprintf(stderr, "Warning: Probe of %s timed out after %d ms\n", bundle.path.c_str(), timeoutMs);
+        bundle.status = VST3_SCAN_TIMEOUT;
+        return;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Warning: Probe of %s failed\n", bundle.path.c_str());
+        return;
+    }
+
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        auto fields = split_fields(line);
+        if (static_cast<int>(fields.size()) != kRecordFields) continue;
+        bundle.records.push_back(parse_record(fields, 0));
+    }
+    bundle.status = VST3_SCAN_OK;
+}
+
+std::unordered_map<std::string, BundleScan> read_cache(const char* cachePath) {
+    std::unordered_map<std::string, BundleScan> cache;
+    if (!cachePath) return cache;
+
+    std::ifstream file(cachePath);
+    std::string line;
+    if (!file || !std::getline(file, line) || line != kScanCacheHeader) return cache;
+
+    while (std::getline(file, line)) {
+        auto fields = split_fields(line);
+        if (static_cast<int>(fields.size()) != kScanCacheFields) continue;
+
+        BundleScan& bundle = cache[fields[0]];
+        bundle.path = fields[0];
+        bundle.mtime = strtoll(fields[1].c_str(), nullptr, 10);
+        bundle.from_module_info = fields[2] == "1";
+        bundle.status = static_cast<int32_t>(strtol(fields[3].c_str(), nullptr, 10));
+        bundle.load_time_ms = strtod(fields[4].c_str(), nullptr);
+        if (fields[5].empty()) continue;
+
+        bundle.records.push_back(parse_record(fields, 5));
+    }
+    return cache;
+}
+
+bool write_cache(const char* cachePath, const std::vector<BundleScan>& bundles) {
+    // Write next to the target and rename, so readers never see a partial file
+    std::string tmpPath = std::string(cachePath) + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "w");
+    if (!f) return false;
+
+    fprintf(f, "%s\n", kScanCacheHeader);
+    for (const auto& bundle : bundles) {
+        std::string path = sanitize(bundle.path);
+        if (bundle.records.empty()) {
+            fprintf(f, "%s\t%lld\t%d\t%d\t%.1f\t\t\t\t\t\t\t\n", path.c_str(),
+                    static_cast<long long>(bundle.mtime), bundle.from_module_info ? 1 : 0,
+                    bundle.status, bundle.load_time_ms);
+            continue;
+        }
+        for (const auto& r : bundle.records) {
+            fprintf(f, "%s\t%lld\t%d\t%d\t%.1f\t", path.c_str(),
+                    static_cast<long long>(bundle.mtime), bundle.from_module_info ? 1 : 0,
+                    bundle.status, bundle.load_time_ms);
+            write_record(f, r);
+        }
+    }
+
+    if (fclose(f) != 0) return false;
+    return rename(tmpPath.c_str(), cachePath) == 0;
+}
+
+void copy_string(char* dest, size_t destSize, const std::string& src) {
+    strncpy(dest, src.c_str(), destSize - 1);
+    dest[destSize - 1] = '\0';
+}
+
+} // namespace
+
+/* Result of a plugin scan, one entry per audio effect class or failed bundle */
+struct VST3PluginScan {
+    struct Entry {
+        std::string path;
+        bool from_module_info;
+        int32_t status;
+        double load_time_ms;
+        ScanRecord record;
+    };
+
+    std::vector<Entry> entries;
+};
+
+extern "C" {
+
+VST3PluginScan* vst3_scan_plugins(const char* const* dirs, int32_t num_dirs,
+                                  const char* cache_path, const VST3ScanOptions* options) {
+    if ((!dirs && num_dirs > 0) || num_dirs < 0) return nullptr;
+
+    VST3ScanOptions opts = {};
+    if (options) opts = *options;
+
+    // Collect bundles; a bundle's contents are not searched for further bundles
+    std::vector<std::string> paths;
+    if (num_dirs == 0) {
+        paths = VST3::Hosting::Module::getModulePaths();
+    }
+    for (int32_t d = 0; d < num_dirs; d++) {
+        if (!dirs[d]) continue;
+        if (is_bundle(dirs[d])) {
+            paths.push_back(dirs[d]);
+            continue;
+        }
+
+        std::error_code ec;
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (std::filesystem::recursive_directory_iterator it(dirs[d], options, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            if (is_bundle(it->path())) {
+                paths.push_back(it->path().string());
+                it.disable_recursion_pending();
+            }
+        }
+        if (ec) {
+            fprintf(stderr, "Warning: Error scanning plugin directory %s: %s\n",
+                    dirs[d], ec.message().c_str());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    // Reuse cached results of unchanged bundles
+    auto cache = read_cache(cache_path);
+    std::vector<BundleScan> bundles(paths.size());
+    std::vector<size_t> stale;
+    for (size_t i = 0; i < paths.size(); i++) {
+        bundles[i].path = paths[i];
+        bundles[i].mtime = modification_time(paths[i]);
+
+        auto cached = cache.find(paths[i]);
+        if (cached != cache.end() && cached->second.mtime == bundles[i].mtime) {
+            bundles[i] = std::move(cached->second);
+        } else {
+            stale.push_back(i);
+        }
+    }
+
+    if (!stale.empty()) {
+        ThreadPool pool(opts.num_threads);
+        for (size_t i : stale) {
+            pool.submit([&bundles, &opts, i] {
+                BundleScan& bundle = bundles[i];
+                auto start = std::chrono::steady_clock::now();
+                if (!scan_module_info(bundle)) {
+                    if (opts.probe_path) {
+                        probe_in_child(bundle, opts.probe_path, opts.timeout_ms);
+                    } else {
+                        probe_in_process(bundle);
+                    }
+                }
+                bundle.load_time_ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+            });
+        }
+        pool.wait();
+    }
+
+    if (cache_path && (!stale.empty() || cache.size() != bundles.size())) {
+        if (!write_cache(cache_path, bundles)) {
+            fprintf(stderr, "Warning: Failed to write plugin scan cache %s\n", cache_path);
+        }
+    }
+
+    VST3PluginScan* scan = new VST3PluginScan();
+    for (auto& bundle : bundles) {
+        if (bundle.status != VST3_SCAN_OK) {
+            scan->entries.push_back({bundle.path, false, bundle.status, bundle.load_time_ms, ScanRecord()});
+        }
+        for (auto& record : bundle.records) {
+            scan->entries.push_back({bundle.path, bundle.from_module_info, bundle.status,
+                                     bundle.load_time_ms, std::move(record)});
+        }
+    }
+    return scan;
+}
+
+int32_t vst3_scan_count(VST3PluginScan* scan) {
+    if (!scan) return 0;
+    return static_cast<int32_t>(scan->entries.size());
+}
+
+int vst3_scan_get(VST3PluginScan* scan, int32_t i, VST3ScanEntry* entry) {
+    if (!scan || !entry || i < 0 || i >= static_cast<int32_t>(scan->entries.size())) return -1;
+
+    const auto& e = scan->entries[i];
+    copy_string(entry->name, sizeof(entry->name), e.record.name);
+    copy_string(entry->vendor, sizeof(entry->vendor), e.record.vendor);
+    copy_string(entry->version, sizeof(entry->version), e.record.version);
+    copy_string(entry->subcategories, sizeof(entry->subcategories), e.record.subcategories);
+    copy_string(entry->class_id, sizeof(entry->class_id), e.record.class_id);
+    copy_string(entry->path, sizeof(entry->path), e.path);
+    entry->num_inputs = e.record.num_inputs;
+    entry->num_outputs = e.record.num_outputs;
+    entry->from_module_info = e.from_module_info ? 1 : 0;
+    entry->status = e.status;
+    entry->load_time_ms = e.load_time_ms;
+    return 0;
+}
+
+void vst3_scan_free(VST3PluginScan* scan) {
+    delete scan;
+}
+
+} // extern "C"
@@ -0,0 +1,160 @@
+// Push/pull streaming with re-blocking
+//
+// A stream decouples the caller's chunk sizes from the block size a plugin,
+// chain or graph processes. The producer pushes interleaved input of any length
+// into one SPSC ring; the consumer pulls interleaved output from a second one.
+// Pulling processes whole blocks from the input ring until enough output is
+// ready, so the target always sees block_size samples, except for the final
+// partial block processed by vst3_stream_flush. Producer and consumer may be
+// different threads; processing runs on the consumer's.
+
+#include "vst3_host.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "vst3_host_internal.h"
+#include "vst3_ring.h"
+
+struct VST3Stream {
+    int32_t target_kind;
+    void* target;
+    int32_t block_size;
+    int32_t num_input_channels;
+    int32_t num_output_channels;
+
+    SpscRing input_ring;
+    SpscRing output_ring;
+
+    // Consumer-side scratch: one interleaved block and planar channels
+    std::vector<float> interleaved;
+    std::vector<float> input_memory;
+    std::vector<float> output_memory;
+    std::vector<float*> inputs;
+    std::vector<float*> outputs;
+
+    VST3Stream(int32_t kind, void* t, int32_t block, int32_t nin, int32_t nout, size_t capacity)
+        : target_kind(kind), target(t), block_size(block), num_input_channels(nin), num_output_channels(nout),
+          input_ring(capacity * std::max(nin, 1)), output_ring(capacity * std::max(nout, 1)) {}
+};
+
+namespace {
+
+// Process one block of num_frames from the input ring into the output ring
+int process_block(VST3Stream* s, int32_t num_frames) {
+    const int32_t nin = s->num_input_channels;
+    const int32_t nout = s->num_output_channels;
+
+    if (nin > 0) {
+        s->input_ring.read(s->interleaved.data(), static_cast<size_t>(num_frames) * nin);
+        for (int32_t ch = 0; ch < nin; ch++) {
+            float* dst = s->inputs[ch];
+            for (int32_t i = 0; i < num_frames; i++) dst[i] = s->interleaved[i * nin + ch];
+        }
+    }
+
+    int ret = process_audio_target(s->target_kind, s->target, s->inputs.data(), s->outputs.data(),
+                                   num_frames, nin, nout);
+    if (ret != 0) return -1;
+
+    if (nout > 0) {
+        for (int32_t ch = 0; ch < nout; ch++) {
+            const float* src = s->outputs[ch];
+            for (int32_t i = 0; i < num_frames; i++) s->interleaved[i * nout + ch] = src[i];
+        }
+        s->output_ring.write(s->interleaved.data(), static_cast<size_t>(num_frames) * nout);
+    }
+    return 0;
+}
+
+// Without inputs (instruments) every pull can process
+size_t input_frames(const VST3Stream* s) {
+    return s->num_input_channels > 0 ? s->input_ring.readable() / s->num_input_channels : SIZE_MAX;
+}
+
+size_t output_frames(const VST3Stream* s) {
+    return s->num_output_channels > 0 ? s->output_ring.readable() / s->num_output_channels : 0;
+}
+
+size_t output_space(const VST3Stream* s) {
+    return s->num_output_channels > 0 ? s->output_ring.writable() / s->num_output_channels : SIZE_MAX;
+}
+
+} // namespace
+
+extern "C" {
+
+VST3Stream* vst3_stream_create(int32_t target_kind, void* target, int32_t block_size,
+                               int32_t num_input_channels, int32_t num_output_channels,
+                               int32_t capacity_frames) {
+    if (block_size <= 0 || num_input_channels < 0 || num_output_channels <= 0) return nullptr;
+    if (!check_audio_target(target_kind, target, block_size, num_input_channels, num_output_channels)) {
+        return nullptr;
+    }
+
+    // Room for the caller's largest chunk plus a block in flight
+    size_t capacity = static_cast<size_t>(std::max(capacity_frames, 0)) + block_size;
+    capacity = std::max(capacity, static_cast<size_t>(2) * block_size);
+
+    VST3Stream* s = new VST3Stream(target_kind, target, block_size, num_input_channels,
+                                   num_output_channels, capacity);
+    s->interleaved.resize(static_cast<size_t>(block_size) * std::max(num_input_channels, num_output_channels));
+    s->input_memory.resize(static_cast<size_t>(block_size) * num_input_channels);
+    s->output_memory.resize(static_cast<size_t>(block_size) * num_output_channels);
+    for (int32_t ch = 0; ch < num_input_channels; ch++) s->inputs.push_back(&s->input_memory[ch * block_size]);
+    for (int32_t ch = 0; ch < num_output_channels; ch++) s->outputs.push_back(&s->output_memory[ch * block_size]);
+    return s;
+}
+
+int32_t vst3_stream_push(VST3Stream* stream, const float* interleaved, int32_t num_frames) {
+    if (!stream || !interleaved || num_frames < 0) return -1;
+    const int32_t nin = stream->num_input_channels;
+    if (nin == 0) return 0;
+
+    size_t frames = std::min(static_cast<size_t>(num_frames), stream->input_ring.writable() / nin);
+    stream->input_ring.write(interleaved, frames * nin);
+    return static_cast<int32_t>(frames);
+}
+
+int32_t vst3_stream_pull(VST3Stream* stream, float* interleaved, int32_t num_frames) {
+    if (!stream || !interleaved || num_frames < 0) return -1;
+    const int32_t block = stream->block_size;
+
+    while (output_frames(stream) < static_cast<size_t>(num_frames) &&
+           input_frames(stream) >= static_cast<size_t>(block) &&
+           output_space(stream) >= static_cast<size_t>(block)) {
+        if (process_block(stream, block) != 0) return -1;
+    }
+
+    const int32_t nout = stream->num_output_channels;
+    if (nout == 0) return 0;
+    size_t frames = std::min(static_cast<size_t>(num_frames), output_frames(stream));
+    stream->output_ring.read(interleaved, frames * nout);
+    return static_cast<int32_t>(frames);
+}
+
+int32_t vst3_stream_flush(VST3Stream* stream) {
+    if (!stream) return -1;
+
+    int32_t frames = 0;
+    while (stream->num_input_channels > 0 && input_frames(stream) > 0) {
+        int32_t n = static_cast<int32_t>(std::min(input_frames(stream), static_cast<size_t>(stream->block_size)));
+        if (output_space(stream) < static_cast<size_t>(n)) break;
+        if (process_block(stream, n) != 0) return -1;
+        frames += n;
+    }
+    return frames;
+}
+
+int32_t vst3_stream_available(VST3Stream* stream) {
+    if (!stream) return -1;
+    return static_cast<int32_t>(output_frames(stream));
+}
+
+void vst3_stream_free(VST3Stream* stream) {
+    delete stream;
+}
+
+} // extern "C"
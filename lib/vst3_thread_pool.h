@@ -0,0 +1,94 @@
+#ifndef VST3_THREAD_POOL_H
+#define VST3_THREAD_POOL_H
+
+// Fixed-size worker pool for host-side background work (scanning, loading).
+// Not used on the audio processing path.
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // numThreads <= 0 uses one thread per hardware core
+    explicit ThreadPool(int32_t numThreads) : pending(0), stopping(false) {
+        if (numThreads <= 0) {
+            numThreads = static_cast<int32_t>(std::thread::hardware_concurrency());
+            if (numThreads <= 0) numThreads = 1;
+        }
+
+        workers.reserve(numThreads);
+        for (int32_t i = 0; i < numThreads; i++) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int32_t size() const { return static_cast<int32_t>(workers.size()); }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+            pending++;
+        }
+        taskReady.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this] { return pending == 0; });
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) {
+                    allDone.notify_all();
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    std::condition_variable allDone;
+    int64_t pending;
+    bool stopping;
+};
+
+#endif /* VST3_THREAD_POOL_H */
@@ -0,0 +1,277 @@
+// Sequential WAV and raw float file access for the streaming renderer
+
+#include "vst3_wav.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+
+const uint16_t kFormatPcm = 1;
+const uint16_t kFormatFloat = 3;
+const uint16_t kFormatExtensible = 0xFFFE;
+
+// Bytes of the placeholder chunk that becomes ds64 if the output needs RF64
+const uint32_t kDs64Size = 28;
+// RIFF header, JUNK/ds64 chunk, fmt chunk (18 bytes) and data chunk header
+const int64_t kHeaderSize = 12 + 8 + kDs64Size + 8 + 18 + 8;
+
+uint16_t le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+uint64_t le64(const uint8_t* p) { return le32(p) | (static_cast<uint64_t>(le32(p + 4)) << 32); }
+
+void put16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+void put32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF; }
+void put64(uint8_t* p, uint64_t v) { for (int i = 0; i < 8; i++) p[i] = (v >> (8 * i)) & 0xFF; }
+
+float decode_sample(const uint8_t* p, int32_t bytes, bool isFloat) {
+    if (isFloat) {
+        if (bytes == 4) {
+            float f;
+            memcpy(&f, p, 4);
+            return f;
+        }
+        double d;
+        memcpy(&d, p, 8);
+        return static_cast<float>(d);
+    }
+    switch (bytes) {
+        case 1: return (p[0] - 128) * (1.0f / 128.0f);
+        case 2: return static_cast<int16_t>(le16(p)) * (1.0f / 32768.0f);
+        case 3: {
+            uint32_t v = (p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24);
+            return (static_cast<int32_t>(v) >> 8) * (1.0f / 8388608.0f);
+        }
+        default: return static_cast<int32_t>(le32(p)) * (1.0f / 2147483648.0f);
+    }
+}
+
+} // namespace
+
+bool AudioFileReader::open(const char* path, int32_t raw_channels, double raw_sample_rate, std::string& error) {
+    close();
+
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        error = std::string("Cannot open ") + path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        error = std::string("Cannot read ") + path;
+        close();
+        return false;
+    }
+    mapSize = static_cast<size_t>(st.st_size);
+    void* m = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m == MAP_FAILED) {
+        error = std::string("Cannot map ") + path + ": " + strerror(errno);
+        map = nullptr;
+        close();
+        return false;
+    }
+    map = static_cast<const uint8_t*>(m);
+    madvise(m, mapSize, MADV_SEQUENTIAL);
+
+    bool isWav = mapSize >= 12 && (memcmp(map, "RIFF", 4) == 0 || memcmp(map, "RF64", 4) == 0) &&
+                 memcmp(map + 8, "WAVE", 4) == 0;
+    if (isWav) {
+        if (!parse_wav(error)) {
+            close();
+            return false;
+        }
+    } else if (raw_channels > 0 && raw_sample_rate > 0.0) {
+        data = map;
+        numChannels = raw_channels;
+        sampleRate = raw_sample_rate;
+        bytesPerSample = 4;
+        isFloat = true;
+        numFrames = static_cast<int64_t>(mapSize / (4 * static_cast<size_t>(raw_channels)));
+    } else {
+        error = std::string(path) + " is not a WAV file (raw float input needs a channel count and sample rate)";
+        close();
+        return false;
+    }
+    framePosition = 0;
+    return true;
+}
+
+bool AudioFileReader::parse_wav(std::string& error) {
+    const uint8_t* end = map + mapSize;
+    const uint8_t* p = map + 12;
+    uint64_t ds64DataSize = 0;
+    bool haveFormat = false;
+    uint16_t format = 0;
+    int32_t bits = 0;
+
+    while (p + 8 <= end) {
+        uint64_t size = le32(p + 4);
+        const uint8_t* body = p + 8;
+
+        if (memcmp(p, "ds64", 4) == 0 && size >= 24 && body + 24 <= end) {
+            ds64DataSize = le64(body + 8);
+        } else if (memcmp(p, "fmt ", 4) == 0 && size >= 16 && body + 16 <= end) {
+            format = le16(body);
+            numChannels = le16(body + 2);
+            sampleRate = le32(body + 4);
+            bits = le16(body + 14);
+            if (format == kFormatExtensible && size >= 40 && body + 26 <= end) {
+                format = le16(body + 24);       // First two bytes of the subformat GUID
+            }
+            haveFormat = true;
+        } else if (memcmp(p, "data", 4) == 0) {
+            if (!haveFormat) break;
+            if (size == 0xFFFFFFFFu && ds64DataSize > 0) size = ds64DataSize;
+            size = std::min<uint64_t>(size, static_cast<uint64_t>(end - body));
+
+            bool supported = numChannels > 0 &&
+                             ((format == kFormatPcm && bits >= 8 && bits <= 32 && bits % 8 == 0) ||
+                              (format == kFormatFloat && (bits == 32 || bits == 64)));
+            if (!supported) {
+                error = "Unsupported WAV sample format (" + std::to_string(format) + ", " +
+                        std::to_string(bits) + " bits)";
+                return false;
+            }
+            data = body;
+            bytesPerSample = bits / 8;
+            isFloat = format == kFormatFloat;
+            numFrames = static_cast<int64_t>(size / (static_cast<uint64_t>(bytesPerSample) * numChannels));
+            return true;
+        }
+        p = body + size + (size & 1);
+    }
+
+    error = haveFormat ? "WAV file has no data chunk" : "WAV file has no fmt chunk";
+    return false;
+}
+
+void AudioFileReader::close() {
+    if (map) munmap(const_cast<uint8_t*>(map), mapSize);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    map = nullptr;
+    mapSize = 0;
+    released = 0;
+    data = nullptr;
+    numChannels = 0;
+    numFrames = 0;
+    framePosition = 0;
+}
+
+int64_t AudioFileReader::read(float* interleaved, int64_t num_frames, int32_t num_dst_channels) {
+    int64_t n = std::min(num_frames, numFrames - framePosition);
+    if (n <= 0) return 0;
+
+    const size_t frameBytes = static_cast<size_t>(bytesPerSample) * numChannels;
+    const uint8_t* src = data + framePosition * frameBytes;
+    const int32_t common = std::min(numChannels, num_dst_channels);
+
+    for (int64_t i = 0; i < n; i++, src += frameBytes) {
+        float* dst = interleaved + i * num_dst_channels;
+        if (numChannels == 1) {
+            float v = decode_sample(src, bytesPerSample, isFloat);
+            for (int32_t ch = 0; ch < num_dst_channels; ch++) dst[ch] = v;
+            continue;
+        }
+        for (int32_t ch = 0; ch < common; ch++) {
+            dst[ch] = decode_sample(src + ch * bytesPerSample, bytesPerSample, isFloat);
+        }
+        for (int32_t ch = common; ch < num_dst_channels; ch++) dst[ch] = 0.0f;
+    }
+    framePosition += n;
+
+    // Drop the pages already decoded so the mapping does not accumulate in memory
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t consumed = static_cast<size_t>(src - map) / page * page;
+    if (consumed > released + (8u << 20)) {
+        madvise(const_cast<uint8_t*>(map) + released, consumed - released, MADV_DONTNEED);
+        released = consumed;
+    }
+    return n;
+}
+
+bool AudioFileWriter::open(const char* path, int32_t channels, double sample_rate, std::string& error) {
+    file = fopen(path, "wb");
+    if (!file) {
+        error = std::string("Cannot create ") + path + ": " + strerror(errno);
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    numChannels = channels;
+    numFrames = 0;
+
+    // Sizes are filled in by close
+    uint8_t h[kHeaderSize] = {};
+    uint8_t* p = h;
+    memcpy(p, "RIFF", 4); memcpy(p + 8, "WAVE", 4); p += 12;
+    memcpy(p, "JUNK", 4); put32(p + 4, kDs64Size); p += 8 + kDs64Size;
+    memcpy(p, "fmt ", 4); put32(p + 4, 18);
+    put16(p + 8, kFormatFloat);
+    put16(p + 10, static_cast<uint16_t>(channels));
+    put32(p + 12, static_cast<uint32_t>(sample_rate));
+    put32(p + 16, static_cast<uint32_t>(sample_rate) * 4 * channels);
+    put16(p + 20, static_cast<uint16_t>(4 * channels));
+    put16(p + 22, 32);
+    put16(p + 24, 0);
+    p += 8 + 18;
+    memcpy(p, "data", 4);
+
+    if (fwrite(h, 1, sizeof(h), file) != sizeof(h)) {
+        error = std::string("Cannot write ") + path + ": " + strerror(errno);
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool AudioFileWriter::write(const float* interleaved, int64_t num_frames) {
+    if (!file) return false;
+    size_t count = static_cast<size_t>(num_frames) * numChannels;
+    if (fwrite(interleaved, sizeof(float), count, file) != count) return false;
+    numFrames += num_frames;
+    return true;
+}
+
+bool AudioFileWriter::close() {
+    if (!file) return false;
+
+    const uint64_t dataBytes = static_cast<uint64_t>(numFrames) * 4 * numChannels;
+    const uint64_t riffBytes = kHeaderSize - 8 + dataBytes;
+    bool ok = true;
+    if (dataBytes & 1) ok = fputc(0, file) != EOF;
+
+    uint8_t h[8];
+    if (riffBytes <= 0xFFFFFFFFu) {
+        memcpy(h, "RIFF", 4);
+        put32(h + 4, static_cast<uint32_t>(riffBytes + (dataBytes & 1)));
+    } else {
+        memcpy(h, "RF64", 4);
+        put32(h + 4, 0xFFFFFFFFu);
+    }
+    ok = ok && fseeko(file, 0, SEEK_SET) == 0 && fwrite(h, 1, 8, file) == 8;
+
+    if (riffBytes > 0xFFFFFFFFu) {
+        uint8_t ds64[8 + kDs64Size] = {};
+        memcpy(ds64, "ds64", 4);
+        put32(ds64 + 4, kDs64Size);
+        put64(ds64 + 8, riffBytes + (dataBytes & 1));
+        put64(ds64 + 16, dataBytes);
+        put64(ds64 + 24, static_cast<uint64_t>(numFrames));
+        ok = ok && fseeko(file, 12, SEEK_SET) == 0 && fwrite(ds64, 1, sizeof(ds64), file) == sizeof(ds64);
+    }
+
+    uint8_t size[4];
+    put32(size, riffBytes <= 0xFFFFFFFFu ? static_cast<uint32_t>(dataBytes) : 0xFFFFFFFFu);
+    ok = ok && fseeko(file, kHeaderSize - 4, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
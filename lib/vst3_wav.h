@@ -0,0 +1,81 @@
+#ifndef VST3_WAV_H
+#define VST3_WAV_H
+
+// Sequential WAV and raw float file access for the streaming renderer.
+//
+// AudioFileReader maps the whole input read-only and decodes frames from it in
+// order: WAV (RIFF or RF64) with 8/16/24/32-bit PCM or 32/64-bit float samples,
+// or headerless little-endian 32-bit float. Pages behind the read position are
+// dropped from the mapping, so resident memory stays flat however long the
+// file is. AudioFileWriter streams 32-bit float WAV and switches the header to
+// RF64 on close if the data outgrew the 4 GiB RIFF limit.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+class AudioFileReader {
+public:
+    AudioFileReader() = default;
+    ~AudioFileReader() { close(); }
+    AudioFileReader(const AudioFileReader&) = delete;
+    AudioFileReader& operator=(const AudioFileReader&) = delete;
+
+    // Open a WAV file, or a raw float file if raw_channels > 0 and the file has no
+    // WAV header. Returns false and sets error on failure.
+    bool open(const char* path, int32_t raw_channels, double raw_sample_rate, std::string& error);
+    void close();
+
+    int32_t channels() const { return numChannels; }
+    double sample_rate() const { return sampleRate; }
+    int64_t frames() const { return numFrames; }
+    int64_t position() const { return framePosition; }
+
+    // Decode up to num_frames frames into num_dst_channels interleaved channels.
+    // A mono file fills every channel; otherwise missing channels are silent and
+    // extra file channels are dropped. Returns the frames decoded, 0 at the end.
+    int64_t read(float* interleaved, int64_t num_frames, int32_t num_dst_channels);
+
+private:
+    bool parse_wav(std::string& error);
+
+    int fd = -1;
+    const uint8_t* map = nullptr;
+    size_t mapSize = 0;
+    size_t released = 0;           // Bytes at the start of the mapping already dropped
+
+    const uint8_t* data = nullptr;
+    int32_t numChannels = 0;
+    double sampleRate = 0.0;
+    int32_t bytesPerSample = 0;
+    bool isFloat = false;
+    int64_t numFrames = 0;
+    int64_t framePosition = 0;
+};
+
+class AudioFileWriter {
+public:
+    AudioFileWriter() = default;
+    ~AudioFileWriter() { if (file) fclose(file); }
+    AudioFileWriter(const AudioFileWriter&) = delete;
+    AudioFileWriter& operator=(const AudioFileWriter&) = delete;
+
+    // Create a 32-bit float WAV file. Returns false and sets error on failure.
+    bool open(const char* path, int32_t channels, double sample_rate, std::string& error);
+
+    // Append interleaved frames. Returns false on a write error.
+    bool write(const float* interleaved, int64_t num_frames);
+
+    // Write the final sizes into the header and close. Returns false on a write error.
+    bool close();
+
+    int64_t frames() const { return numFrames; }
+
+private:
+    FILE* file = nullptr;
+    int32_t numChannels = 0;
+    int64_t numFrames = 0;
+};
+
+#endif /* VST3_WAV_H */
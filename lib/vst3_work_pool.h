@@ -0,0 +1,232 @@
+#ifndef VST3_WORK_POOL_H
+#define VST3_WORK_POOL_H
+
+// Work-stealing pool for per-block processing work.
+//
+// The calling thread takes part as worker 0. Each worker owns a deque of task
+// indices: it takes its own newest task and, when that runs dry, steals the
+// oldest task of another worker. Tasks may push follow-on tasks onto their own
+// worker's deque, so dependent work runs where its input was just produced.
+//
+// The deques are Chase-Lev deques over fixed ring buffers: the owner pushes and
+// takes at the bottom and thieves take at the top with a compare-and-swap, so
+// no operation of a run takes a lock. Idle workers sleep on a semaphore that a
+// run signals only for the workers actually asleep. Buffers are sized for the
+// largest task count seen and kept between runs, so a steady-state run does
+// not allocate. Unlike ThreadPool this is meant for the processing path.
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+class WorkStealingPool {
+public:
+    // Run for one task index on the given worker
+    using TaskFn = void (*)(void* context, int32_t index, int32_t worker);
+
+    // numWorkers counts the calling thread; <= 0 uses one worker per hardware core
+    explicit WorkStealingPool(int32_t numWorkers)
+        : queues(nullptr), numQueues(0), capacity(0), taskFn(nullptr), taskContext(nullptr),
+          remaining(0), busy(0), sleepers(0), generation(0), stopping(false) {
+        if (numWorkers <= 0) {
+            numWorkers = static_cast<int32_t>(std::thread::hardware_concurrency());
+            if (numWorkers <= 0) numWorkers = 1;
+        }
+
+        numQueues = numWorkers;
+        queues.reset(new Queue[numQueues]);
+        reserve(64);
+        threads.reserve(numWorkers - 1);
+        for (int32_t i = 1; i < numWorkers; i++) {
+            threads.emplace_back([this, i] { worker_main(i); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        stopping.store(true);
+        generation.fetch_add(1);
+        for (size_t i = 0; i < threads.size(); i++) {
+            wake.signal();
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int32_t size() const { return numQueues; }
+
+    // Deal the initial tasks round-robin and work until `total` tasks (initial
+    // plus those pushed by tasks) have completed. One run at a time. Allocates
+    // only when total exceeds every earlier run.
+    void run(const int32_t* initial, int32_t numInitial, int32_t total, TaskFn fn, void* context) {
+        if (total <= 0) return;
+
+        // Workers still leaving the previous run would race the pushes below
+        while (busy.load() != 0) {
+            std::this_thread::yield();
+        }
+        if (total > capacity) reserve(total);
+
+        taskFn = fn;
+        taskContext = context;
+        for (int32_t i = 0; i < numInitial; i++) {
+            push(i % numQueues, initial[i]);
+        }
+        // Publishes the tasks and taskFn to workers that see the new count
+        remaining.store(total, std::memory_order_release);
+
+        generation.fetch_add(1);
+        for (int32_t n = sleepers.exchange(0); n > 0; n--) {
+            wake.signal();
+        }
+
+        work(0);
+    }
+
+    // Queue a task on a worker's deque: by run for the initial tasks, otherwise
+    // only by a task running on that worker
+    void push(int32_t worker, int32_t index) {
+        Queue& q = queues[worker];
+        int64_t b = q.bottom.load(std::memory_order_relaxed);
+        q.items[b & (capacity - 1)].store(index, std::memory_order_relaxed);
+        q.bottom.store(b + 1, std::memory_order_release);
+    }
+
+private:
+    // A deque never holds more than the tasks of one run, so a ring of at least
+    // that many slots cannot overflow; top and bottom only grow
+    struct alignas(64) Queue {
+        std::atomic<int64_t> top {0};
+        std::atomic<int64_t> bottom {0};
+        std::unique_ptr<std::atomic<int32_t>[]> items;
+    };
+
+    // Counting semaphore for sleeping workers
+    class Semaphore {
+    public:
+#ifdef __APPLE__
+        Semaphore() : sem(dispatch_semaphore_create(0)) {}
+        ~Semaphore() { dispatch_release(sem); }
+        void signal() { dispatch_semaphore_signal(sem); }
+        void wait() { dispatch_semaphore_wait(sem, DISPATCH_TIME_FOREVER); }
+    private:
+        dispatch_semaphore_t sem;
+#else
+        Semaphore() { sem_init(&sem, 0, 0); }
+        ~Semaphore() { sem_destroy(&sem); }
+        void signal() { sem_post(&sem); }
+        void wait() { while (sem_wait(&sem) != 0) {} }
+    private:
+        sem_t sem;
+#endif
+    };
+
+    // Only while no worker is running
+    void reserve(int32_t total) {
+        int32_t size = 1;
+        while (size < total) size <<= 1;
+        for (int32_t i = 0; i < numQueues; i++) {
+            queues[i].items.reset(new std::atomic<int32_t>[size]);
+            queues[i].top.store(0);
+            queues[i].bottom.store(0);
+        }
+        capacity = size;
+    }
+
+    // Owner takes its newest task
+    bool pop(int32_t worker, int32_t& index) {
+        Queue& q = queues[worker];
+        int64_t b = q.bottom.load(std::memory_order_relaxed) - 1;
+        q.bottom.store(b);
+        int64_t t = q.top.load();
+        if (t > b) {
+            q.bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        index = q.items[b & (capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last item: race the thieves for it
+            bool won = q.top.compare_exchange_strong(t, t + 1);
+            q.bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Thief takes the oldest task of another worker
+    bool steal(int32_t thief, int32_t& index) {
+        for (int32_t k = 1; k < numQueues; k++) {
+            Queue& q = queues[(thief + k) % numQueues];
+            int64_t t = q.top.load();
+            int64_t b = q.bottom.load();
+            if (t >= b) continue;
+            int32_t item = q.items[t & (capacity - 1)].load(std::memory_order_relaxed);
+            if (q.top.compare_exchange_strong(t, t + 1)) {
+                index = item;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(int32_t worker) {
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            int32_t index;
+            if (pop(worker, index) || steal(worker, index)) {
+                taskFn(taskContext, index, worker);
+                remaining.fetch_sub(1, std::memory_order_acq_rel);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void worker_main(int32_t worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            // Registered as asleep before the last look, so a run either sees this
+            // worker in sleepers or this worker sees the run's generation
+            while (generation.load() == seen) {
+                sleepers.fetch_add(1);
+                if (generation.load() != seen) break;
+                wake.wait();
+            }
+            if (stopping.load()) return;
+            seen = generation.load();
+
+            busy.fetch_add(1);
+            work(worker);
+            busy.fetch_sub(1);
+        }
+    }
+
+    std::unique_ptr<Queue[]> queues;
+    int32_t numQueues;
+    int32_t capacity;                   // Slots per deque, a power of two
+    std::vector<std::thread> threads;
+
+    // Published to workers through remaining
+    TaskFn taskFn;
+    void* taskContext;
+
+    std::atomic<int32_t> remaining;
+    std::atomic<int32_t> busy;          // Workers inside work()
+    std::atomic<int32_t> sleepers;      // Workers asleep or about to be, not yet signalled
+    std::atomic<uint64_t> generation;
+    std::atomic<bool> stopping;
+    Semaphore wake;
+};
+
+#endif /* VST3_WORK_POOL_H */
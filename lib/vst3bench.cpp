@@ -0,0 +1,107 @@
+// Microbenchmarks for the mixing kernels (make bench)
+//
+// Times every kernel of every kernel set this CPU runs at a few block sizes and
+// checks each set against the scalar one. Prints nanoseconds per sample and the
+// speedup over scalar.
+
+#include "vst3_kernels.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+namespace {
+
+const int32_t kBlockSizes[] = {64, 256, 1024, 4096};
+const int32_t kSamplesPerRun = 1 << 24;     // Per kernel and block size
+
+enum Kernel { kClear, kCopyGain, kAdd, kMulAdd, kGainRamp, kMulAddRamp, kNumKernels };
+const char* const kKernelNames[kNumKernels] = {
+    "clear", "copy_gain", "add", "mul_add", "gain_ramp", "mul_add_ramp"
+};
+
+void run(const MixKernels& k, Kernel kernel, float* dst, const float* src, int32_t n) {
+    switch (kernel) {
+        case kClear: k.clear(dst, n); break;
+        case kCopyGain: k.copy_gain(dst, src, 0.5f, n); break;
+        case kAdd: k.add(dst, src, n); break;
+        case kMulAdd: k.mul_add(dst, src, 0.5f, n); break;
+        case kGainRamp: k.gain_ramp(dst, src, 0.25f, 0.75f, n); break;
+        case kMulAddRamp: k.mul_add_ramp(dst, src, 0.25f, 0.75f, n); break;
+        default: break;
+    }
+}
+
+double time_ns_per_sample(const MixKernels& k, Kernel kernel, std::vector<float>& dst,
+                          const std::vector<float>& src, int32_t n) {
+    const int32_t iterations = kSamplesPerRun / n;
+    auto start = std::chrono::steady_clock::now();
+    for (int32_t it = 0; it < iterations; it++) {
+        run(k, kernel, dst.data(), src.data(), n);
+        // Keep accumulating kernels from growing without bound
+        if (kernel == kAdd || kernel == kMulAdd || kernel == kMulAddRamp) dst[it % n] = 0.0f;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / (static_cast<double>(iterations) * n);
+}
+
+// Largest difference to the scalar result, on an odd length to exercise the tails
+float max_error(const MixKernels& k, const MixKernels& scalar, Kernel kernel, const std::vector<float>& src) {
+    const int32_t n = 1021;
+    std::vector<float> expected(n, 1.0f), actual(n, 1.0f);
+    run(scalar, kernel, expected.data(), src.data(), n);
+    run(k, kernel, actual.data(), src.data(), n);
+
+    float error = 0.0f;
+    for (int32_t i = 0; i < n; i++) {
+        error = fmaxf(error, fabsf(expected[i] - actual[i]));
+    }
+    return error;
+}
+
+} // namespace
+
+int main() {
+    const MixKernels* sets[8];
+    int32_t numSets = available_mix_kernels(sets, 8);
+    const MixKernels& scalar = *sets[0];
+
+    std::vector<float> src(4096), dst(4096);
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f;
+    }
+
+    printf("Mixing kernels, dispatch selects: %s\n\n", mix_kernels().name);
+    printf("%-8s %-14s", "set", "kernel");
+    for (int32_t n : kBlockSizes) printf(" %10d", n);
+    printf("   (ns/sample, speedup vs scalar)\n");
+
+    int failures = 0;
+    std::vector<double> scalarTimes(kNumKernels * (sizeof(kBlockSizes) / sizeof(kBlockSizes[0])));
+
+    for (int32_t s = 0; s < numSets; s++) {
+        const MixKernels& k = *sets[s];
+        for (int kernel = 0; kernel < kNumKernels; kernel++) {
+            float error = max_error(k, scalar, static_cast<Kernel>(kernel), src);
+            if (error > 1e-5f) {
+                fprintf(stderr, "Error: %s %s differs from scalar by %g\n", k.name, kKernelNames[kernel], error);
+                failures++;
+            }
+
+            printf("%-8s %-14s", k.name, kKernelNames[kernel]);
+            int b = 0;
+            for (int32_t n : kBlockSizes) {
+                double t = time_ns_per_sample(k, static_cast<Kernel>(kernel), dst, src, n);
+                double& reference = scalarTimes[kernel * (sizeof(kBlockSizes) / sizeof(kBlockSizes[0])) + b++];
+                if (s == 0) reference = t;
+                printf(" %5.3f %3.1fx", t, reference / t);
+            }
+            printf("\n");
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
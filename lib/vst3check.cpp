@@ -0,0 +1,154 @@
+// Lifecycle and concurrency checks against a real plugin bundle (make check PLUGIN=...)
+//
+//   vst3check bundle.vst3 [seconds]
+//
+// Loader threads load and unload instances of the bundle, synchronously and
+// through vst3_load_plugin_async, while another thread keeps calling
+// vst3_shutdown. Shutdown must refuse while any instance exists and must never
+// release the host context under a load in progress; every load has to succeed.
+// At the end no instance or module may be left and shutdown has to succeed.
+// Before that, an instance loaded with VST3_LOAD_LAZY_CONTROLLER is activated and
+// processed and must still have no controller.
+// Exits with status 1 if a check failed. Run it under AddressSanitizer or
+// ThreadSanitizer to also catch use of a released context.
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int32_t kLoaderThreads = 4;
+
+std::atomic<bool> gStop(false);
+std::atomic<int32_t> gLoads(0);
+std::atomic<int32_t> gFailedLoads(0);
+std::atomic<int32_t> gShutdowns(0);
+
+// Loaders pause between rounds so that shutdown finds no instance now and then
+void pause_round() {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+}
+
+void load_sync(const char* path) {
+    while (!gStop.load()) {
+        VST3Plugin* plugin = vst3_load_plugin(path);
+        if (!plugin) {
+            gFailedLoads++;
+            continue;
+        }
+        gLoads++;
+        vst3_unload_plugin(plugin);
+        pause_round();
+    }
+}
+
+void load_async(const char* path) {
+    while (!gStop.load()) {
+        VST3LoadRequest* requests[4];
+        for (VST3LoadRequest*& request : requests) {
+            request = vst3_load_plugin_async(path, nullptr, 48000.0, 512, nullptr, nullptr);
+        }
+        for (VST3LoadRequest* request : requests) {
+            VST3Plugin* plugin = request ? vst3_load_wait(request) : nullptr;
+            if (!plugin) {
+                gFailedLoads++;
+                continue;
+            }
+            gLoads++;
+            vst3_unload_plugin(plugin);
+        }
+        pause_round();
+    }
+}
+
+void shut_down() {
+    while (!gStop.load()) {
+        if (vst3_shutdown() == 0) gShutdowns++;
+        std::this_thread::yield();
+    }
+}
+
+bool check(bool ok, const char* what) {
+    printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// Activate and process a lazily loaded instance. Returns false if it could not be
+// processed; created is set if its controller exists afterwards.
+bool process_lazy(const char* path, bool& created) {
+    const int32_t kBlockSize = 512;
+    VST3Plugin* plugin = vst3_load_plugin_ex(path, nullptr, VST3_LOAD_LAZY_CONTROLLER);
+    if (!plugin) return false;
+
+    VST3PluginInfo info;
+    bool ok = vst3_get_plugin_info(plugin, &info) == 0 &&
+              vst3_setup_processing(plugin, 48000.0, kBlockSize) == 0 &&
+              vst3_set_active(plugin, 1) == 0;
+
+    int32_t numChannels = ok ? std::max(std::max(info.num_inputs, info.num_outputs), 1) : 0;
+    std::vector<float> input(static_cast<size_t>(numChannels) * kBlockSize, 0.0f);
+    std::vector<float> output(input.size(), 0.0f);
+    std::vector<float*> inputs(numChannels);
+    std::vector<float*> outputs(numChannels);
+    for (int32_t ch = 0; ch < numChannels; ch++) {
+        inputs[ch] = input.data() + static_cast<size_t>(ch) * kBlockSize;
+        outputs[ch] = output.data() + static_cast<size_t>(ch) * kBlockSize;
+    }
+    for (int32_t block = 0; ok && block < 16; block++) {
+        ok = vst3_process(plugin, inputs.data(), outputs.data(), kBlockSize,
+                          info.num_inputs, info.num_outputs) == 0;
+    }
+
+    // num_parameters stays -1 until the controller is created
+    created = vst3_get_plugin_info(plugin, &info) == 0 && info.num_parameters >= 0;
+    vst3_set_active(plugin, 0);
+    vst3_unload_plugin(plugin);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: vst3check bundle.vst3 [seconds]\n");
+        return 2;
+    }
+    const char* path = argv[1];
+    const double seconds = argc > 2 ? atof(argv[2]) : 5.0;
+
+    // The bundle has to load at all before its failures mean anything
+    VST3Plugin* probe = vst3_load_plugin(path);
+    if (!probe) {
+        fprintf(stderr, "vst3check: cannot load %s\n", path);
+        return 2;
+    }
+    bool ok = check(vst3_shutdown() != 0, "shutdown refuses while an instance is loaded");
+    vst3_unload_plugin(probe);
+
+    bool created = true;
+    ok = check(process_lazy(path, created), "lazy instance activates and processes") && ok;
+    ok = check(!created, "lazy controller is not created by processing") && ok;
+
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < kLoaderThreads; i++) {
+        threads.emplace_back(i % 2 == 0 ? load_sync : load_async, path);
+    }
+    threads.emplace_back(shut_down);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    gStop = true;
+    for (std::thread& t : threads) t.join();
+
+    printf("%d loads, %d shutdowns in between\n", gLoads.load(), gShutdowns.load());
+    ok = check(gFailedLoads.load() == 0, "every load during concurrent shutdowns succeeds") && ok;
+    ok = check(vst3_get_loaded_module_count() == 0, "no module left loaded") && ok;
+    ok = check(vst3_shutdown() == 0, "shutdown succeeds once everything is unloaded") && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+// vst3probe: describe the audio effect classes of one bundle
+//
+// Run by vst3_scan_plugins in a child process so that a bundle which hangs or
+// crashes while loading cannot take the scan down with it. Writes one record
+// per class to descriptor 3:
+//
+//   class_id  name  vendor  version  subcategories  inputs  outputs
+//
+// Exits with status 0 if the bundle was loaded, 1 otherwise.
+
+#include "vst3_host.h"
+
+#include <stdio.h>
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: vst3probe <bundle.vst3>\n");
+        return 2;
+    }
+
+    FILE* out = fdopen(3, "w");
+    if (!out) {
+        fprintf(stderr, "vst3probe: result descriptor 3 is not open\n");
+        return 2;
+    }
+
+    const char* dirs[] = {argv[1]};
+    VST3ScanOptions options = {};
+    options.num_threads = 1;
+    VST3PluginScan* scan = vst3_scan_plugins(dirs, 1, nullptr, &options);
+    if (!scan) return 1;
+
+    int result = 0;
+    int32_t count = vst3_scan_count(scan);
+    for (int32_t i = 0; i < count; i++) {
+        VST3ScanEntry entry;
+        if (vst3_scan_get(scan, i, &entry) != 0) continue;
+        if (entry.status != VST3_SCAN_OK) {
+            result = 1;
+            continue;
+        }
+        fprintf(out, "%s\t%s\t%s\t%s\t%s\t%d\t%d\n", entry.class_id, entry.name, entry.vendor,
+                entry.version, entry.subcategories, entry.num_inputs, entry.num_outputs);
+    }
+
+    vst3_scan_free(scan);
+    if (fclose(out) != 0) return 1;
+    return result;
+}
@@ -0,0 +1,298 @@
+// vst3render: render a manifest of files through plugins on every core
+//
+//   vst3render [-j workers] [-b block_size] [-t tail_seconds] [-n] manifest.tsv
+//
+// Each manifest line is one job, tab separated:
+//
+//   input  output  plugin  [preset]  [automation]
+//
+// plugin is a bundle path, optionally followed by '#' and a class name or ID.
+// preset is a .vstpreset file and automation a file of "seconds param_id value"
+// lines (normalized values); '-' or an empty field means none. Relative paths
+// are resolved against the manifest's directory. Blank lines and lines starting
+// with '#' are skipped.
+//
+// Workers take jobs in manifest order. Each worker loads every distinct plugin
+// once and resets it between jobs: it is deactivated, restored to the preset or
+// to its state right after loading, and activated again. One line per job
+// reports the wall time and realtime factor. Exits with status 1 if any job
+// failed.
+
+#include "vst3_host.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vst3_wav.h"
+
+namespace {
+
+struct Job {
+    int line;
+    std::string input;
+    std::string output;
+    std::string bundle;
+    std::string plugin_class;
+    std::string preset;
+    std::string automation;
+};
+
+struct Settings {
+    int32_t block_size = 512;
+    double tail_seconds = 0.0;
+    bool compensate_latency = true;
+};
+
+// A plugin loaded by one worker, with the state to return to between jobs
+struct LoadedPlugin {
+    VST3Plugin* plugin = nullptr;
+    double sample_rate = 0.0;
+    bool active = false;
+    std::vector<char> initial_state;
+};
+
+std::mutex gOutputMutex;
+
+std::string resolve(const std::string& base, const std::string& path) {
+    if (path.empty() || path == "-" || path[0] == '/' || base.empty()) return path == "-" ? "" : path;
+    return base + "/" + path;
+}
+
+std::vector<std::string> split_tabs(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos) return fields;
+        start = tab + 1;
+    }
+}
+
+bool read_manifest(const char* path, std::vector<Job>& jobs) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "vst3render: cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    std::string base(path);
+    size_t slash = base.rfind('/');
+    base = slash == std::string::npos ? "" : base.substr(0, slash);
+
+    char buffer[8192];
+    int lineNumber = 0;
+    bool ok = true;
+    while (fgets(buffer, sizeof(buffer), f)) {
+        lineNumber++;
+        std::string line(buffer);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> fields = split_tabs(line);
+        if (fields.size() < 3 || fields[0].empty() || fields[1].empty() || fields[2].empty()) {
+            fprintf(stderr, "vst3render: %s:%d: expected input, output and plugin\n", path, lineNumber);
+            ok = false;
+            continue;
+        }
+        fields.resize(5);
+
+        Job job;
+        job.line = lineNumber;
+        job.input = resolve(base, fields[0]);
+        job.output = resolve(base, fields[1]);
+        size_t hash = fields[2].find('#');
+        job.bundle = resolve(base, fields[2].substr(0, hash));
+        if (hash != std::string::npos) job.plugin_class = fields[2].substr(hash + 1);
+        job.preset = resolve(base, fields[3]);
+        job.automation = resolve(base, fields[4]);
+        jobs.push_back(job);
+    }
+    fclose(f);
+    return ok;
+}
+
+bool read_automation(const std::string& path, std::vector<VST3AutomationPoint>& points) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        VST3AutomationPoint point;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%lf %d %lf", &point.time, &point.param_id, &point.value) == 3) {
+            points.push_back(point);
+        }
+    }
+    fclose(f);
+    std::stable_sort(points.begin(), points.end(),
+                     [](const VST3AutomationPoint& a, const VST3AutomationPoint& b) { return a.time < b.time; });
+    return true;
+}
+
+// Load the job's plugin on first use by this worker, then bring it to the job's
+// sample rate and a fresh state
+VST3Plugin* prepare_plugin(std::map<std::string, LoadedPlugin>& plugins, const Job& job, double sample_rate,
+                           const Settings& settings, std::string& error) {
+    LoadedPlugin& loaded = plugins[job.bundle + "#" + job.plugin_class];
+    if (!loaded.plugin) {
+        loaded.plugin = vst3_load_plugin_class(job.bundle.c_str(), job.plugin_class.c_str());
+        if (!loaded.plugin) {
+            error = "cannot load " + job.bundle;
+            return nullptr;
+        }
+        int64_t size = vst3_save_state(loaded.plugin, nullptr, 0);
+        if (size > 0) {
+            loaded.initial_state.resize(size);
+            vst3_save_state(loaded.plugin, loaded.initial_state.data(), size);
+        }
+    }
+
+    VST3Plugin* plugin = loaded.plugin;
+    if (loaded.active) {
+        vst3_set_active(plugin, 0);
+        loaded.active = false;
+    }
+    if (loaded.sample_rate != sample_rate) {
+        if (vst3_setup_processing(plugin, sample_rate, settings.block_size) != 0) {
+            error = "cannot set up processing";
+            return nullptr;
+        }
+        loaded.sample_rate = sample_rate;
+    }
+
+    int ret = !job.preset.empty() ? vst3_load_preset(plugin, job.preset.c_str())
+            : !loaded.initial_state.empty() ? vst3_load_state(plugin, loaded.initial_state.data(),
+                                                              static_cast<int64_t>(loaded.initial_state.size()))
+            : 0;
+    if (ret != 0) {
+        error = job.preset.empty() ? "cannot restore plugin state" : "cannot load preset " + job.preset;
+        return nullptr;
+    }
+    if (vst3_set_active(plugin, 1) != 0) {
+        error = "cannot activate plugin";
+        return nullptr;
+    }
+    loaded.active = true;
+    return plugin;
+}
+
+bool run_job(std::map<std::string, LoadedPlugin>& plugins, const Job& job, const Settings& settings,
+             VST3RenderStats& stats, std::string& error) {
+    double sampleRate;
+    {
+        AudioFileReader reader;
+        if (!reader.open(job.input.c_str(), 0, 0.0, error)) return false;
+        sampleRate = reader.sample_rate();
+    }
+
+    std::vector<VST3AutomationPoint> automation;
+    if (!job.automation.empty() && !read_automation(job.automation, automation)) {
+        error = "cannot read automation " + job.automation;
+        return false;
+    }
+
+    VST3Plugin* plugin = prepare_plugin(plugins, job, sampleRate, settings, error);
+    if (!plugin) return false;
+
+    VST3RenderOptions options = {};
+    options.target_kind = VST3_AUDIO_TARGET_PLUGIN;
+    options.target = plugin;
+    options.block_size = settings.block_size;
+    options.tail_seconds = settings.tail_seconds;
+    options.compensate_latency = settings.compensate_latency;
+    options.automation = automation.data();
+    options.num_automation = static_cast<int32_t>(automation.size());
+    if (vst3_render_file(job.input.c_str(), job.output.c_str(), &options, &stats) != 0) {
+        error = "rendering failed";
+        return false;
+    }
+    return true;
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: vst3render [-j workers] [-b block_size] [-t tail_seconds] [-n] manifest.tsv\n"
+            "  -j  worker threads (default: one per core)\n"
+            "  -b  samples per process call (default 512)\n"
+            "  -t  seconds of tail rendered after each input (default 0)\n"
+            "  -n  keep plugin latency at the start of the output\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Settings settings;
+    int32_t numWorkers = static_cast<int32_t>(std::thread::hardware_concurrency());
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:b:t:nh")) != -1) {
+        switch (opt) {
+            case 'j': numWorkers = atoi(optarg); break;
+            case 'b': settings.block_size = atoi(optarg); break;
+            case 't': settings.tail_seconds = atof(optarg); break;
+            case 'n': settings.compensate_latency = false; break;
+            default: usage(); return 2;
+        }
+    }
+    if (optind != argc - 1 || settings.block_size <= 0) {
+        usage();
+        return 2;
+    }
+
+    std::vector<Job> jobs;
+    if (!read_manifest(argv[optind], jobs)) return 2;
+    numWorkers = std::max(1, std::min(numWorkers, static_cast<int32_t>(jobs.size())));
+
+    std::atomic<size_t> nextJob(0);
+    std::atomic<int32_t> failed(0);
+    double renderedSeconds = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        std::map<std::string, LoadedPlugin> plugins;
+        for (size_t i = nextJob.fetch_add(1); i < jobs.size(); i = nextJob.fetch_add(1)) {
+            const Job& job = jobs[i];
+            VST3RenderStats stats = {};
+            std::string error;
+            bool ok = run_job(plugins, job, settings, stats, error);
+
+            std::lock_guard<std::mutex> lock(gOutputMutex);
+            if (ok) {
+                renderedSeconds += stats.realtime_factor * stats.seconds;
+                printf("[%zu/%zu] ok %8.2fs %7.1fx  %s -> %s\n", i + 1, jobs.size(), stats.seconds,
+                       stats.realtime_factor, job.input.c_str(), job.output.c_str());
+            } else {
+                failed++;
+                printf("[%zu/%zu] FAILED line %d: %s: %s\n", i + 1, jobs.size(), job.line, job.input.c_str(),
+                       error.c_str());
+            }
+            fflush(stdout);
+        }
+        for (auto& entry : plugins) {
+            if (entry.second.plugin) vst3_unload_plugin(entry.second.plugin);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int32_t w = 0; w < numWorkers; w++) threads.emplace_back(worker);
+    for (std::thread& t : threads) t.join();
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu jobs, %d failed, %.1f s of audio in %.2f s on %d workers (%.1fx realtime)\n", jobs.size(),
+           failed.load(), renderedSeconds, wall, numWorkers, wall > 0.0 ? renderedSeconds / wall : 0.0);
+    vst3_shutdown();
+    return failed.load() == 0 ? 0 : 1;
+}
@@ -23,6 +23,7 @@ DEF_CLASS_IID (IAudioProcessor)
 DEF_CLASS_IID (IComponent)
 DEF_CLASS_IID (IEditController)
 DEF_CLASS_IID (IEditController2)
+DEF_CLASS_IID (IComponentHandler)
 DEF_CLASS_IID (IConnectionPoint)
 
 // Event and MIDI interfaces
@@ -42,16 +42,28 @@ close(plugin)
 module VST3Host
 
 # Export types
-export VST3Plugin, PluginInfo, ParameterInfo
+export VST3Plugin, PluginInfo, ParameterInfo, ParameterPoint, MidiEvent
 
 # Export main API
 export info, parameters, parameter, parameterinfo
 export setparameter!, getparameter
-export process, process!
-export activate!, deactivate!
+export process, process!, processmany!, submit!, ProcessTicket
+export PluginChain, bypass!
+export PluginGraph, addnode!, removenode!, connect!, disconnect!, compile!, setgain!, GraphStats, graphstats
+export AudioThread, AudioThreadStats, audiostats, PluginStream
+export RenderStats, renderfile
+export outputparameters, outputparameters!, outputevents, outputevents!
+export activate!, deactivate!, loadedmodules, loadasync
+export ScannedPlugin, scanplugins, PluginClass, pluginclasses
+export latency, pollrestart!, applyrestart!
+export savestate, savestate!, loadstate!
+export PluginPool, checkout!, checkin!, available
+export PresetIndex, PresetInfo, loadpreset!, savepreset
+export presets, findpreset, searchpresets, applypreset!
 
 # Export MIDI functions
 export noteon, noteoff, controlchange, programchange
+export ProgramList, programlists, cacheprograms!, clearprograms!
 
 # Export utility functions
 export formatparameter, isdiscrete
@@ -94,6 +106,167 @@ struct CParameterInfo
     step_count::Int32
 end
 
+"""
+    ParameterPoint
+
+Parameter change reported by the plugin during processing (e.g. a gain-reduction meter).
+Layout matches the C `VST3ParameterPoint` struct.
+
+# Fields
+- `id::Int32`: Parameter ID
+- `sample_offset::Int32`: Sample position within the processed block
+- `value::Float64`: Normalized value (0-1)
+"""
+struct ParameterPoint
+    id::Int32
+    sample_offset::Int32
+    value::Float64
+end
+
+"""
+    MidiEvent
+
+MIDI event emitted by the plugin during processing, packed as MIDI 1.0 bytes.
+Layout matches the C `VST3MidiEvent` struct.
+
+# Fields
+- `sample_offset::Int32`: Sample position within the processed block
+- `status::UInt8`: Status byte (message type and channel)
+- `data1::UInt8`: First data byte
+- `data2::UInt8`: Second data byte
+"""
+struct MidiEvent
+    sample_offset::Int32
+    status::UInt8
+    data1::UInt8
+    data2::UInt8
+    reserved::UInt8
+end
+
+MidiEvent(sample_offset, status, data1, data2) = MidiEvent(sample_offset, status, data1, data2, 0x00)
+
+struct CProgramListInfo
+    id::Int32
+    name::NTuple{128, UInt8}
+    program_count::Int32
+    param_id::Int32
+    num_cached::Int32
+end
+
+struct CPresetInfo
+    name::NTuple{128, UInt8}
+    plugin_name::NTuple{128, UInt8}
+    category::NTuple{128, UInt8}
+    class_id::NTuple{33, UInt8}
+    path::NTuple{1024, UInt8}
+end
+
+struct CScanEntry
+    name::NTuple{128, UInt8}
+    vendor::NTuple{128, UInt8}
+    version::NTuple{64, UInt8}
+    subcategories::NTuple{128, UInt8}
+    class_id::NTuple{33, UInt8}
+    path::NTuple{1024, UInt8}
+    num_inputs::Int32
+    num_outputs::Int32
+    from_module_info::Int32
+    status::Int32
+    load_time_ms::Float64
+end
+
+# Load flags (VST3_LOAD_*)
+const LOAD_LAZY_CONTROLLER = UInt32(1)
+
+struct CClassInfo
+    class_id::NTuple{33, UInt8}
+    name::NTuple{128, UInt8}
+    vendor::NTuple{128, UInt8}
+    version::NTuple{64, UInt8}
+    category::NTuple{64, UInt8}
+    subcategories::NTuple{128, UInt8}
+end
+
+struct CProcessJob
+    plugin::Ptr{Cvoid}
+    inputs::Ptr{Ptr{Float32}}
+    outputs::Ptr{Ptr{Float32}}
+    num_input_channels::Int32
+    num_output_channels::Int32
+    events::Ptr{MidiEvent}
+    num_events::Int32
+    result::Int32
+end
+
+struct CGraphStats
+    predicted_ms::Float64
+    actual_ms::Float64
+    critical_path_ms::Float64
+    total_work_ms::Float64
+    num_workers::Int32
+end
+
+struct CAudioThreadConfig
+    sample_rate::Float64
+    period_frames::Int32
+    num_input_channels::Int32
+    num_output_channels::Int32
+    ring_periods::Int32
+    realtime::Int32
+    priority::Int32
+    lock_memory::Int32
+end
+
+struct CAudioThreadStats
+    periods::Int64
+    deadline_misses::Int64
+    underruns::Int64
+    overruns::Int64
+    period_ms::Float64
+    max_process_ms::Float64
+    avg_process_ms::Float64
+    max_wakeup_ms::Float64
+    realtime::Int32
+    memory_locked::Int32
+end
+
+struct CAutomationPoint
+    time::Float64
+    param_id::Int32
+    value::Float64
+end
+
+struct CRenderOptions
+    target_kind::Int32
+    target::Ptr{Cvoid}
+    num_channels::Int32
+    block_size::Int32
+    chunk_frames::Int32
+    queue_depth::Int32
+    tail_seconds::Float64
+    compensate_latency::Int32
+    raw_channels::Int32
+    raw_sample_rate::Float64
+    automation::Ptr{CAutomationPoint}
+    num_automation::Int32
+end
+
+struct CRenderStats
+    input_frames::Int64
+    output_frames::Int64
+    latency_samples::Int32
+    seconds::Float64
+    realtime_factor::Float64
+    reader_stall_ms::Float64
+    writer_stall_ms::Float64
+end
+
+struct CScanOptions
+    num_threads::Int32
+    timeout_ms::Int32
+    probe_path::Ptr{UInt8}
+end
+
 # Julia types
 """
     PluginInfo
@@ -105,7 +278,8 @@ Information about a VST3 plugin.
 - `vendor::String`: Plugin vendor
 - `num_inputs::Int`: Number of input channels
 - `num_outputs::Int`: Number of output channels
-- `num_parameters::Int`: Number of parameters
+- `num_parameters::Int`: Number of parameters, -1 while an active plugin's lazy controller
+  is not created
 - `sample_rate::Float64`: Sample rate (Hz)
 """
 struct PluginInfo
@@ -175,6 +349,11 @@ Handle to a loaded VST3 plugin.
 - `block_size::Int`: Maximum block size
 - `num_inputs::Int`: Number of input channels
 - `num_outputs::Int`: Number of output channels
+- `active::Bool`: Whether the plugin is activated
+- `owned::Bool`: Whether this handle unloads the plugin when closed
+  (false for instances borrowed from a `PluginPool`)
+- `pending::Vector{Any}`: `ProcessTicket`s of blocks submitted with `submit!` and not yet
+  waited for; keeps their buffers alive until the worker thread is done with them
 """
 mutable struct VST3Plugin
     handle::Ptr{Cvoid}
@@ -183,14 +362,19 @@ mutable struct VST3Plugin
     num_inputs::Int
     num_outputs::Int
     active::Bool
+    owned::Bool
+    pending::Vector{Any}    # ProcessTicket is defined further down
 
-    function VST3Plugin(path::String, sample_rate::Float64, block_size::Int)
+    function VST3Plugin(path::String, sample_rate::Float64, block_size::Int;
+                        class::Union{String, Nothing}=nothing, lazycontroller::Bool=false)
         # Expand ~ and make path absolute
         expanded_path = abspath(expanduser(path))
 
-        handle = ccall((:vst3_load_plugin, libvst3), Ptr{Cvoid}, (Cstring,), expanded_path)
+        flags = lazycontroller ? LOAD_LAZY_CONTROLLER : UInt32(0)
+        handle = ccall((:vst3_load_plugin_ex, libvst3), Ptr{Cvoid}, (Cstring, Cstring, UInt32),
+                       expanded_path, class === nothing ? C_NULL : class, flags)
         if handle == C_NULL
-            error("Failed to load plugin: $expanded_path")
+            error("Failed to load plugin: $expanded_path" * (class === nothing ? "" : " ($class)"))
         end
 
         # Get plugin info
@@ -211,10 +395,11 @@ mutable struct VST3Plugin
         end
 
         plugin = new(handle, sample_rate, block_size,
-                    info_c[].num_inputs, info_c[].num_outputs, false)
+                    info_c[].num_inputs, info_c[].num_outputs, false, true, Any[])
 
         finalizer(plugin) do p
-            if p.handle != C_NULL
+            if p.handle != C_NULL && p.owned
+                drainpending!(p)
                 if p.active
                     deactivate!(p)
                 end
@@ -225,8 +410,98 @@ mutable struct VST3Plugin
 
         return plugin
     end
+
+    # Wrap an existing handle. Unowned handles (e.g. pooled instances) stay managed by the
+    # library; owned ones are unloaded by close and the finalizer.
+    function VST3Plugin(handle::Ptr{Cvoid}, sample_rate::Float64, block_size::Int, active::Bool;
+                        owned::Bool=false)
+        info_c = Ref{CPluginInfo}()
+        ret = ccall((:vst3_get_plugin_info, libvst3), Int32,
+                    (Ptr{Cvoid}, Ptr{CPluginInfo}), handle, info_c)
+        if ret != 0
+            owned && ccall((:vst3_unload_plugin, libvst3), Cvoid, (Ptr{Cvoid},), handle)
+            error("Failed to get plugin info")
+        end
+        plugin = new(handle, sample_rate, block_size,
+                     info_c[].num_inputs, info_c[].num_outputs, active, owned, Any[])
+        owned && finalizer(close, plugin)
+        return plugin
+    end
+end
+
+"""
+    VST3Host.init()
+
+Create the library's host context. Optional; the first load does it. Safe to call from
+any thread.
+"""
+function init()
+    ret = ccall((:vst3_init, libvst3), Int32, ())
+    ret == 0 || error("Failed to initialize VST3 host")
+    return nothing
+end
+
+"""
+    VST3Host.shutdown() -> Bool
+
+Wait for pending `loadasync` loads and release the host context. Returns `false`, doing
+nothing, while plugin instances are still loaded (close them first).
+"""
+shutdown() = ccall((:vst3_shutdown, libvst3), Int32, ()) == 0
+
+"""
+    loadasync(path::String, sample_rate::Float64, block_size::Int; class=nothing) -> Task
+
+Load a plugin on the library's loader threads and return a `Task` that yields the
+`VST3Plugin`. The module load and component/controller initialization run off the
+calling thread, so many plugins can be loaded concurrently.
+
+# Example
+```julia
+tasks = [loadasync(p, 48000.0, 512) for p in paths]
+plugins = fetch.(tasks)
+```
+"""
+function loadasync(path::String, sample_rate::Float64, block_size::Int;
+                   class::Union{String, Nothing}=nothing)
+    expanded_path = abspath(expanduser(path))
+
+    # The loader thread wakes this task through uv_async_send. It signals before
+    # the poll below can succeed, so `cond` is only closed once it is no longer used.
+    cond = Base.AsyncCondition()
+    request = ccall((:vst3_load_plugin_async, libvst3), Ptr{Cvoid},
+                    (Cstring, Cstring, Float64, Int32, Ptr{Cvoid}, Ptr{Cvoid}),
+                    expanded_path, class === nothing ? C_NULL : class,
+                    sample_rate, block_size, cglobal(:uv_async_send), cond.handle)
+    if request == C_NULL
+        close(cond)
+        error("Failed to start loading plugin: $expanded_path")
+    end
+
+    return @async begin
+        try
+            while ccall((:vst3_load_poll, libvst3), Int32, (Ptr{Cvoid},), request) == 0
+                wait(cond)
+            end
+        finally
+            close(cond)
+        end
+
+        handle = ccall((:vst3_load_wait, libvst3), Ptr{Cvoid}, (Ptr{Cvoid},), request)
+        if handle == C_NULL
+            error("Failed to load plugin: $expanded_path" * (class === nothing ? "" : " ($class)"))
+        end
+        VST3Plugin(handle, sample_rate, block_size, false; owned=true)
+    end
 end
 
+"""
+    loadedmodules() -> Int
+
+Number of plugin bundles currently loaded. Instances of the same bundle share one module.
+"""
+loadedmodules() = Int(ccall((:vst3_get_loaded_module_count, libvst3), Int32, ()))
+
 """
     close(plugin::VST3Plugin)
 
@@ -235,7 +510,8 @@ Cleanup and unload the plugin. Deactivates the plugin if active and releases res
 This is called automatically by the finalizer, but can be called explicitly for immediate cleanup.
 """
 function Base.close(plugin::VST3Plugin)
-    if plugin.handle != C_NULL
+    if plugin.handle != C_NULL && plugin.owned
+        drainpending!(plugin)
         if plugin.active
             deactivate!(plugin)
         end
@@ -269,7 +545,10 @@ function info(plugin::VST3Plugin)
         cstring_to_string(info_c[].vendor),
         info_c[].num_inputs,
         info_c[].num_outputs,
-        info_c[].num_parameters,
+        # A lazy controller is created by asking for the parameter count, which is
+        # refused while the plugin is active (the count then stays -1)
+        info_c[].num_parameters >= 0 || plugin.active ? info_c[].num_parameters :
+            ccall((:vst3_get_parameter_count, libvst3), Int32, (Ptr{Cvoid},), plugin.handle),
         info_c[].sample_rate
     )
 end
@@ -319,7 +598,8 @@ end
 """
     setparameter!(plugin::VST3Plugin, param_id::Int, value::Float64)
 
-Set parameter value (normalized 0.0-1.0).
+Set parameter value (normalized 0.0-1.0). The controller is updated immediately and
+the processor receives the change at the start of the next processed block.
 """
 function setparameter!(plugin::VST3Plugin, param_id::Int, value::Float64)
     @assert 0.0 <= value <= 1.0 "Parameter value must be between 0 and 1"
@@ -332,173 +612,1556 @@ function setparameter!(plugin::VST3Plugin, param_id::Int, value::Float64)
 end
 
 """
-    activate!(plugin::VST3Plugin)
+    savestate!(buffer::Vector{UInt8}, plugin::VST3Plugin) -> Vector{UInt8}
 
-Activate the plugin for processing.
+Serialize the plugin's component and controller state into `buffer`, growing it if
+needed, and return it resized to the state size. Reuse `buffer` to avoid allocation.
 """
-function activate!(plugin::VST3Plugin)
-    if !plugin.active
-        ret = ccall((:vst3_set_active, libvst3), Int32,
-                    (Ptr{Cvoid}, Int32), plugin.handle, 1)
-        if ret != 0
-            error("Failed to activate plugin")
+function savestate!(buffer::Vector{UInt8}, plugin::VST3Plugin)
+    while true
+        n = ccall((:vst3_save_state, libvst3), Int64,
+                  (Ptr{Cvoid}, Ptr{UInt8}, Int64), plugin.handle, buffer, length(buffer))
+        if n < 0
+            error("Failed to save plugin state")
         end
-        plugin.active = true
+        if n <= length(buffer)
+            return resize!(buffer, n)
+        end
+        resize!(buffer, n)
+    end
+end
+
+"""
+    savestate(plugin::VST3Plugin) -> Vector{UInt8}
+
+Snapshot the plugin's component and controller state as an opaque byte blob.
+"""
+savestate(plugin::VST3Plugin) = savestate!(Vector{UInt8}(undef, 64 * 1024), plugin)
+
+"""
+    loadstate!(plugin::VST3Plugin, state::Vector{UInt8})
+
+Restore a state blob produced by `savestate`. Much cheaper than reloading the plugin
+to reset it between renders.
+"""
+function loadstate!(plugin::VST3Plugin, state::Vector{UInt8})
+    ret = ccall((:vst3_load_state, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{UInt8}, Int64), plugin.handle, state, length(state))
+    if ret != 0
+        error("Failed to load plugin state")
     end
     return nothing
 end
 
 """
-    deactivate!(plugin::VST3Plugin)
+    loadpreset!(plugin::VST3Plugin, path::String)
 
-Deactivate the plugin.
+Load a `.vstpreset` file. The preset must have been saved from the same plugin class.
 """
-function deactivate!(plugin::VST3Plugin)
-    if plugin.active
-        ret = ccall((:vst3_set_active, libvst3), Int32,
-                    (Ptr{Cvoid}, Int32), plugin.handle, 0)
-        if ret != 0
-            @warn "Failed to deactivate plugin"
-        end
-        plugin.active = false
+function loadpreset!(plugin::VST3Plugin, path::String)
+    ret = ccall((:vst3_load_preset, libvst3), Int32,
+                (Ptr{Cvoid}, Cstring), plugin.handle, abspath(expanduser(path)))
+    if ret != 0
+        error("Failed to load preset: $path")
     end
     return nothing
 end
 
 """
-    process(plugin::VST3Plugin, input::SampleBuf{Float32})
+    savepreset(plugin::VST3Plugin, path::String)
 
-Process a buffer of audio and return output as SampleBuf.
+Save the plugin's current state as a `.vstpreset` file.
+"""
+function savepreset(plugin::VST3Plugin, path::String)
+    ret = ccall((:vst3_save_preset, libvst3), Int32,
+                (Ptr{Cvoid}, Cstring), plugin.handle, abspath(expanduser(path)))
+    if ret != 0
+        error("Failed to save preset: $path")
+    end
+    return nothing
+end
 
-# Arguments
-- `input::SampleBuf{Float32}`: Input audio buffer
-- Returns output as a new SampleBuf with shape (num_outputs, num_samples)
 """
-function process(plugin::VST3Plugin, input::SampleBuf{Float32})
-    num_samples = nsamples(input)
-    sr = samplerate(input)
-    output = SampleBuf(zeros(Float32, plugin.num_outputs, num_samples), sr)
-    process!(plugin, input, output)
-    return output
+    ScannedPlugin
+
+Audio effect class found by `scanplugins`, described without keeping the plugin loaded,
+or a bundle that could not be probed (`status != :ok`, empty `class_id`).
+
+# Fields
+- `name::String`: Class name
+- `vendor::String`: Vendor
+- `version::String`: Version string
+- `subcategories::Vector{String}`: Subcategories, e.g. `["Fx", "Reverb", "Stereo"]`
+- `class_id::String`: Class ID (32 hex digits)
+- `path::String`: Bundle path
+- `num_inputs::Int`: Main input channels, -1 if unknown
+- `num_outputs::Int`: Main output channels, -1 if unknown
+- `from_module_info::Bool`: Described by the bundle's moduleinfo.json rather than by loading it
+- `status::Symbol`: `:ok`, `:failed` (did not load or the probe crashed) or `:timeout`
+- `load_time_ms::Float64`: Time taken to describe the bundle when it was scanned
+"""
+struct ScannedPlugin
+    name::String
+    vendor::String
+    version::String
+    subcategories::Vector{String}
+    class_id::String
+    path::String
+    num_inputs::Int
+    num_outputs::Int
+    from_module_info::Bool
+    status::Symbol
+    load_time_ms::Float64
 end
 
-# Convenience overload for Matrix for backward compatibility
-function process(plugin::VST3Plugin, input::Matrix{Float32})
-    num_samples = size(input, 2)
-    # Use plugin's sample rate as default
-    sr = plugin.sample_rate
-    sample_buf = SampleBuf(input, sr)
-    output_buf = process(plugin, sample_buf)
-    return Array(output_buf)
+function Base.show(io::IO, p::ScannedPlugin)
+    print(io, "ScannedPlugin(\"$(p.name)\", vendor=\"$(p.vendor)\", $(p.num_inputs)→$(p.num_outputs))")
 end
 
-"""
-    process!(plugin::VST3Plugin, input::SampleBuf{Float32}, output::SampleBuf{Float32})
+default_scan_cache() = Sys.isapple() ?
+    joinpath(homedir(), "Library", "Caches", "VST3Host", "plugins.tsv") :
+    joinpath(homedir(), ".cache", "vst3host", "plugins.tsv")
 
-Process audio in-place, writing to pre-allocated output buffer.
+"""
+    PluginClass
 
-Automatically activates the plugin if not already active.
+Class exported by a plugin bundle.
 
-# Arguments
-- `input::SampleBuf{Float32}`: Input audio buffer
-- `output::SampleBuf{Float32}`: Output buffer (will be filled with processed audio)
+# Fields
+- `class_id::String`: Class ID (32 hex digits), usable as `VST3Plugin(...; class=id)`
+- `name::String`: Class name, also usable as `class=name`
+- `vendor::String`: Vendor
+- `version::String`: Version string
+- `category::String`: Class category; processors are `"Audio Module Class"`
+- `subcategories::Vector{String}`: Subcategories, e.g. `["Instrument", "Synth"]`
 """
-function process!(plugin::VST3Plugin, input::SampleBuf{Float32}, output::SampleBuf{Float32})
-    input_data = Array(input)
-    output_data = Array(output)
+struct PluginClass
+    class_id::String
+    name::String
+    vendor::String
+    version::String
+    category::String
+    subcategories::Vector{String}
+end
 
-    @assert size(input_data, 2) == size(output_data, 2) "Input and output must have same number of samples"
-    @assert size(input_data, 2) <= plugin.block_size "Block size exceeds maximum"
-    @assert size(input_data, 1) <= plugin.num_inputs "Too many input channels"
-    @assert size(output_data, 1) <= plugin.num_outputs "Too many output channels"
+"""
+    pluginclasses(path::String) -> Vector{PluginClass}
 
-    # Auto-activate if needed
-    if !plugin.active
-        activate!(plugin)
+List every class exported by a bundle, e.g. to pick one plugin out of a shell bundle.
+"""
+function pluginclasses(path::String)
+    expanded_path = abspath(expanduser(path))
+    n = ccall((:vst3_enumerate_classes, libvst3), Int32,
+              (Cstring, Ptr{CClassInfo}, Int32), expanded_path, C_NULL, 0)
+    if n < 0
+        error("Failed to load plugin: $expanded_path")
     end
 
-    num_samples = size(input_data, 2)
-    num_in_channels = size(input_data, 1)
-    num_out_channels = size(output_data, 1)
+    classes_c = Vector{CClassInfo}(undef, n)
+    n = ccall((:vst3_enumerate_classes, libvst3), Int32,
+              (Cstring, Ptr{CClassInfo}, Int32), expanded_path, classes_c, n)
+    n < 0 && error("Failed to load plugin: $expanded_path")
+
+    return [begin
+                subcategories = cstring_to_string(c.subcategories)
+                PluginClass(cstring_to_string(c.class_id), cstring_to_string(c.name),
+                            cstring_to_string(c.vendor), cstring_to_string(c.version),
+                            cstring_to_string(c.category),
+                            isempty(subcategories) ? String[] : String.(split(subcategories, '|')))
+            end for c in classes_c[1:min(n, length(classes_c))]]
+end
 
-    # Create pointers to each channel
-    input_ptrs = [pointer(input_data, (i-1)*num_samples + 1) for i in 1:num_in_channels]
-    output_ptrs = [pointer(output_data, (i-1)*num_samples + 1) for i in 1:num_out_channels]
+const scan_status = Dict(0 => :ok, 1 => :failed, 2 => :timeout)
 
-    ret = ccall((:vst3_process, libvst3), Int32,
-                (Ptr{Cvoid}, Ptr{Ptr{Float32}}, Ptr{Ptr{Float32}}, Int32, Int32, Int32),
-                plugin.handle, input_ptrs, output_ptrs, num_samples, num_in_channels, num_out_channels)
+const probe_path = joinpath(@__DIR__, "..", "lib", "vst3probe")
 
-    if ret != 0
-        error("Processing failed")
+"""
+    scanplugins(dirs::Vector{String}=String[]; cache=default, threads::Int=0,
+                timeout::Real=30, isolate::Bool=true, include_failed::Bool=false) -> Vector{ScannedPlugin}
+
+Find `.vst3` bundles under `dirs` (the standard VST3 locations if empty) and describe
+their audio effect classes. Bundles that ship a `moduleinfo.json` are described without
+loading them; others are probed concurrently on `threads` workers (one per core if 0).
+
+With `isolate=true` (and the `vst3probe` helper built) each probe runs in a child
+process that is killed after `timeout` seconds, so a hanging or crashing bundle only
+fails itself. Failed bundles are returned too when `include_failed=true`.
+
+Results are cached on disk keyed by bundle path and modification time, so only new or
+changed bundles are examined on later scans. Pass `cache=nothing` to disable the cache.
+"""
+function scanplugins(dirs::Vector{String}=String[];
+                     cache::Union{String, Nothing}=default_scan_cache(), threads::Int=0,
+                     timeout::Real=30, isolate::Bool=true, include_failed::Bool=false)
+    expanded = [abspath(expanduser(d)) for d in dirs]
+    if cache !== nothing
+        mkpath(dirname(cache))
     end
 
-    return nothing
-end
+    use_probe = isolate && isfile(probe_path)
+    probe = use_probe ? abspath(probe_path) : ""
 
-# Convenience overload for Matrix for backward compatibility
-function process!(plugin::VST3Plugin, input::Matrix{Float32}, output::Matrix{Float32})
-    sr = plugin.sample_rate
-    input_buf = SampleBuf(input, sr)
-    output_buf = SampleBuf(output, sr)
-    process!(plugin, input_buf, output_buf)
-    return nothing
+    handle = GC.@preserve probe begin
+        options = Ref(CScanOptions(threads, round(Int32, timeout * 1000),
+                                   use_probe ? pointer(probe) : Ptr{UInt8}(C_NULL)))
+        ccall((:vst3_scan_plugins, libvst3), Ptr{Cvoid},
+              (Ptr{Cstring}, Int32, Cstring, Ref{CScanOptions}),
+              expanded, length(expanded), cache === nothing ? C_NULL : cache, options)
+    end
+    if handle == C_NULL
+        error("Failed to scan plugins")
+    end
+
+    try
+        n = ccall((:vst3_scan_count, libvst3), Int32, (Ptr{Cvoid},), handle)
+        result = ScannedPlugin[]
+        entry_c = Ref{CScanEntry}()
+        for i in 0:(n - 1)
+            ccall((:vst3_scan_get, libvst3), Int32,
+                  (Ptr{Cvoid}, Int32, Ptr{CScanEntry}), handle, i, entry_c) == 0 || continue
+            e = entry_c[]
+            status = get(scan_status, Int(e.status), :failed)
+            (status == :ok || include_failed) || continue
+
+            subcategories = cstring_to_string(e.subcategories)
+            push!(result, ScannedPlugin(
+                cstring_to_string(e.name),
+                cstring_to_string(e.vendor),
+                cstring_to_string(e.version),
+                isempty(subcategories) ? String[] : String.(split(subcategories, '|')),
+                cstring_to_string(e.class_id),
+                cstring_to_string(e.path),
+                e.num_inputs,
+                e.num_outputs,
+                e.from_module_info != 0,
+                status,
+                e.load_time_ms
+            ))
+        end
+        return result
+    finally
+        ccall((:vst3_scan_free, libvst3), Cvoid, (Ptr{Cvoid},), handle)
+    end
 end
 
 """
-    noteon(plugin::VST3Plugin, channel::Int, note::Int, velocity::Int, offset::Int=0)
+    PluginPool(template::VST3Plugin, n::Int; threads::Int=0)
 
-Send MIDI Note On event.
+Pool of `n` clones of a configured template plugin. The template's state is
+snapshotted and the clones are created in parallel from the already loaded module,
+set up with the template's sample rate and block size, and left active.
 
-# Arguments
-- `channel`: MIDI channel (0-15)
-- `note`: Note number (0-127, middle C = 60)
-- `velocity`: Note velocity (0-127)
-- `offset`: Sample offset in next block (default: 0)
+Use `checkout!` / `checkin!` to borrow instances; a returned instance is reset to the
+template state. The template itself stays owned by the caller.
 """
-function noteon(plugin::VST3Plugin, channel::Int, note::Int, velocity::Int, offset::Int=0)
-    @assert 0 <= channel <= 15 "MIDI channel must be 0-15"
-    @assert 0 <= note <= 127 "MIDI note must be 0-127"
-    @assert 0 <= velocity <= 127 "MIDI velocity must be 0-127"
-    @assert 0 <= offset < plugin.block_size "Sample offset out of range"
+mutable struct PluginPool
+    handle::Ptr{Cvoid}
+    sample_rate::Float64
+    block_size::Int
 
-    ret = ccall((:vst3_send_note_on, libvst3), Int32,
-                (Ptr{Cvoid}, Int32, Int32, Int32, Int32),
-                plugin.handle, channel, note, velocity, offset)
+    function PluginPool(template::VST3Plugin, n::Int; threads::Int=0)
+        handle = ccall((:vst3_pool_create, libvst3), Ptr{Cvoid},
+                       (Ptr{Cvoid}, Int32, Int32), template.handle, n, threads)
+        if handle == C_NULL
+            error("Failed to create plugin pool")
+        end
 
-    if ret != 0
-        error("Failed to send note-on event")
+        pool = new(handle, template.sample_rate, template.block_size)
+        finalizer(close, pool)
+        return pool
     end
-    return nothing
 end
 
 """
-    noteoff(plugin::VST3Plugin, channel::Int, note::Int, offset::Int=0)
+    PluginPool(path::String, sample_rate::Float64, block_size::Int, n::Int; threads::Int=0)
 
-Send MIDI Note Off event.
-
-# Arguments
-- `channel`: MIDI channel (0-15)
-- `note`: Note number (0-127)
-- `offset`: Sample offset in next block (default: 0)
+Load a template instance from `path` and create a pool of `n` clones of it.
 """
-function noteoff(plugin::VST3Plugin, channel::Int, note::Int, offset::Int=0)
-    @assert 0 <= channel <= 15 "MIDI channel must be 0-15"
-    @assert 0 <= note <= 127 "MIDI note must be 0-127"
-    @assert 0 <= offset < plugin.block_size "Sample offset out of range"
-
-    ret = ccall((:vst3_send_note_off, libvst3), Int32,
-                (Ptr{Cvoid}, Int32, Int32, Int32),
-                plugin.handle, channel, note, offset)
+function PluginPool(path::String, sample_rate::Float64, block_size::Int, n::Int; threads::Int=0)
+    template = VST3Plugin(path, sample_rate, block_size)
+    try
+        return PluginPool(template, n; threads=threads)
+    finally
+        close(template)
+    end
+end
 
-    if ret != 0
-        error("Failed to send note-off event")
+function Base.close(pool::PluginPool)
+    if pool.handle != C_NULL
+        ccall((:vst3_pool_free, libvst3), Cvoid, (Ptr{Cvoid},), pool.handle)
+        pool.handle = C_NULL
     end
     return nothing
 end
 
+Base.length(pool::PluginPool) =
+    Int(ccall((:vst3_pool_size, libvst3), Int32, (Ptr{Cvoid},), pool.handle))
+
 """
-    controlchange(plugin::VST3Plugin, channel::Int, controller::Int, value::Int, offset::Int=0)
+    available(pool::PluginPool) -> Int
+
+Number of instances currently checked in.
+"""
+available(pool::PluginPool) =
+    Int(ccall((:vst3_pool_available, libvst3), Int32, (Ptr{Cvoid},), pool.handle))
+
+"""
+    checkout!(pool::PluginPool) -> Union{VST3Plugin, Nothing}
+
+Borrow an active, ready-to-process instance, or `nothing` if all are in use.
+"""
+function checkout!(pool::PluginPool)
+    handle = ccall((:vst3_pool_checkout, libvst3), Ptr{Cvoid}, (Ptr{Cvoid},), pool.handle)
+    handle == C_NULL && return nothing
+    return VST3Plugin(handle, pool.sample_rate, pool.block_size, true)
+end
+
+"""
+    checkin!(pool::PluginPool, plugin::VST3Plugin)
+
+Return a borrowed instance. It is reset to the template state. An instance that
+cannot be reset is replaced in the pool by a new clone, and an error is thrown.
+"""
+function checkin!(pool::PluginPool, plugin::VST3Plugin)
+    plugin.handle == C_NULL || drainpending!(plugin)
+    ret = ccall((:vst3_pool_checkin, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Cvoid}), pool.handle, plugin.handle)
+    plugin.handle = C_NULL
+    if ret != 0
+        error("Failed to return instance to pool")
+    end
+    return nothing
+end
+
+"""
+    PresetInfo
+
+Information about an indexed `.vstpreset` file.
+
+# Fields
+- `name::String`: Preset name (from the file's meta info, else the file name)
+- `plugin_name::String`: Plugin name recorded in the preset, if any
+- `category::String`: Plugin category recorded in the preset, if any
+- `class_id::String`: Class ID of the plugin the preset belongs to
+- `path::String`: File path
+"""
+struct PresetInfo
+    name::String
+    plugin_name::String
+    category::String
+    class_id::String
+    path::String
+end
+
+"""
+    PresetIndex(dirs::Vector{String}; threads::Int=0)
+
+Index all `.vstpreset` files below `dirs`. Files are read concurrently on `threads`
+workers (0 = one per core), reading only each file's chunk list and meta info.
+"""
+mutable struct PresetIndex
+    handle::Ptr{Cvoid}
+
+    function PresetIndex(dirs::Vector{String}; threads::Int=0)
+        expanded = [abspath(expanduser(d)) for d in dirs]
+        handle = ccall((:vst3_preset_index_create, libvst3), Ptr{Cvoid},
+                       (Ptr{Cstring}, Int32, Int32), expanded, length(expanded), threads)
+        if handle == C_NULL
+            error("Failed to index presets")
+        end
+
+        index = new(handle)
+        finalizer(close, index)
+        return index
+    end
+end
+
+PresetIndex(dir::String; threads::Int=0) = PresetIndex([dir]; threads=threads)
+
+function Base.close(index::PresetIndex)
+    if index.handle != C_NULL
+        ccall((:vst3_preset_index_free, libvst3), Cvoid, (Ptr{Cvoid},), index.handle)
+        index.handle = C_NULL
+    end
+    return nothing
+end
+
+Base.length(index::PresetIndex) =
+    Int(ccall((:vst3_preset_index_count, libvst3), Int32, (Ptr{Cvoid},), index.handle))
+
+function Base.getindex(index::PresetIndex, i::Int)
+    info_c = Ref{CPresetInfo}()
+    ret = ccall((:vst3_preset_index_get, libvst3), Int32,
+                (Ptr{Cvoid}, Int32, Ptr{CPresetInfo}), index.handle, i - 1, info_c)
+    if ret != 0
+        throw(BoundsError(index, i))
+    end
+
+    return PresetInfo(
+        cstring_to_string(info_c[].name),
+        cstring_to_string(info_c[].plugin_name),
+        cstring_to_string(info_c[].category),
+        cstring_to_string(info_c[].class_id),
+        cstring_to_string(info_c[].path)
+    )
+end
+
+"""
+    presets(index::PresetIndex) -> Vector{PresetInfo}
+
+All presets in the index.
+"""
+presets(index::PresetIndex) = [index[i] for i in 1:length(index)]
+
+"""
+    findpreset(index::PresetIndex, name::String) -> Union{PresetInfo, Nothing}
+
+Look up a preset by exact name.
+"""
+function findpreset(index::PresetIndex, name::String)
+    i = ccall((:vst3_preset_index_find, libvst3), Int32,
+              (Ptr{Cvoid}, Cstring), index.handle, name)
+    return i < 0 ? nothing : index[i + 1]
+end
+
+"""
+    searchpresets(index::PresetIndex, query::String; max_results::Int=256) -> Vector{PresetInfo}
+
+Case-insensitive substring search over preset names.
+"""
+function searchpresets(index::PresetIndex, query::String; max_results::Int=256)
+    results = Vector{Int32}(undef, max_results)
+    n = ccall((:vst3_preset_index_search, libvst3), Int32,
+              (Ptr{Cvoid}, Cstring, Ptr{Int32}, Int32),
+              index.handle, query, results, max_results)
+    if n < 0
+        error("Preset search failed")
+    end
+    return [index[Int(results[k]) + 1] for k in 1:n]
+end
+
+"""
+    applypreset!(plugin::VST3Plugin, index::PresetIndex, name::String)
+
+Apply the preset named `name` that belongs to the plugin's class: a hash lookup
+followed by a single state restore.
+"""
+function applypreset!(plugin::VST3Plugin, index::PresetIndex, name::String)
+    ret = ccall((:vst3_preset_index_apply, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Cvoid}, Cstring), index.handle, plugin.handle, name)
+    if ret != 0
+        error("Failed to apply preset: $name")
+    end
+    return nothing
+end
+
+"""
+    latency(plugin::VST3Plugin) -> Int
+
+Processing latency in samples. Reflects latency changes once `applyrestart!` (or
+activation) has applied them.
+"""
+function latency(plugin::VST3Plugin)
+    return Int(ccall((:vst3_get_latency_samples, libvst3), Int32, (Ptr{Cvoid},), plugin.handle))
+end
+
+"""
+    pollrestart!(plugin::VST3Plugin) -> Int32
+
+Return the restart flags the plugin has requested since the last call and refresh the
+cached channel counts. Latency, I/O and parameter changes among them take effect with
+`applyrestart!` or the next activation; processing never applies them.
+"""
+function pollrestart!(plugin::VST3Plugin)
+    flags = ccall((:vst3_poll_restart_flags, libvst3), Int32, (Ptr{Cvoid},), plugin.handle)
+    if flags != 0
+        refreshchannels!(plugin)
+    end
+    return flags
+end
+
+"""
+    applyrestart!(plugin::VST3Plugin) -> Int32
+
+Apply the latency changes, I/O changes and parameter remapping the plugin has requested,
+reactivating it where needed, and refresh the cached channel counts. Returns the flags
+applied. Call while the plugin is not being processed, also not by a chain, graph,
+stream or `AudioThread` it belongs to.
+"""
+function applyrestart!(plugin::VST3Plugin)
+    flags = ccall((:vst3_apply_restart, libvst3), Int32, (Ptr{Cvoid},), plugin.handle)
+    if flags != 0
+        refreshchannels!(plugin)
+    end
+    return flags
+end
+
+# Reads the plugin info directly rather than through info(), which would create a lazy controller
+function refreshchannels!(plugin::VST3Plugin)
+    info_c = Ref{CPluginInfo}()
+    ret = ccall((:vst3_get_plugin_info, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{CPluginInfo}), plugin.handle, info_c)
+    ret == 0 || error("Failed to get plugin info")
+    plugin.num_inputs = info_c[].num_inputs
+    plugin.num_outputs = info_c[].num_outputs
+    return nothing
+end
+
+"""
+    activate!(plugin::VST3Plugin)
+
+Activate the plugin for processing.
+"""
+function activate!(plugin::VST3Plugin)
+    if !plugin.active
+        ret = ccall((:vst3_set_active, libvst3), Int32,
+                    (Ptr{Cvoid}, Int32), plugin.handle, 1)
+        if ret != 0
+            error("Failed to activate plugin")
+        end
+        plugin.active = true
+    end
+    return nothing
+end
+
+"""
+    deactivate!(plugin::VST3Plugin)
+
+Deactivate the plugin.
+"""
+function deactivate!(plugin::VST3Plugin)
+    if plugin.active
+        ret = ccall((:vst3_set_active, libvst3), Int32,
+                    (Ptr{Cvoid}, Int32), plugin.handle, 0)
+        if ret != 0
+            @warn "Failed to deactivate plugin"
+        end
+        plugin.active = false
+    end
+    return nothing
+end
+
+"""
+    process(plugin::VST3Plugin, input::SampleBuf{Float32})
+
+Process a buffer of audio and return output as SampleBuf.
+
+# Arguments
+- `input::SampleBuf{Float32}`: Input audio buffer
+- Returns output as a new SampleBuf with shape (num_outputs, num_samples)
+"""
+function process(plugin::VST3Plugin, input::SampleBuf{Float32})
+    num_samples = nsamples(input)
+    sr = samplerate(input)
+    output = SampleBuf(zeros(Float32, plugin.num_outputs, num_samples), sr)
+    process!(plugin, input, output)
+    return output
+end
+
+# Convenience overload for Matrix for backward compatibility
+function process(plugin::VST3Plugin, input::Matrix{Float32})
+    num_samples = size(input, 2)
+    # Use plugin's sample rate as default
+    sr = plugin.sample_rate
+    sample_buf = SampleBuf(input, sr)
+    output_buf = process(plugin, sample_buf)
+    return Array(output_buf)
+end
+
+"""
+    process!(plugin::VST3Plugin, input::SampleBuf{Float32}, output::SampleBuf{Float32})
+
+Process audio in-place, writing to pre-allocated output buffer.
+
+Automatically activates the plugin if not already active.
+
+# Arguments
+- `input::SampleBuf{Float32}`: Input audio buffer
+- `output::SampleBuf{Float32}`: Output buffer (will be filled with processed audio)
+"""
+function process!(plugin::VST3Plugin, input::SampleBuf{Float32}, output::SampleBuf{Float32})
+    input_data = Array(input)
+    output_data = Array(output)
+
+    @assert size(input_data, 2) == size(output_data, 2) "Input and output must have same number of samples"
+    @assert size(input_data, 2) <= plugin.block_size "Block size exceeds maximum"
+    @assert size(input_data, 1) <= plugin.num_inputs "Too many input channels"
+    @assert size(output_data, 1) <= plugin.num_outputs "Too many output channels"
+
+    # Auto-activate if needed
+    if !plugin.active
+        activate!(plugin)
+    end
+
+    num_samples = size(input_data, 2)
+    num_in_channels = size(input_data, 1)
+    num_out_channels = size(output_data, 1)
+
+    # Create pointers to each channel
+    input_ptrs = [pointer(input_data, (i-1)*num_samples + 1) for i in 1:num_in_channels]
+    output_ptrs = [pointer(output_data, (i-1)*num_samples + 1) for i in 1:num_out_channels]
+
+    ret = ccall((:vst3_process, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Ptr{Float32}}, Ptr{Ptr{Float32}}, Int32, Int32, Int32),
+                plugin.handle, input_ptrs, output_ptrs, num_samples, num_in_channels, num_out_channels)
+
+    if ret != 0
+        error("Processing failed")
+    end
+
+    return nothing
+end
+
+# Convenience overload for Matrix for backward compatibility
+function process!(plugin::VST3Plugin, input::Matrix{Float32}, output::Matrix{Float32})
+    sr = plugin.sample_rate
+    input_buf = SampleBuf(input, sr)
+    output_buf = SampleBuf(output, sr)
+    process!(plugin, input_buf, output_buf)
+    return nothing
+end
+
+"""
+    PluginChain(plugins::Vector{VST3Plugin}; channels::Int=2)
+
+Serial chain of plugins processed inside the library with one call per block. Audio
+moves between stages through two internal scratch buffers, so there are no copies or
+Julia calls per stage. Plugins must be set up with a block size of at least the
+chain's; the chain uses the first plugin's block size.
+
+The chain keeps its plugins alive but does not close them.
+"""
+mutable struct PluginChain
+    handle::Ptr{Cvoid}
+    plugins::Vector{VST3Plugin}
+    channels::Int
+    block_size::Int
+
+    function PluginChain(plugins::Vector{VST3Plugin}; channels::Int=2)
+        isempty(plugins) && error("A chain needs at least one plugin")
+        block_size = minimum(p.block_size for p in plugins)
+
+        handle = ccall((:vst3_chain_create, libvst3), Ptr{Cvoid}, (Int32, Int32), channels, block_size)
+        if handle == C_NULL
+            error("Failed to create plugin chain")
+        end
+
+        chain = new(handle, VST3Plugin[], channels, block_size)
+        finalizer(close, chain)
+        for plugin in plugins
+            push!(chain, plugin)
+        end
+        return chain
+    end
+end
+
+function Base.push!(chain::PluginChain, plugin::VST3Plugin)
+    index = ccall((:vst3_chain_add, libvst3), Int32, (Ptr{Cvoid}, Ptr{Cvoid}), chain.handle, plugin.handle)
+    if index < 0
+        error("Failed to add plugin to chain")
+    end
+    push!(chain.plugins, plugin)
+    return chain
+end
+
+function Base.close(chain::PluginChain)
+    if chain.handle != C_NULL
+        ccall((:vst3_chain_free, libvst3), Cvoid, (Ptr{Cvoid},), chain.handle)
+        chain.handle = C_NULL
+    end
+    return nothing
+end
+
+Base.length(chain::PluginChain) = length(chain.plugins)
+
+"""
+    latency(chain::PluginChain) -> Int
+
+Total latency in samples of the chain's plugins that are not bypassed.
+"""
+latency(chain::PluginChain) = Int(ccall((:vst3_chain_get_latency, libvst3), Int32, (Ptr{Cvoid},), chain.handle))
+
+"""
+    bypass!(chain::PluginChain, i::Int, bypassed::Bool=true)
+
+Skip (or re-enable) the `i`-th plugin of the chain from the next block on.
+"""
+function bypass!(chain::PluginChain, i::Int, bypassed::Bool=true)
+    ret = ccall((:vst3_chain_set_bypass, libvst3), Int32,
+                (Ptr{Cvoid}, Int32, Int32), chain.handle, i - 1, bypassed)
+    if ret != 0
+        throw(BoundsError(chain.plugins, i))
+    end
+    return nothing
+end
+
+"""
+    process!(chain::PluginChain, input::Matrix{Float32}, output::Matrix{Float32})
+
+Run one block through the chain. Buffers are laid out as for `process!` on a plugin and
+have `chain.channels` channels; `input` and `output` may be the same matrix.
+"""
+function process!(chain::PluginChain, input::Matrix{Float32}, output::Matrix{Float32})
+    @assert size(input) == size(output) "Input and output must have the same size"
+    @assert size(input, 1) == chain.channels "Chain processes $(chain.channels) channels"
+    num_samples = size(input, 2)
+    @assert num_samples <= chain.block_size "Block size exceeds maximum"
+
+    for plugin in chain.plugins
+        plugin.active || activate!(plugin)
+    end
+
+    input_ptrs = [pointer(input, (i-1)*num_samples + 1) for i in 1:chain.channels]
+    output_ptrs = [pointer(output, (i-1)*num_samples + 1) for i in 1:chain.channels]
+
+    ret = GC.@preserve input output ccall((:vst3_chain_process, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Ptr{Float32}}, Ptr{Ptr{Float32}}, Int32),
+                chain.handle, input_ptrs, output_ptrs, num_samples)
+    if ret != 0
+        error("Chain processing failed")
+    end
+    return nothing
+end
+
+"""
+    PluginGraph(; channels=2, blocksize=512, threads=0, maxlatency=8192)
+
+A processing graph of plugins with parallel branches, summing and sidechains. Nodes are
+added with `addnode!` and wired with `connect!`, using `:input` and `:output` for the
+graph's own input and output. Independent branches run concurrently on `threads` workers
+(counting the calling thread; 0 for one per core). The graph does not own its plugins.
+
+Plugin latencies are compensated: paths meeting at a summing point are delayed to match
+the slowest one, following latency changes without reallocating as long as the
+difference stays within `maxlatency` samples.
+
+The graph may be edited and recompiled from another task while one task processes it;
+the audio side switches to the new schedule at its next block without waiting.
+
+# Fields
+- `handle::Ptr{Cvoid}`: Native graph handle
+- `plugins::Vector{Union{VST3Plugin, Nothing}}`: Nodes in id order (`nothing` once removed), kept alive by the graph
+- `removed::Vector{VST3Plugin}`: Removed plugins kept alive until the graph is closed
+- `channels::Int`: Channels of the graph's input and output
+- `block_size::Int`: Maximum samples per block
+- `compiled::Bool`: False when nodes or connections changed since the last `compile!`
+"""
+mutable struct PluginGraph
+    handle::Ptr{Cvoid}
+    plugins::Vector{Union{VST3Plugin, Nothing}}
+    removed::Vector{VST3Plugin}
+    channels::Int
+    block_size::Int
+    compiled::Bool
+
+    function PluginGraph(; channels::Int=2, blocksize::Int=512, threads::Int=0, maxlatency::Int=8192)
+        handle = ccall((:vst3_graph_create, libvst3), Ptr{Cvoid}, (Int32, Int32, Int32),
+                       channels, blocksize, threads)
+        if handle == C_NULL
+            error("Failed to create plugin graph")
+        end
+        ccall((:vst3_graph_set_max_latency, libvst3), Int32, (Ptr{Cvoid}, Int32), handle, maxlatency)
+
+        graph = new(handle, Union{VST3Plugin, Nothing}[], VST3Plugin[], channels, blocksize, false)
+        finalizer(close, graph)
+        return graph
+    end
+end
+
+function Base.close(graph::PluginGraph)
+    if graph.handle != C_NULL
+        ccall((:vst3_graph_free, libvst3), Cvoid, (Ptr{Cvoid},), graph.handle)
+        graph.handle = C_NULL
+    end
+    return nothing
+end
+
+Base.length(graph::PluginGraph) = count(!isnothing, graph.plugins)
+
+"""
+    latency(graph::PluginGraph) -> Int
+
+Latency in samples of the graph output after compensation, as of the last block.
+"""
+latency(graph::PluginGraph) = Int(ccall((:vst3_graph_get_latency, libvst3), Int32, (Ptr{Cvoid},), graph.handle))
+
+function graphnode(graph::PluginGraph, node)
+    node === :input && return Int32(-1)
+    node === :output && return Int32(-2)
+    1 <= node <= length(graph.plugins) && graph.plugins[node] !== nothing || throw(BoundsError(graph.plugins, node))
+    return Int32(node - 1)
+end
+
+"""
+Scheduling statistics of a graph's last block, from moving averages of measured node
+run times.
+
+# Fields
+- `predicted_ms::Float64`: Best achievable block time, the larger of the critical path and the total work spread over all workers
+- `actual_ms::Float64`: Measured block time
+- `critical_path_ms::Float64`: Costliest chain of dependent nodes
+- `total_work_ms::Float64`: Sum of all node costs
+- `num_workers::Int`: Threads processing the graph
+"""
+struct GraphStats
+    predicted_ms::Float64
+    actual_ms::Float64
+    critical_path_ms::Float64
+    total_work_ms::Float64
+    num_workers::Int
+end
+
+"""
+    graphstats(graph::PluginGraph) -> GraphStats
+
+Predicted versus actual block time of the last block. `predicted_ms / actual_ms` close
+to 1 means the schedule keeps the workers busy.
+"""
+function graphstats(graph::PluginGraph)
+    stats = Ref{CGraphStats}()
+    ret = ccall((:vst3_graph_get_stats, libvst3), Int32, (Ptr{Cvoid}, Ptr{CGraphStats}), graph.handle, stats)
+    if ret != 0
+        error("Failed to get graph statistics")
+    end
+    c = stats[]
+    return GraphStats(c.predicted_ms, c.actual_ms, c.critical_path_ms, c.total_work_ms, Int(c.num_workers))
+end
+
+"""
+    addnode!(graph::PluginGraph, plugin::VST3Plugin) -> Int
+
+Add a plugin as a node and return its node id.
+"""
+function addnode!(graph::PluginGraph, plugin::VST3Plugin)
+    id = ccall((:vst3_graph_add_node, libvst3), Int32, (Ptr{Cvoid}, Ptr{Cvoid}),
+               graph.handle, plugin.handle)
+    if id < 0
+        error("Failed to add plugin to graph")
+    end
+    push!(graph.plugins, plugin)
+    graph.compiled = false
+    return Int(id) + 1
+end
+
+"""
+    removenode!(graph::PluginGraph, node::Int; unload=false)
+
+Remove a node and its connections; other node ids stay the same. The change takes effect
+with the next `compile!`. With `unload=true` the library deactivates and unloads the
+plugin once the audio side can no longer use it and `plugin` must not be used
+afterwards; otherwise the graph keeps the plugin alive until it is closed.
+"""
+function removenode!(graph::PluginGraph, node::Int; unload::Bool=false)
+    plugin = graph.plugins[node]
+    plugin === nothing && throw(BoundsError(graph.plugins, node))
+
+    owned = unload && plugin.owned
+    ret = ccall((:vst3_graph_remove_node, libvst3), Int32, (Ptr{Cvoid}, Int32, Int32),
+                graph.handle, node - 1, owned)
+    if ret != 0
+        error("Failed to remove node $node")
+    end
+
+    graph.plugins[node] = nothing
+    if owned
+        # Ownership passes to the graph
+        plugin.owned = false
+        plugin.handle = C_NULL
+    else
+        push!(graph.removed, plugin)
+    end
+    graph.compiled = false
+    return graph
+end
+
+"""
+    connect!(graph::PluginGraph, source, dest; gain=1.0, sidechain=false)
+
+Route the output of node `source` (or `:input`) into node `dest` (or `:output`), scaled
+by `gain`. Several connections into one input are summed. With `sidechain=true` the
+signal feeds `dest`'s sidechain input instead of its main input; the first sidechain
+connection of a node must be made before a `compile!` that includes it.
+"""
+function connect!(graph::PluginGraph, source, dest; gain::Real=1.0, sidechain::Bool=false)
+    ret = if sidechain
+        ccall((:vst3_graph_connect_sidechain, libvst3), Int32, (Ptr{Cvoid}, Int32, Int32, Float32),
+              graph.handle, graphnode(graph, source), graphnode(graph, dest), gain)
+    else
+        ccall((:vst3_graph_connect, libvst3), Int32, (Ptr{Cvoid}, Int32, Int32, Float32),
+              graph.handle, graphnode(graph, source), graphnode(graph, dest), gain)
+    end
+    if ret != 0
+        error("Failed to connect $source to $dest")
+    end
+    graph.compiled = false
+    return graph
+end
+
+"""
+    setgain!(graph::PluginGraph, source, dest, gain)
+
+Change the gain from `source` to `dest` (for example a send level, or a node's level
+into `:output`) without recompiling. The next block ramps smoothly to the new gain.
+"""
+function setgain!(graph::PluginGraph, source, dest, gain::Real)
+    ret = ccall((:vst3_graph_set_gain, libvst3), Int32, (Ptr{Cvoid}, Int32, Int32, Float32),
+                graph.handle, graphnode(graph, source), graphnode(graph, dest), gain)
+    if ret != 0
+        error("$source is not connected to $dest")
+    end
+    return graph
+end
+
+"""
+    disconnect!(graph::PluginGraph, source, dest)
+
+Remove the connections from `source` to `dest`.
+"""
+function disconnect!(graph::PluginGraph, source, dest)
+    ret = ccall((:vst3_graph_disconnect, libvst3), Int32, (Ptr{Cvoid}, Int32, Int32),
+                graph.handle, graphnode(graph, source), graphnode(graph, dest))
+    if ret != 0
+        error("$source is not connected to $dest")
+    end
+    graph.compiled = false
+    return graph
+end
+
+"""
+    compile!(graph::PluginGraph)
+
+Order the nodes and assign scratch buffers after changing the graph. `process!` compiles
+on demand; call this ahead of time to keep the work off the first block.
+"""
+function compile!(graph::PluginGraph)
+    ret = ccall((:vst3_graph_compile, libvst3), Int32, (Ptr{Cvoid},), graph.handle)
+    if ret != 0
+        error("Failed to compile graph (do the connections form a cycle?)")
+    end
+    graph.compiled = true
+    return graph
+end
+
+"""
+    process!(graph::PluginGraph, input::Matrix{Float32}, output::Matrix{Float32})
+
+Run one block through the graph. Buffers are laid out as for `process!` on a plugin and
+have `graph.channels` channels; `input` and `output` must be different matrices.
+"""
+function process!(graph::PluginGraph, input::Matrix{Float32}, output::Matrix{Float32})
+    @assert size(input) == size(output) "Input and output must have the same size"
+    @assert input !== output "Input and output must be different matrices"
+    @assert size(input, 1) == graph.channels "Graph processes $(graph.channels) channels"
+    num_samples = size(input, 2)
+    @assert num_samples <= graph.block_size "Block size exceeds maximum"
+
+    graph.compiled || compile!(graph)
+    for plugin in graph.plugins
+        plugin === nothing || plugin.active || activate!(plugin)
+    end
+
+    input_ptrs = [pointer(input, (i-1)*num_samples + 1) for i in 1:graph.channels]
+    output_ptrs = [pointer(output, (i-1)*num_samples + 1) for i in 1:graph.channels]
+
+    ret = GC.@preserve input output ccall((:vst3_graph_process, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Ptr{Float32}}, Ptr{Ptr{Float32}}, Int32),
+                graph.handle, input_ptrs, output_ptrs, num_samples)
+    if ret != 0
+        error("Graph processing failed")
+    end
+    return nothing
+end
+
+const AudioTarget = Union{VST3Plugin, PluginChain, PluginGraph}
+
+# VST3_AUDIO_TARGET_* kind, plugins and (input, output) channels of a target, readied for processing
+function audiotarget(target::AudioTarget)
+    if target isa VST3Plugin
+        kind, plugins, channels = 0, [target], (target.num_inputs, target.num_outputs)
+    elseif target isa PluginChain
+        kind, plugins, channels = 1, target.plugins, (target.channels, target.channels)
+    else
+        target.compiled || compile!(target)
+        kind = 2
+        plugins = VST3Plugin[p for p in target.plugins if p !== nothing]
+        channels = (target.channels, target.channels)
+    end
+    for plugin in plugins
+        plugin.active || activate!(plugin)
+    end
+    return kind, plugins, channels
+end
+
+"""
+    AudioThread(target; period=256, samplerate=nothing, inputs=nothing, outputs=nothing,
+                ringperiods=4, realtime=false, priority=0, lockmemory=false)
+
+Process `target` (a `VST3Plugin`, `PluginChain` or `PluginGraph`) on a thread owned by
+the library, woken every `period` samples by a simulated device clock, so garbage
+collection on the Julia side cannot delay a block. Feed input with `write` and collect
+output with `read!`; both move interleaved `(channels, frames)`
+matrices through lock-free rings holding `ringperiods` periods. Missing input is
+processed as silence and output that does not fit is dropped, as a device would.
+
+With `realtime` the thread asks for `SCHED_FIFO` scheduling, falling back to normal
+scheduling without the privilege; denormals are always flushed to zero. `lockmemory`
+calls `mlockall`, which is process-wide: it pins every page of the Julia process,
+including the whole GC heap and everything allocated later, until the last audio
+thread that locked memory is closed.
+`samplerate` defaults to the (first) plugin's, and the channel counts to the plugin's or
+the chain's or graph's. Do not `process!` the target while the thread runs.
+
+# Fields
+- `handle::Ptr{Cvoid}`: Native thread handle
+- `target::Union{VST3Plugin, PluginChain, PluginGraph}`: What the thread processes, kept alive while it runs
+- `period::Int`: Samples per period
+- `sample_rate::Float64`: Rate of the simulated clock
+- `inputs::Int`: Input channels
+- `outputs::Int`: Output channels
+"""
+mutable struct AudioThread
+    handle::Ptr{Cvoid}
+    target::AudioTarget
+    period::Int
+    sample_rate::Float64
+    inputs::Int
+    outputs::Int
+
+    function AudioThread(target::AudioTarget; period::Int=256,
+                         samplerate::Union{Real, Nothing}=nothing,
+                         inputs::Union{Int, Nothing}=nothing, outputs::Union{Int, Nothing}=nothing,
+                         ringperiods::Int=4, realtime::Bool=false, priority::Int=0,
+                         lockmemory::Bool=false)
+        kind, plugins, channels = audiotarget(target)
+
+        rate = samplerate !== nothing ? Float64(samplerate) :
+               isempty(plugins) ? 48000.0 : first(plugins).sample_rate
+        nin = something(inputs, channels[1])
+        nout = something(outputs, channels[2])
+
+        config = Ref(CAudioThreadConfig(rate, period, nin, nout, ringperiods, realtime, priority,
+                                               lockmemory))
+        handle = ccall((:vst3_audio_thread_start, libvst3), Ptr{Cvoid},
+                       (Ptr{CAudioThreadConfig}, Int32, Ptr{Cvoid}), config, kind, target.handle)
+        if handle == C_NULL
+            error("Failed to start audio thread")
+        end
+
+        thread = new(handle, target, period, rate, nin, nout)
+        finalizer(close, thread)
+        return thread
+    end
+end
+
+function Base.close(thread::AudioThread)
+    if thread.handle != C_NULL
+        ccall((:vst3_audio_thread_stop, libvst3), Cvoid, (Ptr{Cvoid},), thread.handle)
+        thread.handle = C_NULL
+    end
+    return nothing
+end
+
+"""
+    write(thread::AudioThread, input::Matrix{Float32}) -> Int
+
+Queue the frames (columns) of `input`, which has `thread.inputs` rows, for processing.
+Returns the number of frames accepted; fewer than `size(input, 2)` when the ring is full.
+"""
+function Base.write(thread::AudioThread, input::Matrix{Float32})
+    @assert size(input, 1) == thread.inputs "Audio thread takes $(thread.inputs) input channels"
+    n = GC.@preserve input ccall((:vst3_audio_thread_write, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Float32}, Int32), thread.handle, input, size(input, 2))
+    n < 0 && error("Failed to write to audio thread")
+    return Int(n)
+end
+
+"""
+    read!(thread::AudioThread, output::Matrix{Float32}) -> Int
+
+Take processed frames into the columns of `output`, which has `thread.outputs` rows.
+Returns the number of frames copied; fewer than `size(output, 2)` when no more are ready.
+"""
+function Base.read!(thread::AudioThread, output::Matrix{Float32})
+    @assert size(output, 1) == thread.outputs "Audio thread produces $(thread.outputs) output channels"
+    n = GC.@preserve output ccall((:vst3_audio_thread_read, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Float32}, Int32), thread.handle, output, size(output, 2))
+    n < 0 && error("Failed to read from audio thread")
+    return Int(n)
+end
+
+"""
+Deadline and ring statistics of an `AudioThread` since it started.
+
+# Fields
+- `periods::Int`: Periods processed
+- `deadline_misses::Int`: Periods whose processing ended after the next period began
+- `underruns::Int`: Periods processed as silence because input was missing
+- `overruns::Int`: Output periods dropped because the output ring was full
+- `period_ms::Float64`: Length of a period
+- `max_process_ms::Float64`: Slowest period's processing time
+- `avg_process_ms::Float64`: Mean processing time per period
+- `max_wakeup_ms::Float64`: Worst lateness of the thread waking at a clock tick
+- `realtime::Bool`: Whether `SCHED_FIFO` was granted
+- `memory_locked::Bool`: Whether memory was locked
+"""
+struct AudioThreadStats
+    periods::Int
+    deadline_misses::Int
+    underruns::Int
+    overruns::Int
+    period_ms::Float64
+    max_process_ms::Float64
+    avg_process_ms::Float64
+    max_wakeup_ms::Float64
+    realtime::Bool
+    memory_locked::Bool
+end
+
+"""
+    audiostats(thread::AudioThread) -> AudioThreadStats
+
+Deadline misses, ring under- and overruns and processing times so far.
+"""
+function audiostats(thread::AudioThread)
+    stats = Ref{CAudioThreadStats}()
+    ret = ccall((:vst3_audio_thread_get_stats, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{CAudioThreadStats}), thread.handle, stats)
+    if ret != 0
+        error("Failed to get audio thread statistics")
+    end
+    c = stats[]
+    return AudioThreadStats(c.periods, c.deadline_misses, c.underruns, c.overruns, c.period_ms,
+                            c.max_process_ms, c.avg_process_ms, c.max_wakeup_ms,
+                            c.realtime != 0, c.memory_locked != 0)
+end
+
+"""
+    PluginStream(target; blocksize=target's block size, inputs=nothing, outputs=nothing, capacity=4096)
+
+Feed a `VST3Plugin`, `PluginChain` or `PluginGraph` chunks of any size and have it
+process in fixed blocks of `blocksize` samples. `write` queues interleaved
+`(channels, frames)` input and `read!` processes whole blocks until enough output is
+ready, so output lags input by up to one block. Both go through lock-free rings holding
+`capacity` frames plus a block, so one task may write while another reads. Once all
+input is written, `flush` processes the final partial block. Instruments (no inputs)
+process whenever output is read. Do not `process!` the target while streaming.
+
+# Fields
+- `handle::Ptr{Cvoid}`: Native stream handle
+- `target::Union{VST3Plugin, PluginChain, PluginGraph}`: What the stream processes, kept alive by the stream
+- `block_size::Int`: Samples per processed block
+- `inputs::Int`: Input channels
+- `outputs::Int`: Output channels
+"""
+mutable struct PluginStream
+    handle::Ptr{Cvoid}
+    target::AudioTarget
+    block_size::Int
+    inputs::Int
+    outputs::Int
+
+    function PluginStream(target::AudioTarget; blocksize::Int=target.block_size,
+                          inputs::Union{Int, Nothing}=nothing, outputs::Union{Int, Nothing}=nothing,
+                          capacity::Int=4096)
+        kind, _, channels = audiotarget(target)
+        nin = something(inputs, channels[1])
+        nout = something(outputs, channels[2])
+
+        handle = ccall((:vst3_stream_create, libvst3), Ptr{Cvoid},
+                       (Int32, Ptr{Cvoid}, Int32, Int32, Int32, Int32),
+                       kind, target.handle, blocksize, nin, nout, capacity)
+        if handle == C_NULL
+            error("Failed to create plugin stream")
+        end
+
+        stream = new(handle, target, blocksize, nin, nout)
+        finalizer(close, stream)
+        return stream
+    end
+end
+
+function Base.close(stream::PluginStream)
+    if stream.handle != C_NULL
+        ccall((:vst3_stream_free, libvst3), Cvoid, (Ptr{Cvoid},), stream.handle)
+        stream.handle = C_NULL
+    end
+    return nothing
+end
+
+"""
+    write(stream::PluginStream, input::Matrix{Float32}) -> Int
+
+Queue the frames (columns) of `input`, which has `stream.inputs` rows. Returns the
+number of frames accepted; fewer than `size(input, 2)` when the ring is full.
+"""
+function Base.write(stream::PluginStream, input::Matrix{Float32})
+    @assert size(input, 1) == stream.inputs "Stream takes $(stream.inputs) input channels"
+    n = GC.@preserve input ccall((:vst3_stream_push, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Float32}, Int32), stream.handle, input, size(input, 2))
+    n < 0 && error("Failed to write to plugin stream")
+    return Int(n)
+end
+
+"""
+    read!(stream::PluginStream, output::Matrix{Float32}) -> Int
+
+Process queued blocks as needed and copy up to `size(output, 2)` frames into `output`,
+which has `stream.outputs` rows. Returns the number of frames copied.
+"""
+function Base.read!(stream::PluginStream, output::Matrix{Float32})
+    @assert size(output, 1) == stream.outputs "Stream produces $(stream.outputs) output channels"
+    n = GC.@preserve output ccall((:vst3_stream_pull, libvst3), Int32,
+                (Ptr{Cvoid}, Ptr{Float32}, Int32), stream.handle, output, size(output, 2))
+    n < 0 && error("Plugin stream processing failed")
+    return Int(n)
+end
+
+"""
+    flush(stream::PluginStream) -> Int
+
+Process the input left after the last whole block, once all input is written. Stops
+early when the output ring fills up; read the output and call again until it returns 0.
+Returns the frames processed.
+"""
+function Base.flush(stream::PluginStream)
+    n = ccall((:vst3_stream_flush, libvst3), Int32, (Ptr{Cvoid},), stream.handle)
+    n < 0 && error("Plugin stream processing failed")
+    return Int(n)
+end
+
+"""
+    available(stream::PluginStream) -> Int
+
+Frames of output ready to read without processing.
+"""
+available(stream::PluginStream) = Int(ccall((:vst3_stream_available, libvst3), Int32, (Ptr{Cvoid},), stream.handle))
+
+"""
+Result of `renderfile`.
+
+# Fields
+- `input_frames::Int`: Frames read from the input file
+- `output_frames::Int`: Frames written, including the tail
+- `latency_samples::Int`: Latency dropped from the start of the output
+- `seconds::Float64`: Wall time
+- `realtime_factor::Float64`: Output duration divided by wall time
+- `reader_stall_ms::Float64`: Time processing waited for decoded input
+- `writer_stall_ms::Float64`: Time processing waited for the writer
+"""
+struct RenderStats
+    input_frames::Int
+    output_frames::Int
+    latency_samples::Int
+    seconds::Float64
+    realtime_factor::Float64
+    reader_stall_ms::Float64
+    writer_stall_ms::Float64
+end
+
+"""
+    renderfile(target, input::String, output::String; blocksize=target.block_size, tail=0.0,
+               compensate=true, automation=nothing, chunkframes=0, queuedepth=0,
+               rawchannels=0, rawsamplerate=0.0) -> RenderStats
+
+Stream a file through a `VST3Plugin`, `PluginChain` or `PluginGraph` into a 32-bit float
+WAV file, without loading either file into memory. A read-ahead thread decodes the input
+(WAV, or raw 32-bit float with `rawchannels` and `rawsamplerate`), the calling thread
+processes and a write-behind thread writes, connected by queues of `queuedepth` chunks
+of `chunkframes` frames (0 for the defaults). `tail` seconds of silence follow the
+input; with `compensate` the target's latency is removed from the start of the output.
+For a plugin target, `automation` is a vector of `(seconds, param_id, value)` tuples
+applied at the start of the block containing each time.
+"""
+function renderfile(target::AudioTarget, input::String, output::String;
+                    blocksize::Int=target.block_size, tail::Real=0.0, compensate::Bool=true,
+                    automation::Union{Vector{<:Tuple{Real, Integer, Real}}, Nothing}=nothing,
+                    chunkframes::Int=0, queuedepth::Int=0, rawchannels::Int=0, rawsamplerate::Real=0.0)
+    kind, _, channels = audiotarget(target)
+    points = automation === nothing ? CAutomationPoint[] :
+             sort!([CAutomationPoint(t, id, v) for (t, id, v) in automation], by=p -> p.time)
+    options = Ref(CRenderOptions(kind, target.handle, channels[1], blocksize, chunkframes, queuedepth,
+                                 tail, compensate, rawchannels, rawsamplerate,
+                                 isempty(points) ? Ptr{CAutomationPoint}(C_NULL) : pointer(points), length(points)))
+    stats = Ref{CRenderStats}()
+    ret = GC.@preserve target points ccall((:vst3_render_file, libvst3), Int32,
+                (Cstring, Cstring, Ptr{CRenderOptions}, Ptr{CRenderStats}),
+                abspath(expanduser(input)), abspath(expanduser(output)), options, stats)
+    if ret != 0
+        error("Failed to render $input")
+    end
+    c = stats[]
+    return RenderStats(c.input_frames, c.output_frames, c.latency_samples, c.seconds,
+                       c.realtime_factor, c.reader_stall_ms, c.writer_stall_ms)
+end
+
+"""
+    processmany!(plugins, inputs, outputs; events=nothing)
+
+Process one block for many independent plugins at once on the library's work-stealing
+thread pool, returning when all have finished. `inputs[i]` and `outputs[i]` are the
+buffers of `plugins[i]` (laid out as for `process!`), all with the same number of
+samples. `events[i]`, if given, is a `Vector{MidiEvent}` queued for `plugins[i]` before
+processing. Each plugin may appear only once.
+"""
+function processmany!(plugins::Vector{VST3Plugin}, inputs::Vector{Matrix{Float32}},
+                      outputs::Vector{Matrix{Float32}};
+                      events::Union{Vector{Vector{MidiEvent}}, Nothing}=nothing)
+    n = length(plugins)
+    @assert length(inputs) == n && length(outputs) == n "Need one input and output per plugin"
+    @assert events === nothing || length(events) == n "Need one event vector per plugin"
+    n == 0 && return nothing
+
+    num_samples = size(inputs[1], 2)
+    input_ptrs = Vector{Vector{Ptr{Float32}}}(undef, n)
+    output_ptrs = Vector{Vector{Ptr{Float32}}}(undef, n)
+    jobs = Vector{CProcessJob}(undef, n)
+
+    for i in 1:n
+        plugin, input, output = plugins[i], inputs[i], outputs[i]
+        @assert size(input, 2) == num_samples && size(output, 2) == num_samples "All buffers must have the same number of samples"
+        @assert num_samples <= plugin.block_size "Block size exceeds maximum"
+        @assert size(input, 1) <= plugin.num_inputs "Too many input channels"
+        @assert size(output, 1) <= plugin.num_outputs "Too many output channels"
+
+        if !plugin.active
+            activate!(plugin)
+        end
+
+        input_ptrs[i] = [pointer(input, (c-1)*num_samples + 1) for c in 1:size(input, 1)]
+        output_ptrs[i] = [pointer(output, (c-1)*num_samples + 1) for c in 1:size(output, 1)]
+        evs = events === nothing ? MidiEvent[] : events[i]
+        jobs[i] = CProcessJob(plugin.handle, pointer(input_ptrs[i]), pointer(output_ptrs[i]),
+                              size(input, 1), size(output, 1),
+                              isempty(evs) ? Ptr{MidiEvent}(C_NULL) : pointer(evs), length(evs), 0)
+    end
+
+    failed = GC.@preserve plugins inputs outputs input_ptrs output_ptrs events begin
+        ccall((:vst3_process_many, libvst3), Int32,
+              (Ptr{CProcessJob}, Int32, Int32), jobs, n, num_samples)
+    end
+
+    if failed != 0
+        bad = [i for i in 1:n if jobs[i].result != 0]
+        error("Processing failed for plugin(s) $bad")
+    end
+    return nothing
+end
+
+"""
+Completion handle of a block submitted with `submit!`. The plugin keeps it, and with it
+the block's buffers, until the block has been waited for or the plugin is closed.
+
+# Fields
+- `plugin::VST3Plugin`: Plugin processing the block
+- `ticket::Int64`: Position of the block in the plugin's submission order
+- `job::Base.RefValue{CProcessJob}`: Job read by the worker thread
+- `buffers::Tuple`: Input, output, channel pointers and events referenced by the job
+"""
+mutable struct ProcessTicket
+    plugin::VST3Plugin
+    ticket::Int64
+    job::Base.RefValue{CProcessJob}
+    buffers::Tuple
+end
+
+"""
+    submit!(plugin::VST3Plugin, input::Matrix{Float32}, output::Matrix{Float32};
+            events=nothing) -> ProcessTicket
+
+Queue one block for processing on the plugin's own worker thread and return at once,
+so the next block can be prepared while this one runs. Buffers are laid out as for
+`process!`; `events` optionally holds `MidiEvent`s for the block. Blocks run in
+submission order and up to 8 may be pending. Do not touch `input` or `output`, or call
+other functions on the plugin except `setparameter!`, until `wait` returns.
+"""
+function submit!(plugin::VST3Plugin, input::Matrix{Float32}, output::Matrix{Float32};
+                 events::Union{Vector{MidiEvent}, Nothing}=nothing)
+    num_samples = size(input, 2)
+    @assert size(output, 2) == num_samples "Input and output must have the same number of samples"
+    @assert num_samples <= plugin.block_size "Block size exceeds maximum"
+    @assert size(input, 1) <= plugin.num_inputs "Too many input channels"
+    @assert size(output, 1) <= plugin.num_outputs "Too many output channels"
+    plugin.active || activate!(plugin)
+
+    input_ptrs = [pointer(input, (c-1)*num_samples + 1) for c in 1:size(input, 1)]
+    output_ptrs = [pointer(output, (c-1)*num_samples + 1) for c in 1:size(output, 1)]
+    evs = events === nothing ? MidiEvent[] : copy(events)
+    job = Ref(CProcessJob(plugin.handle, pointer(input_ptrs), pointer(output_ptrs),
+                          size(input, 1), size(output, 1),
+                          isempty(evs) ? Ptr{MidiEvent}(C_NULL) : pointer(evs), length(evs), 0))
+
+    ticket = GC.@preserve job ccall((:vst3_process_submit, libvst3), Int64,
+                                    (Ptr{CProcessJob}, Int32), job, num_samples)
+    if ticket < 0
+        error("Failed to submit block")
+    end
+    t = ProcessTicket(plugin, ticket, job, (input, output, input_ptrs, output_ptrs, evs))
+    push!(plugin.pending, t)
+    return t
+end
+
+# Blocks finish in submission order, so every ticket up to a finished one can go
+function prunepending!(plugin::VST3Plugin, ticket::Int64)
+    filter!(p -> p.ticket > ticket, plugin.pending)
+    return nothing
+end
+
+# Wait for every submitted block before the plugin is unloaded or handed back, so the
+# worker thread never touches buffers that were already collected
+function drainpending!(plugin::VST3Plugin)
+    isempty(plugin.pending) && return nothing
+    ccall((:vst3_process_wait, libvst3), Int32, (Ptr{Cvoid}, Int64),
+          plugin.handle, last(plugin.pending).ticket)
+    empty!(plugin.pending)
+    return nothing
+end
+
+"""
+    isready(ticket::ProcessTicket) -> Bool
+
+Whether the submitted block has finished.
+"""
+function Base.isready(t::ProcessTicket)
+    ret = ccall((:vst3_process_poll, libvst3), Int32, (Ptr{Cvoid}, Int64), t.plugin.handle, t.ticket)
+    ret < 0 && error("Unknown process ticket")
+    ret == 1 && prunepending!(t.plugin, t.ticket)
+    return ret == 1
+end
+
+"""
+    wait(ticket::ProcessTicket)
+
+Block until the submitted block (and every block submitted before it) has finished.
+Throws if processing the block failed.
+"""
+function Base.wait(t::ProcessTicket)
+    ret = ccall((:vst3_process_wait, libvst3), Int32, (Ptr{Cvoid}, Int64), t.plugin.handle, t.ticket)
+    ret < 0 && error("Unknown process ticket")
+    prunepending!(t.plugin, t.ticket)
+    t.job[].result != 0 && error("Processing failed")
+    return nothing
+end
+
+"""
+    outputparameters!(plugin::VST3Plugin, points::Vector{ParameterPoint}) -> Int
+
+Copy the parameter changes reported by the plugin during the last `process!` call
+into `points` and return how many were written. `points` is grown if the block
+reported more than it holds. Call once per block; reuse `points` across blocks to
+avoid allocation.
+"""
+function outputparameters!(plugin::VST3Plugin, points::Vector{ParameterPoint})
+    readpoints() = ccall((:vst3_read_output_parameters, libvst3), Int32,
+                         (Ptr{Cvoid}, Ptr{ParameterPoint}, Int32),
+                         plugin.handle, points, length(points))
+    n = readpoints()
+    if n > length(points)
+        # The library keeps the points until they have all been read
+        resize!(points, n)
+        n = readpoints()
+    end
+    if n < 0
+        error("Failed to read output parameters")
+    end
+    return Int(n)
+end
+
+"""
+    outputparameters(plugin::VST3Plugin; max_points::Int=1024) -> Vector{ParameterPoint}
+
+Allocating version of `outputparameters!`.
+"""
+function outputparameters(plugin::VST3Plugin; max_points::Int=1024)
+    points = Vector{ParameterPoint}(undef, max_points)
+    return resize!(points, outputparameters!(plugin, points))
+end
+
+"""
+    outputevents!(plugin::VST3Plugin, events::Vector{MidiEvent}) -> Int
+
+Copy the MIDI events emitted by the plugin during the last `process!` call
+(e.g. from an arpeggiator) into `events` and return how many were written.
+`events` is grown if the block emitted more than it holds.
+"""
+function outputevents!(plugin::VST3Plugin, events::Vector{MidiEvent})
+    readevents() = ccall((:vst3_read_output_events, libvst3), Int32,
+                         (Ptr{Cvoid}, Ptr{MidiEvent}, Int32),
+                         plugin.handle, events, length(events))
+    n = readevents()
+    if n > length(events)
+        resize!(events, n)
+        n = readevents()
+    end
+    if n < 0
+        error("Failed to read output events")
+    end
+    return Int(n)
+end
+
+"""
+    outputevents(plugin::VST3Plugin; max_events::Int=1024) -> Vector{MidiEvent}
+
+Allocating version of `outputevents!`.
+"""
+function outputevents(plugin::VST3Plugin; max_events::Int=1024)
+    events = Vector{MidiEvent}(undef, max_events)
+    return resize!(events, outputevents!(plugin, events))
+end
+
+"""
+    noteon(plugin::VST3Plugin, channel::Int, note::Int, velocity::Int, offset::Int=0)
+
+Send MIDI Note On event.
+
+# Arguments
+- `channel`: MIDI channel (0-15)
+- `note`: Note number (0-127, middle C = 60)
+- `velocity`: Note velocity (0-127)
+- `offset`: Sample offset in next block (default: 0)
+"""
+function noteon(plugin::VST3Plugin, channel::Int, note::Int, velocity::Int, offset::Int=0)
+    @assert 0 <= channel <= 15 "MIDI channel must be 0-15"
+    @assert 0 <= note <= 127 "MIDI note must be 0-127"
+    @assert 0 <= velocity <= 127 "MIDI velocity must be 0-127"
+    @assert 0 <= offset < plugin.block_size "Sample offset out of range"
+
+    ret = ccall((:vst3_send_note_on, libvst3), Int32,
+                (Ptr{Cvoid}, Int32, Int32, Int32, Int32),
+                plugin.handle, channel, note, velocity, offset)
+
+    if ret != 0
+        error("Failed to send note-on event")
+    end
+    return nothing
+end
+
+"""
+    noteoff(plugin::VST3Plugin, channel::Int, note::Int, offset::Int=0)
+
+Send MIDI Note Off event.
+
+# Arguments
+- `channel`: MIDI channel (0-15)
+- `note`: Note number (0-127)
+- `offset`: Sample offset in next block (default: 0)
+"""
+function noteoff(plugin::VST3Plugin, channel::Int, note::Int, offset::Int=0)
+    @assert 0 <= channel <= 15 "MIDI channel must be 0-15"
+    @assert 0 <= note <= 127 "MIDI note must be 0-127"
+    @assert 0 <= offset < plugin.block_size "Sample offset out of range"
+
+    ret = ccall((:vst3_send_note_off, libvst3), Int32,
+                (Ptr{Cvoid}, Int32, Int32, Int32),
+                plugin.handle, channel, note, offset)
+
+    if ret != 0
+        error("Failed to send note-off event")
+    end
+    return nothing
+end
+
+"""
+    controlchange(plugin::VST3Plugin, channel::Int, controller::Int, value::Int, offset::Int=0)
 
 Send MIDI Control Change (CC) event.
 
@@ -535,9 +2198,11 @@ Send MIDI Program Change event.
 - `offset`: Sample offset in next block (default: 0)
 
 # Note
-VST3 plugins may not respond to MIDI program changes. Check for
-preset parameters with `parameters(plugin)` and use `setparameter!()`
-if available.
+The program change is delivered as a sample-accurate change of the plugin's
+program-change parameter for that channel (see `programlists`). If the program
+states were cached with `cacheprograms!`, the cached state is restored instead,
+before this returns, so the switch lands at the next block boundary and `offset`
+must be 0. Throws if the plugin has no program change parameter.
 """
 function programchange(plugin::VST3Plugin, channel::Int, program::Int, offset::Int=0)
     @assert 0 <= channel <= 15 "MIDI channel must be 0-15"
@@ -554,6 +2219,83 @@ function programchange(plugin::VST3Plugin, channel::Int, program::Int, offset::I
     return nothing
 end
 
+"""
+    ProgramList
+
+Program list published by the plugin.
+
+# Fields
+- `id::Int`: Program list ID
+- `name::String`: List name
+- `programs::Vector{String}`: Program names
+- `param_id::Int`: Program-change parameter ID (-1 if none)
+- `num_cached::Int`: Number of programs with a cached state
+"""
+struct ProgramList
+    id::Int
+    name::String
+    programs::Vector{String}
+    param_id::Int
+    num_cached::Int
+end
+
+"""
+    programlists(plugin::VST3Plugin) -> Vector{ProgramList}
+
+Program lists published by the plugin's controller.
+"""
+function programlists(plugin::VST3Plugin)
+    count = ccall((:vst3_get_program_list_count, libvst3), Int32, (Ptr{Cvoid},), plugin.handle)
+
+    lists = ProgramList[]
+    name_buf = Vector{UInt8}(undef, 128)
+    for i in 0:(count-1)
+        info_c = Ref{CProgramListInfo}()
+        ret = ccall((:vst3_get_program_list_info, libvst3), Int32,
+                    (Ptr{Cvoid}, Int32, Ptr{CProgramListInfo}), plugin.handle, i, info_c)
+        ret == 0 || continue
+
+        programs = String[]
+        for p in 0:(info_c[].program_count-1)
+            ccall((:vst3_get_program_name, libvst3), Int32,
+                  (Ptr{Cvoid}, Int32, Int32, Ptr{UInt8}, Int32),
+                  plugin.handle, i, p, name_buf, length(name_buf))
+            push!(programs, unsafe_string(pointer(name_buf)))
+        end
+
+        push!(lists, ProgramList(info_c[].id, cstring_to_string(info_c[].name), programs,
+                                 info_c[].param_id, info_c[].num_cached))
+    end
+
+    return lists
+end
+
+"""
+    cacheprograms!(plugin::VST3Plugin, list::Int=1) -> Int
+
+Capture the state of every program in program list `list` (1-based) so later
+`programchange` calls become a cached state restore. Returns the number of
+programs cached.
+"""
+function cacheprograms!(plugin::VST3Plugin, list::Int=1)
+    n = ccall((:vst3_cache_program_states, libvst3), Int32,
+              (Ptr{Cvoid}, Int32), plugin.handle, list - 1)
+    if n < 0
+        error("Failed to cache program states")
+    end
+    return Int(n)
+end
+
+"""
+    clearprograms!(plugin::VST3Plugin, list::Int=1)
+
+Drop the cached program states of program list `list` (1-based).
+"""
+function clearprograms!(plugin::VST3Plugin, list::Int=1)
+    ccall((:vst3_clear_program_states, libvst3), Cvoid, (Ptr{Cvoid}, Int32), plugin.handle, list - 1)
+    return nothing
+end
+
 """
     parameterinfo(plugin::VST3Plugin, index::Int) -> ParameterInfo
 